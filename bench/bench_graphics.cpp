@@ -0,0 +1,753 @@
+/**
+ * @file bench_graphics.cpp
+ * @brief Graphics pipeline benchmarks: encoding, frame build, submission, FIFO waits.
+ *
+ * Runs against GraphFt800Sim by default (realtime SPI model, so submission
+ * and wait figures approximate the BeagleBone), or against /dev/ft800 with
+ * --device on target.
+ *
+ *   graphics_bench [--sim | --sim-instant | --device PATH] [--filter TEXT]
+ *                  [--min-time MS] [--json PATH|-]
+ */
+
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <ctime>
+ #include <memory>
+ #include <string>
+ #include <sys/utsname.h>
+ #include "bench_harness.h"
+ #include "trace.h"
+ #include "graph_ft800.h"
+ #include "graph_ft800_sim.h"
+ #include "graph_transport.h"
+ #include "graph_cmd_encoder.h"
+ #include "graph_cmd_batch.h"
+ #include "graph_text.h"
+ #include "graph_cmd_buffer.h"
+ #include "graph_cmd_fifo.h"
+ #include "graph_wait.h"
+ #include "graph_scene.h"
+ #include "graph_bitmap_atlas.h"
+ #include "graph_ram_g.h"
+ #include "graph_touch.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_ft800Reg.h"
+ #include "graph_battery_icon.h"
+ #include "graph_memory_icon.h"
+
+ static const char* const default_device = "/dev/ft800";
+
+ // The 11 button tags of the measurement screen, in layout order.
+ static const uint8_t button_tags[] = {
+     Touch_buttons::button_1_tag, Touch_buttons::button_2_tag, Touch_buttons::button_3_tag,
+     Touch_buttons::button_4_tag, Touch_buttons::button_5_tag, Touch_buttons::button_pid_tag,
+     Touch_buttons::button_hcp_tag, Touch_buttons::button_info_1_tag, Touch_buttons::button_info_2_tag,
+     Touch_buttons::button_info_3_tag, Touch_buttons::button_info_4_tag
+ };
+ static const size_t button_count = sizeof(button_tags) / sizeof(button_tags[0]);
+
+ // Icons are placed as the bitmap cache would on an empty RAM_G.
+ static const uint32_t battery_icon_addr = RAM_G;
+ static const uint32_t memory_icon_addr = RAM_G + 0x1000U;
+
+ static int16_t button_x(size_t i) { return static_cast<int16_t>(10U + (i % 4U) * 118U); }
+ static int16_t button_y(size_t i) { return static_cast<int16_t>(60U + (i / 4U) * 60U); }
+
+ static const char* const labels[] = {
+     "Channel 1", "Channel 2", "Channel 3", "Channel 4", "Channel 5", "PID control",
+     "Heater current", "Battery voltage", "Cell temperature", "Firmware 2.4.1", "Uptime"
+ };
+ static const size_t label_count = sizeof(labels) / sizeof(labels[0]);
+
+ // The widget panel of the EXEC_CMDS comparison.
+ static const size_t panel_widgets = 24U;
+ static int16_t panel_x(size_t i) { return static_cast<int16_t>(8U + (i % 4U) * 118U); }
+ static int16_t panel_y(size_t i) { return static_cast<int16_t>(8U + (i / 4U) * 44U); }
+
+ /** Immediate-mode encoding of the representative screen. */
+ static void encode_status_screen(GraphCmdEncoder& out)
+ {
+     out.clear_color_rgb(0U, 0U, 40U);
+     out.clear(true, true, true);
+     out.cmd_text(240, 12, 28, OPT_CENTERX, "Measurement");
+     for (size_t i = 0U; i < button_count; ++i)
+     {
+         out.tag(button_tags[i]);
+         out.cmd_button(button_x(i), button_y(i), 108, 48, 27, 0U, "Button");
+     }
+     out.tag(Touch_buttons::untagged_icon_tag);
+
+     const Device_definitions::bitmap_info_t* icons[2] = {&Battery_icons::full_icon, &Memory_icons::memory_icon};
+     const uint32_t addr[2] = {battery_icon_addr, memory_icon_addr};
+     for (uint8_t h = 0U; h < 2U; ++h)
+     {
+         out.bitmap_handle(h);
+         out.bitmap_source(addr[h]);
+         out.bitmap_layout(icons[h]->format, icons[h]->stride, icons[h]->height);
+         out.bitmap_size(icons[h]->filter, icons[h]->wrap_x, icons[h]->wrap_y, icons[h]->width, icons[h]->height);
+         out.begin_bitmap(h);
+         out.vertex2ii(static_cast<uint16_t>(440U + h * 18U), 4U, h, 0U);
+         out.end();
+     }
+ }
+
+ /** The same screen as a retained widget tree. */
+ struct status_scene_t
+ {
+     GraphScene scene;
+     GraphText title;
+     GraphBitmap battery;
+     GraphBitmap memory;
+     std::vector<std::unique_ptr<GraphButton>> buttons;
+
+     status_scene_t()
+         : title(240, 12, 28, OPT_CENTERX, "Measurement"),
+           battery(440U, 4U, Battery_icons::full_icon),
+           memory(458U, 4U, Memory_icons::memory_icon)
+     {
+         scene.set_background(0U, 0U, 40U);
+         scene.root().add_child(&title);
+         for (size_t i = 0U; i < button_count; ++i)
+         {
+             buttons.emplace_back(new GraphButton(button_x(i), button_y(i), 108, 48, 27, "Button"));
+             buttons.back()->set_tag(button_tags[i]);
+             scene.root().add_child(buttons.back().get());
+         }
+         battery.set_placement(battery_icon_addr, 0U);
+         memory.set_placement(memory_icon_addr, 1U);
+         scene.root().add_child(&battery);
+         scene.root().add_child(&memory);
+     }
+ };
+
+ /** Encodes the screen into @p buffer and submits it; @p bytes receives the frame size. */
+ static bool buffer_frame(GraphCmdBuffer& buffer, size_t* bytes = nullptr)
+ {
+     buffer.begin_frame();
+     encode_status_screen(buffer);
+     if (bytes != nullptr)
+     {
+         *bytes = buffer.size_bytes();
+     }
+     return buffer.end_frame();
+ }
+
+ static void add_encode_benchmarks(BenchHarness& harness)
+ {
+     harness.add("encode/status_screen", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         while (state.keep_running())
+         {
+             encoder.reset();
+             encode_status_screen(encoder);
+             state.add_items(encoder.size());
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = words");
+         return true;
+     });
+
+     // The measurement screen's labels: packed byte by byte, or copied from the text cache.
+     harness.add("encode/labels_cmd_text", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         while (state.keep_running())
+         {
+             encoder.reset();
+             for (size_t i = 0U; i < label_count; ++i)
+             {
+                 encoder.cmd_text(button_x(i), button_y(i), 26, 0U, labels[i]);
+             }
+             state.add_items(label_count);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = labels");
+         return true;
+     });
+     harness.add("encode/labels_text_cache", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         GraphTextCache cache;
+         while (state.keep_running())
+         {
+             encoder.reset();
+             for (size_t i = 0U; i < label_count; ++i)
+             {
+                 cache.text(encoder, button_x(i), button_y(i), 26, 0U, labels[i]);
+             }
+             state.add_items(label_count);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = labels");
+         return true;
+     });
+     harness.add("encode/labels_interned", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         GraphTextCache cache;
+         GraphInternedText* interned[label_count];
+         for (size_t i = 0U; i < label_count; ++i)
+         {
+             interned[i] = cache.intern(labels[i]);
+         }
+         while (state.keep_running())
+         {
+             encoder.reset();
+             for (size_t i = 0U; i < label_count; ++i)
+             {
+                 cache.text(encoder, button_x(i), button_y(i), 26, 0U, interned[i]);
+             }
+             state.add_items(label_count);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = labels");
+         return true;
+     });
+
+     harness.add("scene/build_cold", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         while (state.keep_running())
+         {
+             state.pause_timing();
+             std::unique_ptr<status_scene_t> screen(new status_scene_t());
+             encoder.reset();
+             state.resume_timing();
+
+             screen->scene.encode(encoder);
+             state.add_items(1U);
+             state.add_bytes(encoder.size_bytes());
+
+             state.pause_timing();
+             screen.reset();
+             state.resume_timing();
+         }
+         state.set_label("items = frames");
+         return true;
+     });
+
+     harness.add("scene/build_one_dirty", [](BenchState& state)
+     {
+         status_scene_t screen;
+         GraphCmdEncoder encoder;
+         screen.scene.encode(encoder);
+         bool on = false;
+         while (state.keep_running())
+         {
+             on = !on;
+             screen.buttons[5]->set_text(on ? "PID on" : "PID off");
+             encoder.reset();
+             screen.scene.encode(encoder);
+             state.add_items(1U);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = frames");
+         return true;
+     });
+
+     harness.add("scene/build_clean", [](BenchState& state)
+     {
+         status_scene_t screen;
+         GraphCmdEncoder encoder;
+         screen.scene.encode(encoder);
+         while (state.keep_running())
+         {
+             encoder.reset();
+             screen.scene.encode(encoder);
+             state.add_items(1U);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = frames");
+         return true;
+     });
+ }
+
+ /** One frame per iteration through @p mode, waiting for the co-processor to drain. */
+ static bool run_submit(BenchState& state, GraphFt800& ft800, GraphCmdBuffer::submit_mode_t mode)
+ {
+     GraphCmdFifo fifo(ft800);
+     GraphCmdBuffer buffer(ft800);
+     GraphWait waiter(ft800);
+     buffer.set_skip_unchanged(false);
+     buffer.attach_fifo(&fifo);
+     if (!fifo.sync() || !buffer.set_submit_mode(mode))
+     {
+         state.set_error((mode == GraphCmdBuffer::submit_mode_t::PUSH_MMAP) ? "staging mmap unavailable"
+                                                                            : "co-processor not ready");
+         return false;
+     }
+
+     while (state.keep_running())
+     {
+         size_t bytes = 0U;
+         if (!buffer_frame(buffer, &bytes) || waiter.wait_idle() != GraphWait::wait_result_t::WAIT_DONE)
+         {
+             state.set_error("frame submission failed");
+             break;
+         }
+         state.add_items(1U);
+         state.add_bytes(bytes);
+     }
+     state.set_label("items = frames, includes drain");
+     return true;
+ }
+
+ /** The widget panel as one GraphCmdBatch per frame, @p chunk descriptors per EXEC_CMDS call. */
+ static bool run_widget_batch(BenchState& state, GraphFt800& ft800, size_t chunk)
+ {
+     GraphWait waiter(ft800);
+     GraphCmdEncoder head;
+     GraphCmdEncoder tail;
+     head.cmd_dlstart();
+     tail.display();
+     tail.cmd_swap();
+     GraphCmdBatch batch;
+     batch.set_chunk(chunk);
+     while (state.keep_running())
+     {
+         batch.reset();
+         batch.raw(head.data(), head.size());
+         for (size_t i = 0U; i < panel_widgets; ++i)
+         {
+             batch.button(panel_x(i), panel_y(i), 100, 30, 26, 0U, "Button");
+             batch.text(panel_x(i), static_cast<int16_t>(panel_y(i) + 32), 20, 0U, "label");
+         }
+         batch.raw(tail.data(), tail.size());
+         if (!batch.submit(ft800) || waiter.wait_idle() != GraphWait::wait_result_t::WAIT_DONE)
+         {
+             state.set_error("widget submission failed");
+             break;
+         }
+         state.add_items(1U);
+     }
+     state.set_label(batch.uses_exec_cmds() ? "items = frames, includes drain"
+                                            : "items = frames, includes drain, EXEC_CMDS unsupported");
+     return true;
+ }
+
+ static void add_submit_benchmarks(BenchHarness& harness, GraphFt800& ft800)
+ {
+     harness.add("submit/SUBMIT_CMDS", [&ft800](BenchState& state)
+     {
+         return run_submit(state, ft800, GraphCmdBuffer::submit_mode_t::SUBMIT_CMDS);
+     });
+     harness.add("submit/PUSH_MMAP", [&ft800](BenchState& state)
+     {
+         return run_submit(state, ft800, GraphCmdBuffer::submit_mode_t::PUSH_MMAP);
+     });
+     harness.add("submit/FIFO_RING", [&ft800](BenchState& state)
+     {
+         return run_submit(state, ft800, GraphCmdBuffer::submit_mode_t::FIFO_RING);
+     });
+
+     // A panel of labelled buttons, one ioctl per widget against one EXEC_CMDS list.
+     harness.add("submit/widgets_per_call", [&ft800](BenchState& state)
+     {
+         GraphWait waiter(ft800);
+         while (state.keep_running())
+         {
+             bool ok = ft800.cmd_dlstart().ok();
+             for (size_t i = 0U; ok && i < panel_widgets; ++i)
+             {
+                 ok = ft800.cmd_button(panel_x(i), panel_y(i), 100, 30, 26, 0U, "Button").ok() &&
+                      ft800.cmd_text(panel_x(i), static_cast<uint16_t>(panel_y(i) + 32U), 20, 0U, "label").ok();
+             }
+             ok = ok && ft800.display().ok() && ft800.cmd_swap().ok();
+             if (!ok || waiter.wait_idle() != GraphWait::wait_result_t::WAIT_DONE)
+             {
+                 state.set_error("widget submission failed");
+                 break;
+             }
+             state.add_items(1U);
+         }
+         state.set_label("items = frames, includes drain");
+         return true;
+     });
+     harness.add("submit/widgets_EXEC_CMDS", [&ft800](BenchState& state)
+     {
+         return run_widget_batch(state, ft800, GraphCmdBatch::default_chunk);
+     });
+     // Half the default chunk: more syscalls against an earlier co-processor start.
+     harness.add("submit/widgets_EXEC_chunk4", [&ft800](BenchState& state)
+     {
+         return run_widget_batch(state, ft800, 4U);
+     });
+ }
+
+ static void add_fifo_benchmarks(BenchHarness& harness, GraphFt800& ft800)
+ {
+     harness.add("fifo/wait_idle_when_idle", [&ft800](BenchState& state)
+     {
+         GraphWait waiter(ft800);
+         while (state.keep_running())
+         {
+             if (waiter.wait_idle() != GraphWait::wait_result_t::WAIT_DONE)
+             {
+                 state.set_error("co-processor not idle");
+                 break;
+             }
+             state.add_items(1U);
+         }
+         state.set_label("one status read");
+         return true;
+     });
+
+     harness.add("fifo/wait_after_frame", [&ft800](BenchState& state)
+     {
+         GraphCmdFifo fifo(ft800);
+         GraphCmdBuffer buffer(ft800);
+         buffer.set_skip_unchanged(false);
+         buffer.attach_fifo(&fifo);
+         if (!fifo.sync() || !buffer.set_submit_mode(GraphCmdBuffer::submit_mode_t::FIFO_RING))
+         {
+             state.set_error("co-processor not ready");
+             return false;
+         }
+         uint64_t polls = 0U;
+         while (state.keep_running())
+         {
+             state.pause_timing();
+             bool queued = buffer_frame(buffer);
+             state.resume_timing();
+             if (!queued || !fifo.wait_idle())
+             {
+                 state.set_error("frame did not drain");
+                 break;
+             }
+             state.add_items(1U);
+             polls++;
+         }
+         GraphWait::stats_t stats = fifo.get_waiter().get_stats();
+         state.set_label("waits " + std::to_string(stats.waits) + ", max " +
+                         std::to_string(stats.max_wait_ns / 1000U) + " us");
+         return polls > 0U;
+     });
+
+     harness.add("fifo/stream_frames", [&ft800](BenchState& state)
+     {
+         GraphCmdFifo fifo(ft800);
+         GraphCmdBuffer buffer(ft800);
+         buffer.set_skip_unchanged(false);
+         buffer.attach_fifo(&fifo);
+         if (!fifo.sync() || !buffer.set_submit_mode(GraphCmdBuffer::submit_mode_t::FIFO_RING))
+         {
+             state.set_error("co-processor not ready");
+             return false;
+         }
+         while (state.keep_running())
+         {
+             if (!buffer_frame(buffer))
+             {
+                 state.set_error("ring write failed");
+                 break;
+             }
+             state.add_items(1U);
+         }
+         bool drained = fifo.wait_idle();
+         state.set_label("no per-frame drain, stalls " + std::to_string(fifo.stall_count()));
+         return drained;
+     });
+ }
+
+ // Battery levels that cycle every frame. low_icon is left out: its zlib
+ // payload does not inflate, and GraphBitmapAtlas::build() rejects it.
+ static const Device_definitions::bitmap_info_t* const battery_levels = &Battery_icons::icons[1];
+ static const size_t battery_level_count = Battery_icons::battery_icon_count - 1U;
+ static const uint8_t battery_atlas_handle = 14U;
+
+ static void add_atlas_benchmarks(BenchHarness& harness, GraphFt800& ft800)
+ {
+     // One bitmap per level: a switch rewrites the handle, source, layout and size.
+     harness.add("scene/battery_bitmaps", [](BenchState& state)
+     {
+         status_scene_t screen;
+         GraphCmdEncoder encoder;
+         screen.scene.encode(encoder);
+         uint32_t frame = 0U;
+         while (state.keep_running())
+         {
+             size_t level = frame++ % battery_level_count;
+             screen.battery.set_bitmap(battery_levels[level]);
+             screen.battery.set_placement(battery_icon_addr + static_cast<uint32_t>(level) * 0x400U, 0U);
+             encoder.reset();
+             screen.scene.encode(encoder);
+             state.add_items(1U);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = frames, level switched every frame");
+         return true;
+     });
+
+     // One atlas cell per level: a switch rewrites the VERTEX2II word.
+     harness.add("scene/battery_atlas", [&ft800](BenchState& state)
+     {
+         GraphRamG ram_g;
+         GraphBitmapAtlas atlas(ft800, ram_g);
+         if (!atlas.build(battery_levels, battery_level_count, battery_atlas_handle))
+         {
+             state.set_error("atlas build failed");
+             return false;
+         }
+         status_scene_t screen;
+         GraphAtlasIcon battery(440U, 4U, atlas);
+         screen.scene.root().remove_child(&screen.battery);
+         screen.scene.root().add_child(&battery);
+         screen.scene.attach_atlas(&atlas);
+
+         GraphCmdEncoder encoder;
+         screen.scene.encode(encoder);
+         uint32_t frame = 0U;
+         while (state.keep_running())
+         {
+             battery.set_cell(static_cast<uint8_t>(frame++ % battery_level_count));
+             encoder.reset();
+             screen.scene.encode(encoder);
+             state.add_items(1U);
+             state.add_bytes(encoder.size_bytes());
+         }
+         state.set_label("items = frames, level switched every frame");
+         return true;
+     });
+ }
+
+ // Live readouts of a status screen: charge percentages and event counters.
+ static const size_t readout_count = 8U;
+ static const uint32_t readout_rate_hz = 60U;
+
+ static int32_t readout_value(uint32_t frame, size_t i)
+ {
+     return (i < 4U) ? static_cast<int32_t>((frame * 7U + i * 13U) % 101U)    // percent
+                     : static_cast<int32_t>(100000U + frame * 3U + i);        // counter
+ }
+
+ static std::string readout_label(uint64_t bytes, uint64_t readouts)
+ {
+     char text[96];
+     double per_readout = (readouts > 0U) ? static_cast<double>(bytes) / static_cast<double>(readouts) : 0.0;
+     (void)snprintf(text, sizeof(text), "items = readouts, %.1f B/readout, %.0f B/s per readout at %u Hz",
+                    per_readout, per_readout * readout_rate_hz, readout_rate_hz);
+     return text;
+ }
+
+ static void add_readout_benchmarks(BenchHarness& harness)
+ {
+     // Host formatting: snprintf, then the digits travel as a CMD_TEXT string.
+     harness.add("readout/snprintf_text", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         uint32_t frame = 0U;
+         uint64_t bytes = 0U;
+         uint64_t readouts = 0U;
+         while (state.keep_running())
+         {
+             encoder.reset();
+             for (size_t i = 0U; i < readout_count; ++i)
+             {
+                 char text[16];
+                 (void)snprintf(text, sizeof(text), (i < 4U) ? "%d%%" : "%d", readout_value(frame, i));
+                 encoder.cmd_text(400, button_y(i), 26, OPT_RIGHTX, text);
+             }
+             frame++;
+             state.add_items(readout_count);
+             state.add_bytes(encoder.size_bytes());
+             bytes += encoder.size_bytes();
+             readouts += readout_count;
+         }
+         state.set_label(readout_label(bytes, readouts));
+         return true;
+     });
+
+     // Co-processor formatting: the raw integer as CMD_NUMBER, the fixed unit from the text cache.
+     harness.add("readout/cmd_number", [](BenchState& state)
+     {
+         GraphCmdEncoder encoder;
+         GraphTextCache cache;
+         GraphInternedText* percent = cache.intern("%");
+         uint32_t frame = 0U;
+         uint64_t bytes = 0U;
+         uint64_t readouts = 0U;
+         while (state.keep_running())
+         {
+             encoder.reset();
+             for (size_t i = 0U; i < readout_count; ++i)
+             {
+                 encoder.cmd_number(400, button_y(i), 26, OPT_RIGHTX, readout_value(frame, i));
+                 if (i < 4U)
+                 {
+                     cache.text(encoder, 400, button_y(i), 26, 0U, percent);
+                 }
+             }
+             frame++;
+             state.add_items(readout_count);
+             state.add_bytes(encoder.size_bytes());
+             bytes += encoder.size_bytes();
+             readouts += readout_count;
+         }
+         state.set_label(readout_label(bytes, readouts));
+         return true;
+     });
+ }
+
+ static void add_register_benchmarks(BenchHarness& harness, GraphFt800& ft800)
+ {
+     // What a status poll wants: ring pointers, display-list fill, touch.
+     static const uint32_t status_regs[] = {REG_CMD_READ, REG_CMD_WRITE, REG_CMD_DL, REG_TOUCH_TAG, REG_FRAMES};
+     static const size_t status_count = sizeof(status_regs) / sizeof(status_regs[0]);
+
+     harness.add("regs/status_one_by_one", [&ft800](BenchState& state)
+     {
+         uint32_t values[status_count];
+         while (state.keep_running())
+         {
+             for (size_t i = 0U; i < status_count; ++i)
+             {
+                 if (!ft800.read_reg32(status_regs[i], &values[i]))
+                 {
+                     state.set_error("register read failed");
+                 }
+             }
+             state.add_items(status_count);
+         }
+         state.set_label("items = registers");
+         return true;
+     });
+
+     harness.add("regs/status_read_regs", [&ft800](BenchState& state)
+     {
+         uint32_t values[status_count];
+         while (state.keep_running())
+         {
+             if (!ft800.read_regs(status_regs, values, status_count))
+             {
+                 state.set_error("register read failed");
+             }
+             state.add_items(status_count);
+         }
+         state.set_label("items = registers");
+         return true;
+     });
+ }
+
+ static std::string utc_now()
+ {
+     char text[32];
+     time_t now = time(nullptr);
+     struct tm parts;
+     (void)gmtime_r(&now, &parts);
+     (void)strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &parts);
+     return text;
+ }
+
+ static void usage(const char* program)
+ {
+     (void)fprintf(stderr,
+                   "usage: %s [--sim | --sim-instant | --device PATH] [--filter TEXT] [--min-time MS] [--json PATH|-]\n",
+                   program);
+ }
+
+ int main(int argc, char** argv)
+ {
+     const char* device_path = nullptr;
+     const char* json_path = nullptr;
+     const char* filter = nullptr;
+     bool realtime = true;
+     uint32_t min_time_ms = 300U;
+
+     for (int i = 1; i < argc; ++i)
+     {
+         bool has_value = (i + 1 < argc);
+         if (strcmp(argv[i], "--sim") == 0)
+         {
+             device_path = nullptr;
+         }
+         else if (strcmp(argv[i], "--sim-instant") == 0)
+         {
+             device_path = nullptr;
+             realtime = false;
+         }
+         else if (strcmp(argv[i], "--device") == 0)
+         {
+             device_path = (has_value && argv[i + 1][0] != '-') ? argv[++i] : default_device;
+         }
+         else if (strcmp(argv[i], "--filter") == 0 && has_value)
+         {
+             filter = argv[++i];
+         }
+         else if (strcmp(argv[i], "--min-time") == 0 && has_value)
+         {
+             min_time_ms = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 0));
+         }
+         else if (strcmp(argv[i], "--json") == 0 && has_value)
+         {
+             json_path = argv[++i];
+         }
+         else
+         {
+             usage(argv[0]);
+             return EXIT_FAILURE;
+         }
+     }
+
+     GraphFt800Sim sim;
+     GraphFt800Sim::spi_model_t model = GraphFt800Sim::default_spi_model;
+     model.realtime = realtime;
+     sim.set_spi_model(model);
+     std::unique_ptr<GraphDeviceTransport> device;
+     GraphTransport* transport = &sim;
+     if (device_path != nullptr)
+     {
+         device.reset(new GraphDeviceTransport(device_path));
+         if (!device->is_open())
+         {
+             perror(device_path);
+             return EXIT_FAILURE;
+         }
+         transport = device.get();
+     }
+
+     GraphFt800 ft800(*transport);
+     if (ft800.is_faulted() && !ft800.recover())
+     {
+         (void)fprintf(stderr, "co-processor faulted and could not be reset\n");
+         return EXIT_FAILURE;
+     }
+
+     BenchHarness harness;
+     harness.set_min_time_ms(min_time_ms);
+     harness.set_filter(filter);
+
+     struct utsname host;
+     harness.set_context("date", utc_now());
+     harness.set_context("target", (device_path != nullptr) ? device_path : (realtime ? "sim" : "sim-instant"));
+     harness.set_context("host", (uname(&host) == 0) ? std::string(host.nodename) + " " + host.machine : "unknown");
+     harness.set_context("compiler", __VERSION__);
+     harness.set_context("min_time_ms", std::to_string(min_time_ms));
+ #ifdef TRACE_ENABLED
+     harness.set_context("tracing", Trace::enabled() ? "recording" : "compiled in, off");
+ #else
+     harness.set_context("tracing", "compiled out");
+ #endif
+
+     add_encode_benchmarks(harness);
+     add_readout_benchmarks(harness);
+     add_atlas_benchmarks(harness, ft800);
+     add_submit_benchmarks(harness, ft800);
+     add_fifo_benchmarks(harness, ft800);
+     add_register_benchmarks(harness, ft800);
+
+     size_t failures = harness.run(stdout);
+
+     if (json_path != nullptr)
+     {
+         bool written = (strcmp(json_path, "-") == 0) ? harness.write_json(stdout) : harness.write_json(json_path);
+         if (!written)
+         {
+             perror(json_path);
+             return EXIT_FAILURE;
+         }
+     }
+     return (failures == 0U) ? EXIT_SUCCESS : EXIT_FAILURE;
+ }
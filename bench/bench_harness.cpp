@@ -0,0 +1,243 @@
+/**
+ * @file bench_harness.cpp
+ * @brief Benchmark loop, statistics and JSON report.
+ */
+
+ #include <algorithm>
+ #include "bench_harness.h"
+
+ BenchState::BenchState(uint64_t min_time_ns, uint64_t min_iterations, uint64_t max_iterations)
+     : min_time_ns(min_time_ns), min_iterations(min_iterations), max_iterations(max_iterations),
+       last_ns(0U), paused_at_ns(0U), paused_ns(0U), measured_ns(0U), started(false),
+       items(0U), bytes(0U)
+ {
+     samples.reserve(static_cast<size_t>(std::min<uint64_t>(max_iterations, 1U << 16)));
+ }
+
+ uint64_t BenchState::now_ns()
+ {
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+ }
+
+ /**
+  * Closes the previous iteration and decides whether to run another: at
+  * least min_iterations and min_time_ns of measured time, at most
+  * max_iterations. An error set by the body stops the loop.
+  */
+ bool BenchState::keep_running()
+ {
+     uint64_t now = now_ns();
+
+     if (started)
+     {
+         uint64_t sample = now - last_ns - paused_ns;
+         samples.push_back(sample);
+         measured_ns += sample;
+     }
+     started = true;
+     paused_ns = 0U;
+
+     bool done = !error.empty() || (samples.size() >= max_iterations) ||
+                 (samples.size() >= min_iterations && measured_ns >= min_time_ns);
+
+     last_ns = now_ns();
+     return !done;
+ }
+
+ /** Excludes the time until resume_timing() from the current iteration. */
+ void BenchState::pause_timing()
+ {
+     paused_at_ns = now_ns();
+ }
+
+ void BenchState::resume_timing()
+ {
+     paused_ns += now_ns() - paused_at_ns;
+ }
+
+ BenchHarness::BenchHarness()
+     : min_time_ns(300ULL * 1000000ULL), min_iterations(10U), max_iterations(1000000U)
+ {
+ }
+
+ void BenchHarness::set_iteration_limits(uint64_t min_count, uint64_t max_count)
+ {
+     min_iterations = (min_count > 0U) ? min_count : 1U;
+     max_iterations = (max_count >= min_iterations) ? max_count : min_iterations;
+ }
+
+ /** Adds a key/value pair to the "context" object of the JSON report. */
+ void BenchHarness::set_context(const char* key, const std::string& value)
+ {
+     context.push_back(std::make_pair(std::string(key), value));
+ }
+
+ void BenchHarness::add(const char* name, body_t body)
+ {
+     entry_t entry;
+     entry.name = name;
+     entry.body = body;
+     entries.push_back(entry);
+ }
+
+ /** Reduces the per-iteration samples to the reported figures. */
+ BenchHarness::result_t BenchHarness::summarise(const std::string& name, BenchState& state)
+ {
+     result_t result;
+     result.name = name;
+     result.label = state.label;
+     result.error = state.error;
+     result.iterations = state.samples.size();
+     result.mean_ns = result.median_ns = result.p95_ns = result.min_ns = result.max_ns = 0.0;
+     result.items_per_second = result.bytes_per_second = 0.0;
+
+     std::vector<uint64_t>& samples = state.samples;
+     if (samples.empty())
+     {
+         return result;
+     }
+     std::sort(samples.begin(), samples.end());
+     uint64_t total = 0U;
+     for (uint64_t sample : samples)
+     {
+         total += sample;
+     }
+     double seconds = static_cast<double>(total) / 1e9;
+     result.mean_ns = static_cast<double>(total) / samples.size();
+     result.median_ns = static_cast<double>(samples[samples.size() / 2U]);
+     result.p95_ns = static_cast<double>(samples[(samples.size() * 95U) / 100U]);
+     result.min_ns = static_cast<double>(samples.front());
+     result.max_ns = static_cast<double>(samples.back());
+     if (seconds > 0.0)
+     {
+         result.items_per_second = static_cast<double>(state.items) / seconds;
+         result.bytes_per_second = static_cast<double>(state.bytes) / seconds;
+     }
+     return result;
+ }
+
+ /** Runs every benchmark matching the filter; returns how many failed. */
+ size_t BenchHarness::run(FILE* console)
+ {
+     size_t failures = 0U;
+     run_results.clear();
+
+     if (console != nullptr)
+     {
+         (void)fprintf(console, "%-28s %10s %12s %12s %12s %14s %14s\n", "benchmark", "iters", "mean ns",
+                       "median ns", "p95 ns", "items/s", "bytes/s");
+     }
+     for (entry_t& entry : entries)
+     {
+         if (!filter.empty() && entry.name.find(filter) == std::string::npos)
+         {
+             continue;
+         }
+         BenchState state(min_time_ns, min_iterations, max_iterations);
+         if (!entry.body(state) && state.error.empty())
+         {
+             state.error = "failed";
+         }
+         result_t result = summarise(entry.name, state);
+         run_results.push_back(result);
+
+         if (!result.error.empty())
+         {
+             failures++;
+         }
+         if (console == nullptr)
+         {
+             continue;
+         }
+         if (!result.error.empty())
+         {
+             (void)fprintf(console, "%-28s  ERROR: %s\n", result.name.c_str(), result.error.c_str());
+             continue;
+         }
+         (void)fprintf(console, "%-28s %10llu %12.0f %12.0f %12.0f %14.0f %14.0f %s\n", result.name.c_str(),
+                       static_cast<unsigned long long>(result.iterations), result.mean_ns, result.median_ns,
+                       result.p95_ns, result.items_per_second, result.bytes_per_second, result.label.c_str());
+     }
+     return failures;
+ }
+
+ /** Writes @p text as a JSON string literal. */
+ static void json_string(FILE* stream, const std::string& text)
+ {
+     (void)fputc('"', stream);
+     for (char c : text)
+     {
+         if (c == '"' || c == '\\')
+         {
+             (void)fputc('\\', stream);
+             (void)fputc(c, stream);
+         }
+         else if (static_cast<unsigned char>(c) < 0x20U)
+         {
+             (void)fprintf(stream, "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+         }
+         else
+         {
+             (void)fputc(c, stream);
+         }
+     }
+     (void)fputc('"', stream);
+ }
+
+ /**
+  * Writes the last run as {"context": {...}, "benchmarks": [...]}, one
+  * object per benchmark with times in nanoseconds per iteration.
+  */
+ bool BenchHarness::write_json(FILE* stream) const
+ {
+     if (stream == nullptr)
+     {
+         return false;
+     }
+
+     (void)fprintf(stream, "{\n  \"context\": {");
+     for (size_t i = 0U; i < context.size(); ++i)
+     {
+         (void)fprintf(stream, "%s\n    ", (i == 0U) ? "" : ",");
+         json_string(stream, context[i].first);
+         (void)fprintf(stream, ": ");
+         json_string(stream, context[i].second);
+     }
+     (void)fprintf(stream, "\n  },\n  \"benchmarks\": [");
+     for (size_t i = 0U; i < run_results.size(); ++i)
+     {
+         const result_t& r = run_results[i];
+         (void)fprintf(stream, "%s\n    {\"name\": ", (i == 0U) ? "" : ",");
+         json_string(stream, r.name);
+         (void)fprintf(stream, ", \"iterations\": %llu, \"mean_ns\": %.1f, \"median_ns\": %.1f, \"p95_ns\": %.1f, "
+                       "\"min_ns\": %.1f, \"max_ns\": %.1f, \"items_per_second\": %.1f, \"bytes_per_second\": %.1f",
+                       static_cast<unsigned long long>(r.iterations), r.mean_ns, r.median_ns, r.p95_ns, r.min_ns,
+                       r.max_ns, r.items_per_second, r.bytes_per_second);
+         if (!r.label.empty())
+         {
+             (void)fprintf(stream, ", \"label\": ");
+             json_string(stream, r.label);
+         }
+         if (!r.error.empty())
+         {
+             (void)fprintf(stream, ", \"error\": ");
+             json_string(stream, r.error);
+         }
+         (void)fprintf(stream, "}");
+     }
+     (void)fprintf(stream, "\n  ]\n}\n");
+     return ferror(stream) == 0;
+ }
+
+ bool BenchHarness::write_json(const char* path) const
+ {
+     FILE* stream = (path != nullptr) ? fopen(path, "w") : nullptr;
+     if (stream == nullptr)
+     {
+         return false;
+     }
+     bool result = write_json(stream);
+     return (fclose(stream) == 0) && result;
+ }
@@ -0,0 +1,119 @@
+/**
+ * @file bench_harness.h
+ * @brief Minimal self-contained micro-benchmark harness with JSON output.
+ */
+
+ #ifndef BENCH_HARNESS_H
+ #define BENCH_HARNESS_H
+
+ #include <cstdint>
+ #include <cstdio>
+ #include <ctime>
+ #include <functional>
+ #include <string>
+ #include <vector>
+
+ /**
+  * Handed to a benchmark body, which loops on keep_running() around one
+  * operation. Each iteration is timed separately (one clock read per
+  * iteration, ~40 ns), so results carry a median and tail, not only a mean.
+  * Per-iteration setup goes between pause_timing() and resume_timing().
+  *
+  *     harness.add("encode/frame", [&](BenchState& state)
+  *     {
+  *         while (state.keep_running())
+  *         {
+  *             ...one operation...
+  *             state.add_items(words);
+  *         }
+  *         return true;
+  *     });
+  */
+ class BenchState
+ {
+ public:
+     BenchState(uint64_t min_time_ns, uint64_t min_iterations, uint64_t max_iterations);
+
+     bool keep_running();
+     void pause_timing();
+     void resume_timing();
+
+     void add_items(uint64_t count) { items += count; }
+     void add_bytes(uint64_t count) { bytes += count; }
+     void set_error(const char* message) { error = message; }
+     void set_label(const std::string& text) { label = text; }
+
+ private:
+     friend class BenchHarness;
+
+     static uint64_t now_ns();
+
+     uint64_t min_time_ns;
+     uint64_t min_iterations;
+     uint64_t max_iterations;
+     uint64_t last_ns;
+     uint64_t paused_at_ns;
+     uint64_t paused_ns;
+     uint64_t measured_ns;
+     bool started;
+     std::vector<uint64_t> samples;
+     uint64_t items;
+     uint64_t bytes;
+     std::string error;
+     std::string label;
+ };
+
+ /** Registers named benchmark bodies, runs them and reports. */
+ class BenchHarness
+ {
+ public:
+     typedef std::function<bool(BenchState&)> body_t;
+
+     struct result_t
+     {
+         std::string name;
+         std::string label;
+         std::string error;       //!< Empty when the run succeeded
+         uint64_t iterations;
+         double mean_ns;
+         double median_ns;
+         double p95_ns;
+         double min_ns;
+         double max_ns;
+         double items_per_second;
+         double bytes_per_second;
+     };
+
+     BenchHarness();
+
+     void set_min_time_ms(uint32_t ms) { min_time_ns = static_cast<uint64_t>(ms) * 1000000ULL; }
+     void set_iteration_limits(uint64_t min_count, uint64_t max_count);
+     void set_filter(const char* substring) { filter = (substring != nullptr) ? substring : ""; }
+     void set_context(const char* key, const std::string& value);
+
+     void add(const char* name, body_t body);
+     size_t run(FILE* console);
+
+     const std::vector<result_t>& results() const { return run_results; }
+     bool write_json(FILE* stream) const;
+     bool write_json(const char* path) const;
+
+ private:
+     struct entry_t
+     {
+         std::string name;
+         body_t body;
+     };
+
+     static result_t summarise(const std::string& name, BenchState& state);
+
+     uint64_t min_time_ns;
+     uint64_t min_iterations;
+     uint64_t max_iterations;
+     std::string filter;
+     std::vector<entry_t> entries;
+     std::vector<std::pair<std::string, std::string>> context;
+     std::vector<result_t> run_results;
+ };
+
+ #endif // BENCH_HARNESS_H
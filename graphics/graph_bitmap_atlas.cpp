@@ -0,0 +1,240 @@
+/**
+ * @file graph_bitmap_atlas.cpp
+ * @brief Icon families packed into one RAM_G block and drawn by VERTEX2II cell.
+ */
+
+ #include <cstring>
+ #include <vector>
+ #include "graph_bitmap_atlas.h"
+ #include "graph_bitmap_cache.h"
+ #include "graph_cmd_fifo.h"
+ #include "graph_wait.h"
+ #include "graph_ft800Reg.h"
+
+ // Field widths of BITMAP_LAYOUT (10-bit stride) and BITMAP_SIZE (9-bit extent).
+ static const uint16_t max_stride = 1023U;
+ static const uint16_t max_extent = 511U;
+
+ GraphBitmapAtlas::GraphBitmapAtlas(GraphFt800& ft800, GraphRamG& ram_g)
+     : ft800(ft800), ram_g(ram_g), fifo(nullptr), cells(0U), block(GraphRamG::invalid_offset),
+       scratch(GraphRamG::invalid_offset)
+ {
+     (void)memset(&layout, 0, sizeof(layout));
+     layout.handle = no_handle;
+ }
+
+ GraphBitmapAtlas::~GraphBitmapAtlas()
+ {
+     release();
+ }
+
+ /**
+  * Checks that the icons can share one layout and inflate, and sizes the
+  * cell to fit them all. @p scratch_bytes receives the largest compressed image whose
+  * stride differs from the cell's, i.e. one that must be inflated aside.
+  */
+ bool GraphBitmapAtlas::measure(const Device_definitions::bitmap_info_t* icons, size_t count, uint32_t* scratch_bytes)
+ {
+     if (icons == nullptr || count == 0U || count > max_cells)
+     {
+         return false;
+     }
+
+     uint16_t width = 0U;
+     uint16_t height = 0U;
+     uint16_t stride = 0U;
+     for (size_t i = 0U; i < count; ++i)
+     {
+         const Device_definitions::bitmap_info_t& icon = icons[i];
+         if (icon.pixel_data == nullptr || icon.format != icons[0].format || !GraphBitmapCache::inflates(icon))
+         {
+             return false;
+         }
+         width = (icon.width > width) ? icon.width : width;
+         height = (icon.height > height) ? icon.height : height;
+         stride = (icon.stride > stride) ? icon.stride : stride;
+     }
+     if (width == 0U || height == 0U || width > max_extent || height > max_extent || stride > max_stride)
+     {
+         return false;
+     }
+
+     *scratch_bytes = 0U;
+     for (size_t i = 0U; i < count; ++i)
+     {
+         uint32_t bytes = static_cast<uint32_t>(icons[i].stride) * icons[i].height;
+         if (icons[i].stride != stride && GraphBitmapCache::is_compressed(icons[i]) && bytes > *scratch_bytes)
+         {
+             *scratch_bytes = bytes;
+         }
+     }
+
+     layout = icons[0];
+     layout.width = width;
+     layout.height = height;
+     layout.stride = stride;
+     layout.pixel_data = nullptr;
+     layout.length = 0U;
+     return true;
+ }
+
+ /**
+  * Fills one cell. Raw images are padded on the host and written directly;
+  * zlib images are queued as CMD_INFLATE, straight into the cell when the
+  * strides match, otherwise into the scratch block and copied row by row.
+  */
+ bool GraphBitmapAtlas::place(GraphCmdEncoder& out, const Device_definitions::bitmap_info_t& icon, uint32_t cell_addr,
+                              uint32_t scratch_addr)
+ {
+     uint32_t cell_bytes = static_cast<uint32_t>(layout.stride) * layout.height;
+     uint32_t icon_bytes = static_cast<uint32_t>(icon.stride) * icon.height;
+
+     if (!GraphBitmapCache::is_compressed(icon))
+     {
+         std::vector<uint8_t> image(cell_bytes, 0U);
+         for (uint32_t row = 0U; row < icon.height; ++row)
+         {
+             size_t at = static_cast<size_t>(row) * icon.stride;
+             if (at >= icon.length)
+             {
+                 break;
+             }
+             size_t n = (icon.length - at < icon.stride) ? (icon.length - at) : icon.stride;
+             (void)memcpy(&image[static_cast<size_t>(row) * layout.stride], icon.pixel_data + at, n);
+         }
+         return ft800.mem_write(cell_addr, image.data(), image.size());
+     }
+
+     if (icon.stride == layout.stride)
+     {
+         out.cmd_inflate(cell_addr, icon.pixel_data, icon.length);
+         if (icon_bytes < cell_bytes)
+         {
+             out.cmd_memzero(cell_addr + icon_bytes, cell_bytes - icon_bytes);
+         }
+         return true;
+     }
+
+     out.cmd_inflate(scratch_addr, icon.pixel_data, icon.length);
+     out.cmd_memzero(cell_addr, cell_bytes);
+     for (uint32_t row = 0U; row < icon.height; ++row)
+     {
+         out.cmd_memcpy(cell_addr + row * layout.stride, scratch_addr + row * icon.stride, icon.stride);
+     }
+     return true;
+ }
+
+ bool GraphBitmapAtlas::submit(const GraphCmdEncoder& out)
+ {
+     if (out.size() == 0U)
+     {
+         return true;
+     }
+     return (fifo != nullptr) ? fifo->write(out.data(), out.size()) : ft800.submit_cmds(out.data(), out.size());
+ }
+
+ /** Waits until the co-processor has executed everything queued so far. */
+ bool GraphBitmapAtlas::drain()
+ {
+     if (fifo != nullptr)
+     {
+         return fifo->wait_idle();
+     }
+     GraphWait waiter(ft800);
+     return waiter.wait_idle() == GraphWait::wait_result_t::WAIT_DONE;
+ }
+
+ /**
+  * Packs @p count icons into one block drawn through bitmap @p handle, cell
+  * n holding icons[n], and waits until they are decoded. Any previous atlas
+  * is released first. Fails if the icons differ in format, a zlib payload
+  * does not inflate on the host, the cell would exceed the BITMAP_LAYOUT /
+  * BITMAP_SIZE fields, or RAM_G is short; nothing is queued in those cases.
+  */
+ bool GraphBitmapAtlas::build(const Device_definitions::bitmap_info_t* icons, size_t count, uint8_t handle)
+ {
+     release();
+
+     uint32_t scratch_bytes = 0U;
+     if (handle >= GraphBitmapCache::handle_count || !measure(icons, count, &scratch_bytes))
+     {
+         return false;
+     }
+
+     uint32_t cell_bytes = static_cast<uint32_t>(layout.stride) * layout.height;
+     block = ram_g.allocate(cell_bytes * static_cast<uint32_t>(count));
+     if (scratch_bytes > 0U && block != GraphRamG::invalid_offset)
+     {
+         scratch = ram_g.allocate(scratch_bytes);
+     }
+     if (block == GraphRamG::invalid_offset || (scratch_bytes > 0U && scratch == GraphRamG::invalid_offset))
+     {
+         release();
+         return false;
+     }
+
+     GraphCmdEncoder encoder;
+     bool result = true;
+     for (size_t i = 0U; i < count && result; ++i)
+     {
+         result = place(encoder, icons[i], RAM_G + block + static_cast<uint32_t>(i) * cell_bytes, RAM_G + scratch);
+     }
+     result = result && submit(encoder);
+
+     // Until the queue drains, inflates and copies may still write the block
+     // or read the scratch; on failure both stay allocated until release().
+     if (!result || !drain())
+     {
+         return false;
+     }
+     if (scratch != GraphRamG::invalid_offset)
+     {
+         (void)ram_g.release(scratch);
+         scratch = GraphRamG::invalid_offset;
+     }
+
+     layout.ram_g_offset = RAM_G + block;
+     layout.handle = handle;
+     cells = static_cast<uint32_t>(count);
+     return true;
+ }
+
+ /** Frees the RAM_G block; the handle may then be given back to the cache. */
+ void GraphBitmapAtlas::release()
+ {
+     if (block != GraphRamG::invalid_offset)
+     {
+         (void)ram_g.release(block);
+         block = GraphRamG::invalid_offset;
+     }
+     if (scratch != GraphRamG::invalid_offset)
+     {
+         (void)ram_g.release(scratch);
+         scratch = GraphRamG::invalid_offset;
+     }
+     cells = 0U;
+     layout.ram_g_offset = 0U;
+     layout.handle = no_handle;
+ }
+
+ /** Configures the atlas handle; needed once per display list, before any draw(). */
+ void GraphBitmapAtlas::setup(GraphCmdEncoder& out) const
+ {
+     if (!is_built())
+     {
+         return;
+     }
+     out.bitmap_handle(layout.handle);
+     out.bitmap_source(layout.ram_g_offset);
+     out.bitmap_layout(layout.format, layout.stride, layout.height);
+     out.bitmap_size(layout.filter, layout.wrap_x, layout.wrap_y, layout.width, layout.height);
+ }
+
+ /** Draws one cell at (@p x, @p y); must sit inside BEGIN(BITMAPS). */
+ void GraphBitmapAtlas::draw(GraphCmdEncoder& out, uint16_t x, uint16_t y, uint8_t cell) const
+ {
+     if (cell < cells)
+     {
+         out.vertex2ii(x, y, layout.handle, cell);
+     }
+ }
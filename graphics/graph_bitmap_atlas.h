@@ -0,0 +1,89 @@
+/**
+ * @file graph_bitmap_atlas.h
+ * @brief Icon families packed into one RAM_G block and drawn by VERTEX2II cell.
+ */
+
+ #ifndef GRAPH_BITMAP_ATLAS_H
+ #define GRAPH_BITMAP_ATLAS_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include "graph_cmd_encoder.h"
+ #include "graph_ft800.h"
+ #include "graph_ram_g.h"
+ #include "graph_device_definitions.h"
+
+ class GraphCmdFifo;
+
+ /**
+  * Packs a family of icons, such as the battery levels, into one RAM_G
+  * block of equal cells behind a single bitmap handle. The handle is set up
+  * once per frame (BITMAP_SOURCE / LAYOUT / SIZE) and each icon is drawn
+  * with the cell field of VERTEX2II, so switching icon changes one word
+  * instead of the whole bitmap state.
+  *
+  * The atlas is built from an existing bitmap_info_t table, cell n holding
+  * icons[n]. All icons must share a pixel format; the cell is as large as
+  * the widest, tallest and longest-stride icon, and smaller icons sit in
+  * its top-left corner with zeroed (transparent for ARGB formats) padding.
+  * zlib payloads are decoded by CMD_INFLATE; an icon with a narrower stride
+  * than the cell is inflated to a scratch block and copied row by row with
+  * CMD_MEMCPY. CMD_INFLATE gives no error on a corrupt stream, so build()
+  * first inflates each payload on the host (with GRAPH_HAVE_ZLIB) and
+  * rejects the family if one fails. build() waits for the co-processor to finish, so a true
+  * result means every cell is in RAM_G; build once at start-up, not per
+  * frame.
+  *
+  * The handle is reserved in the bitmap cache so the two never share it.
+  * Battery_icons::low_icon has a corrupt payload, so the battery family is
+  * built from the other three levels:
+  *
+  *     cache.reserve_handle(14);
+  *     atlas.build(&Battery_icons::icons[1], Battery_icons::battery_icon_count - 1U, 14);
+  *     atlas.setup(encoder);                  // once per display list
+  *     encoder.begin(PRIM_BITMAPS);
+  *     atlas.draw(encoder, 440, 4, level);    // one VERTEX2II
+  *     encoder.end();
+  */
+ class GraphBitmapAtlas
+ {
+ public:
+     static const uint32_t max_cells = 128U;           //!< VERTEX2II cell field is 7 bits
+     static const uint8_t no_handle = 0xFFU;
+
+     GraphBitmapAtlas(GraphFt800& ft800, GraphRamG& ram_g);
+     ~GraphBitmapAtlas();
+
+     void attach_fifo(GraphCmdFifo* ring) { fifo = ring; }
+
+     bool build(const Device_definitions::bitmap_info_t* icons, size_t count, uint8_t handle);
+     void release();
+
+     void setup(GraphCmdEncoder& out) const;
+     void draw(GraphCmdEncoder& out, uint16_t x, uint16_t y, uint8_t cell) const;
+
+     bool is_built() const { return cells > 0U; }
+     uint32_t cell_count() const { return cells; }
+     uint8_t handle() const { return layout.handle; }
+     uint32_t size_bytes() const { return static_cast<uint32_t>(layout.stride) * layout.height * cells; }
+
+     /** One cell as a bitmap: cell 0's address, the handle and the shared layout. */
+     const Device_definitions::bitmap_info_t& cell_layout() const { return layout; }
+
+ private:
+     bool measure(const Device_definitions::bitmap_info_t* icons, size_t count, uint32_t* scratch_bytes);
+     bool place(GraphCmdEncoder& out, const Device_definitions::bitmap_info_t& icon, uint32_t cell_addr,
+                uint32_t scratch_addr);
+     bool submit(const GraphCmdEncoder& out);
+     bool drain();
+
+     GraphFt800& ft800;
+     GraphRamG& ram_g;
+     GraphCmdFifo* fifo;
+     Device_definitions::bitmap_info_t layout;   //!< Shared by every cell; pixel_data unused
+     uint32_t cells;
+     uint32_t block;                             //!< RAM_G allocation of the cells
+     uint32_t scratch;                           //!< Held while queued copies may still read it
+ };
+
+ #endif // GRAPH_BITMAP_ATLAS_H
@@ -0,0 +1,374 @@
+/**
+ * @file graph_bitmap_cache.cpp
+ * @brief RAM_G bitmap residency with LRU eviction.
+ */
+
+ #include <cstring>
+ #include <iterator>
+ #include <vector>
+ #ifdef GRAPH_HAVE_ZLIB
+ # include <zlib.h>
+ #endif
+ #include "graph_bitmap_cache.h"
+ #include "graph_cmd_encoder.h"
+ #include "graph_cmd_fifo.h"
+ #include "graph_ft800Reg.h"
+
+ GraphBitmapCache::GraphBitmapCache(GraphFt800& ft800, GraphRamG& ram_g)
+     : ft800(ft800), ram_g(ram_g), fifo(nullptr), upload_mode(upload_mode_t::COPROCESSOR_INFLATE), frame(1U)
+ {
+     (void)memset(handle_used, 0, sizeof(handle_used));
+     (void)memset(handle_reserved, 0, sizeof(handle_reserved));
+     (void)memset(&stats, 0, sizeof(stats));
+     ft800.add_fault_listener(this);
+ }
+
+ GraphBitmapCache::~GraphBitmapCache()
+ {
+     ft800.remove_fault_listener(this);
+ }
+
+ /** Starts a new frame; assets acquired from now on are protected from eviction. */
+ void GraphBitmapCache::begin_frame()
+ {
+     frame++;
+ }
+
+ /** Size of the decoded image in RAM_G. */
+ uint32_t GraphBitmapCache::image_bytes(const Device_definitions::bitmap_info_t& info)
+ {
+     return static_cast<uint32_t>(info.stride) * info.height;
+ }
+
+ GraphBitmapCache::entry_t* GraphBitmapCache::find(const uint8_t* pixel_data)
+ {
+     for (entry_t& entry : entries)
+     {
+         if (entry.placed.pixel_data == pixel_data)
+         {
+             return &entry;
+         }
+     }
+     return nullptr;
+ }
+
+ /**
+  * Makes an asset resident and returns a copy of its description with the
+  * RAM_G offset and handle actually assigned, or nullptr if it cannot fit.
+  */
+ const Device_definitions::bitmap_info_t* GraphBitmapCache::acquire(const Device_definitions::bitmap_info_t& info)
+ {
+     entry_t* entry = find(info.pixel_data);
+     if (entry != nullptr)
+     {
+         entry->last_used = frame;
+         stats.hits++;
+         return &entry->placed;
+     }
+
+     uint32_t bytes = image_bytes(info);
+     uint8_t handle = free_handle();
+     uint32_t offset = ram_g.allocate(bytes);
+     while (offset == GraphRamG::invalid_offset || handle == handle_count)
+     {
+         if (!evict_lru())
+         {
+             if (offset != GraphRamG::invalid_offset)
+             {
+                 (void)ram_g.release(offset);
+             }
+             stats.failures++;
+             return nullptr;
+         }
+         if (handle == handle_count)
+         {
+             handle = free_handle();
+         }
+         if (offset == GraphRamG::invalid_offset)
+         {
+             offset = ram_g.allocate(bytes);
+         }
+     }
+
+     entry_t fresh;
+     fresh.placed = info;
+     fresh.placed.ram_g_offset = RAM_G + offset;
+     fresh.placed.handle = handle;
+     fresh.last_used = frame;
+     fresh.queued = false;
+     fresh.queued_epoch = ft800.idle_epoch();
+
+     if (!upload(fresh.placed, &fresh.queued))
+     {
+         (void)ram_g.release(offset);
+         stats.failures++;
+         return nullptr;
+     }
+
+     handle_used[handle] = true;
+     entries.push_back(fresh);
+     stats.uploads++;
+     stats.resident = static_cast<uint32_t>(entries.size());
+     return &entries.back().placed;
+ }
+
+ /** Lowest free bitmap handle, or handle_count if all are taken. */
+ uint8_t GraphBitmapCache::free_handle() const
+ {
+     for (uint8_t h = 0U; h < handle_count; ++h)
+     {
+         if (!handle_used[h])
+         {
+             return h;
+         }
+     }
+     return handle_count;
+ }
+
+ /** True if the payload is a zlib stream (RFC 1950 header check). */
+ bool GraphBitmapCache::is_compressed(const Device_definitions::bitmap_info_t& info)
+ {
+     if (info.pixel_data == nullptr || info.length < 2U)
+     {
+         return false;
+     }
+     uint8_t cmf = info.pixel_data[0];
+     uint8_t flg = info.pixel_data[1];
+     return ((cmf & 0x0FU) == 8U) && ((cmf >> 4) <= 7U) &&
+            (((static_cast<uint32_t>(cmf) << 8) | flg) % 31U == 0U);
+ }
+
+ #ifdef GRAPH_HAVE_ZLIB
+ /**
+  * Inflates a zlib payload into @p image, which is already sized to the
+  * decoded image, and returns the bytes produced or 0 on a corrupt stream.
+  * Raw inflate past the 2-byte header: like CMD_INFLATE, the adler32
+  * trailer is not checked, so host and co-processor accept the same assets.
+  */
+ static size_t host_inflate(const Device_definitions::bitmap_info_t& info, std::vector<uint8_t>& image)
+ {
+     z_stream stream{};
+     stream.next_in = const_cast<Bytef*>(info.pixel_data + 2);
+     stream.avail_in = static_cast<uInt>(info.length - 2U);
+     stream.next_out = image.data();
+     stream.avail_out = static_cast<uInt>(image.size());
+
+     bool result = false;
+     if (inflateInit2(&stream, -MAX_WBITS) == Z_OK)
+     {
+         int status = inflate(&stream, Z_FINISH);
+         (void)inflateEnd(&stream);
+         result = (status == Z_STREAM_END) || (status == Z_BUF_ERROR && stream.avail_out == 0U);
+     }
+     return result ? static_cast<size_t>(stream.total_out) : 0U;
+ }
+ #endif
+
+ /**
+  * True unless @p info is a zlib payload that fails to inflate on the host.
+  * CMD_INFLATE reports nothing on a corrupt stream, so callers that queue
+  * it check here first. Without GRAPH_HAVE_ZLIB the payload is trusted.
+  */
+ bool GraphBitmapCache::inflates(const Device_definitions::bitmap_info_t& info)
+ {
+     if (!is_compressed(info))
+     {
+         return true;
+     }
+ #ifdef GRAPH_HAVE_ZLIB
+     std::vector<uint8_t> image(image_bytes(info));
+     return host_inflate(info, image) > 0U;
+ #else
+     return true;
+ #endif
+ }
+
+ /**
+  * Places the image in its RAM_G block using the configured path. @p queued
+  * is set when the co-processor still has to decode it.
+  */
+ bool GraphBitmapCache::upload(const Device_definitions::bitmap_info_t& placed, bool* queued)
+ {
+     if (!is_compressed(placed))
+     {
+         bool result = ft800.mem_write(placed.ram_g_offset, placed.pixel_data, placed.length);
+         if (result)
+         {
+             stats.bytes_uploaded += placed.length;
+             stats.bytes_decoded += placed.length;
+         }
+         return result;
+     }
+     if (upload_mode == upload_mode_t::CPU_INFLATE)
+     {
+         bool result = upload_cpu_inflate(placed);
+ #ifndef GRAPH_HAVE_ZLIB
+         *queued = result;
+ #endif
+         return result;
+     }
+     *queued = upload_inflate(placed);
+     return *queued;
+ }
+
+ /** Queues CMD_INFLATE with the compressed payload; the co-processor decodes it. */
+ bool GraphBitmapCache::upload_inflate(const Device_definitions::bitmap_info_t& placed)
+ {
+     GraphCmdEncoder encoder;
+     encoder.cmd_inflate(placed.ram_g_offset, placed.pixel_data, placed.length);
+
+     bool result = (fifo != nullptr) ? fifo->write(encoder.data(), encoder.size())
+                                     : ft800.submit_cmds(encoder.data(), encoder.size());
+     if (result)
+     {
+         stats.coprocessor_inflates++;
+         stats.bytes_uploaded += encoder.size_bytes();
+         stats.bytes_decoded += image_bytes(placed);
+     }
+     return result;
+ }
+
+ /** Inflates on the host and writes the decoded image. */
+ bool GraphBitmapCache::upload_cpu_inflate(const Device_definitions::bitmap_info_t& placed)
+ {
+ #ifdef GRAPH_HAVE_ZLIB
+     std::vector<uint8_t> image(image_bytes(placed));
+     size_t decoded = host_inflate(placed, image);
+     bool result = (decoded > 0U) && ft800.mem_write(placed.ram_g_offset, image.data(), decoded);
+     if (result)
+     {
+         stats.cpu_inflates++;
+         stats.bytes_uploaded += decoded;
+         stats.bytes_decoded += decoded;
+     }
+     return result;
+ #else
+     // Built without zlib: the co-processor is the only decoder available.
+     return upload_inflate(placed);
+ #endif
+ }
+
+ /** True if the asset is currently in RAM_G. */
+ bool GraphBitmapCache::is_resident(const Device_definitions::bitmap_info_t& info) const
+ {
+     for (const entry_t& entry : entries)
+     {
+         if (entry.placed.pixel_data == info.pixel_data)
+         {
+             return true;
+         }
+     }
+     return false;
+ }
+
+ /** Releases the RAM_G block and handle of one entry. */
+ void GraphBitmapCache::drop(std::list<entry_t>::iterator it)
+ {
+     (void)ram_g.release(it->placed.ram_g_offset - RAM_G);
+     handle_used[it->placed.handle] = false;
+     entries.erase(it);
+     stats.resident = static_cast<uint32_t>(entries.size());
+ }
+
+ /** Evicts the least recently used asset not needed by the current frame. */
+ bool GraphBitmapCache::evict_lru()
+ {
+     std::list<entry_t>::iterator victim = entries.end();
+     for (std::list<entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+     {
+         if (it->last_used != frame && (victim == entries.end() || it->last_used < victim->last_used))
+         {
+             victim = it;
+         }
+     }
+     if (victim == entries.end())
+     {
+         return false;
+     }
+     drop(victim);
+     stats.evictions++;
+     return true;
+ }
+
+ /** Explicitly evicts one asset. */
+ bool GraphBitmapCache::evict(const Device_definitions::bitmap_info_t& info)
+ {
+     for (std::list<entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+     {
+         if (it->placed.pixel_data == info.pixel_data)
+         {
+             drop(it);
+             stats.evictions++;
+             return true;
+         }
+     }
+     return false;
+ }
+
+ /** Forgets every resident asset, e.g. after RAM_G was lost. */
+ void GraphBitmapCache::evict_all()
+ {
+     while (!entries.empty())
+     {
+         drop(entries.begin());
+     }
+ }
+
+ /**
+  * Takes @p handle out of the pool for bitmaps managed elsewhere, such as a
+  * GraphBitmapAtlas; an asset currently on it is evicted.
+  */
+ bool GraphBitmapCache::reserve_handle(uint8_t handle)
+ {
+     if (handle >= handle_count || handle_reserved[handle])
+     {
+         return false;
+     }
+     for (std::list<entry_t>::iterator it = entries.begin(); it != entries.end(); ++it)
+     {
+         if (it->placed.handle == handle)
+         {
+             drop(it);
+             stats.evictions++;
+             break;
+         }
+     }
+     handle_used[handle] = true;
+     handle_reserved[handle] = true;
+     return true;
+ }
+
+ /** Returns a handle taken with reserve_handle() to the pool. */
+ bool GraphBitmapCache::release_handle(uint8_t handle)
+ {
+     if (handle >= handle_count || !handle_reserved[handle])
+     {
+         return false;
+     }
+     handle_used[handle] = false;
+     handle_reserved[handle] = false;
+     return true;
+ }
+
+ /**
+  * The co-processor was reset. Drops assets whose CMD_INFLATE was queued
+  * with no idle ring observed since, as it may never have executed.
+  */
+ void GraphBitmapCache::coprocessor_reset(uint32_t last_idle_epoch)
+ {
+     std::list<entry_t>::iterator it = entries.begin();
+     while (it != entries.end())
+     {
+         std::list<entry_t>::iterator next = std::next(it);
+         if (it->queued && it->queued_epoch == last_idle_epoch)
+         {
+             drop(it);
+             stats.lost_on_reset++;
+         }
+         else
+         {
+             it->queued = false;
+         }
+         it = next;
+     }
+ }
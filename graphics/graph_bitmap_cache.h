@@ -0,0 +1,120 @@
+/**
+ * @file graph_bitmap_cache.h
+ * @brief Keeps bitmaps resident in RAM_G across frames, with LRU eviction.
+ */
+
+ #ifndef GRAPH_BITMAP_CACHE_H
+ #define GRAPH_BITMAP_CACHE_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <list>
+ #include "graph_ft800.h"
+ #include "graph_ram_g.h"
+ #include "graph_device_definitions.h"
+ 
+ class GraphCmdFifo;
+
+ /**
+  * Maps bitmap assets (identified by their pixel data) to a RAM_G block and a
+  * bitmap handle. An asset is uploaded the first time it is acquired and
+  * stays resident until space or handles run out, at which point the least
+  * recently used asset not needed by the current frame is evicted.
+  * Pointers returned by acquire() stay valid until that asset is evicted.
+  *
+  * zlib payloads (such as the icon tables) are sent as-is behind CMD_INFLATE
+  * so only the compressed bytes cross SPI; CPU_INFLATE decodes on the host
+  * and writes the raw image instead (needs GRAPH_HAVE_ZLIB). Because the
+  * inflate sits in the command stream ahead of any frame using the bitmap,
+  * no wait is needed before drawing it.
+  *
+  * A co-processor reset (GraphFt800::recover()) leaves RAM_G intact, so
+  * resident assets are kept without re-uploading; only CMD_INFLATEs queued
+  * after the co-processor was last seen idle may not have run and are
+  * forgotten, to be uploaded again on their next acquire().
+  *
+  *     cache.begin_frame();
+  *     const auto* icon = cache.acquire(Battery_icons::full_icon);
+  *     if (icon) widget.set_placement(icon->ram_g_offset, icon->handle);
+  */
+ class GraphBitmapCache : public GraphFaultListener
+ {
+ public:
+     // Handle 15 is left to the co-processor, 16..31 are ROM fonts.
+     static const uint8_t handle_count = 15U;
+
+     enum class upload_mode_t : uint8_t
+     {
+         COPROCESSOR_INFLATE = 0,
+         CPU_INFLATE
+     };
+
+     struct stats_t
+     {
+         uint32_t hits;
+         uint32_t uploads;
+         uint32_t evictions;
+         uint32_t failures;
+         uint32_t coprocessor_inflates;
+         uint32_t cpu_inflates;
+         uint64_t bytes_uploaded;   //!< Bytes sent over SPI
+         uint64_t bytes_decoded;    //!< Bytes of image data placed in RAM_G
+         uint32_t resident;
+         uint32_t lost_on_reset;    //!< Queued inflates dropped by coprocessor_reset()
+     };
+
+     GraphBitmapCache(GraphFt800& ft800, GraphRamG& ram_g);
+     ~GraphBitmapCache();
+
+     void set_upload_mode(upload_mode_t mode) { upload_mode = mode; }
+     upload_mode_t get_upload_mode() const { return upload_mode; }
+     void attach_fifo(GraphCmdFifo* ring) { fifo = ring; }
+
+     static bool is_compressed(const Device_definitions::bitmap_info_t& info);
+     static bool inflates(const Device_definitions::bitmap_info_t& info);
+
+     void begin_frame();
+     const Device_definitions::bitmap_info_t* acquire(const Device_definitions::bitmap_info_t& info);
+     bool is_resident(const Device_definitions::bitmap_info_t& info) const;
+     bool evict(const Device_definitions::bitmap_info_t& info);
+     void evict_all();
+
+     bool reserve_handle(uint8_t handle);
+     bool release_handle(uint8_t handle);
+
+     void coprocessor_reset(uint32_t last_idle_epoch) override;
+
+     const stats_t& get_stats() const { return stats; }
+     GraphRamG::stats_t get_ram_stats() const { return ram_g.get_stats(); }
+
+ private:
+     struct entry_t
+     {
+         Device_definitions::bitmap_info_t placed;   //!< Copy with real offset and handle
+         uint32_t last_used;                         //!< Frame number of last acquire
+         bool queued;                                //!< Decoded by the co-processor
+         uint32_t queued_epoch;                      //!< GraphFt800::idle_epoch() at upload
+     };
+
+     static uint32_t image_bytes(const Device_definitions::bitmap_info_t& info);
+
+     entry_t* find(const uint8_t* pixel_data);
+     uint8_t free_handle() const;
+     bool evict_lru();
+     void drop(std::list<entry_t>::iterator it);
+     bool upload(const Device_definitions::bitmap_info_t& placed, bool* queued);
+     bool upload_inflate(const Device_definitions::bitmap_info_t& placed);
+     bool upload_cpu_inflate(const Device_definitions::bitmap_info_t& placed);
+
+     GraphFt800& ft800;
+     GraphRamG& ram_g;
+     GraphCmdFifo* fifo;
+     upload_mode_t upload_mode;
+     std::list<entry_t> entries;
+     bool handle_used[handle_count];
+     bool handle_reserved[handle_count];         //!< Taken out of the pool, e.g. by an atlas
+     uint32_t frame;
+     stats_t stats;
+ };
+
+ #endif // GRAPH_BITMAP_CACHE_H
@@ -0,0 +1,384 @@
+/**
+ * @file graph_cmd_batch.cpp
+ * @brief Widget lists packed into driver descriptors and sent through FT800_IOCTL_EXEC_CMDS.
+ */
+
+ #include <cerrno>
+ #include <cstring>
+ #include "graph_cmd_batch.h"
+ #include "graph_ft800Cmds.h"
+ #include "ft800_uapi.h"
+
+ // Longest label a descriptor carries; longer ones go as words.
+ static const size_t max_label = FT800_MAX_CMD_TEXT_LEN;
+
+ static uint32_t string_words(const char* text)
+ {
+     return static_cast<uint32_t>((((text != nullptr) ? strlen(text) : 0U) + 4U) / 4U);
+ }
+
+ /** True if @p options and @p font fit the descriptor's 8-bit fields. */
+ static bool fits_descriptor(uint16_t options, int16_t font)
+ {
+     return ((options & 0xFFU) == 0U) && (font >= 0) && (font <= 0xFF);
+ }
+
+ GraphCmdBatch::GraphCmdBatch()
+     : chunk(default_chunk), use_exec(true)
+ {
+     (void)memset(&stats, 0, sizeof(stats));
+ }
+
+ GraphCmdBatch::~GraphCmdBatch() {}
+
+ /** Forgets the list, keeping allocations and what was learnt about the driver. */
+ void GraphCmdBatch::reset()
+ {
+     descriptors.clear();
+     expanded_words.clear();
+     segments.clear();
+     words.reset();
+ }
+
+ size_t GraphCmdBatch::descriptor_count() const
+ {
+     return descriptors.size();
+ }
+
+ /** Grows the last segment if it is of the same kind, else opens a new one. */
+ void GraphCmdBatch::extend(bool raw, size_t index, size_t count)
+ {
+     if (!segments.empty() && segments.back().raw == raw)
+     {
+         segments.back().count += count;
+         return;
+     }
+     segment_t segment = {raw, index, count};
+     segments.push_back(segment);
+ }
+
+ /** Appends a zeroed descriptor that expands to the opcode plus @p words_after words. */
+ struct ft800_cmd& GraphCmdBatch::add(uint32_t token, int16_t x, int16_t y, uint16_t options, uint32_t words_after)
+ {
+     struct ft800_cmd cmd;
+     (void)memset(&cmd, 0, sizeof(cmd));
+     cmd.cmd = token;
+     cmd.x = static_cast<uint16_t>(x);
+     cmd.y = static_cast<uint16_t>(y);
+     cmd.options = static_cast<uint8_t>(options >> 8);
+     descriptors.push_back(cmd);
+     expanded_words.push_back(1U + words_after);
+     extend(false, descriptors.size() - 1U, 1U);
+     return descriptors.back();
+ }
+
+ /** Copies @p label into the descriptor, accounting for its RAM_CMD words. */
+ bool GraphCmdBatch::set_text(struct ft800_cmd& cmd, const char* label)
+ {
+     const char* s = (label != nullptr) ? label : "";
+     (void)strncpy(cmd.text, s, sizeof(cmd.text) - 1U);
+     expanded_words.back() += string_words(s);
+     return true;
+ }
+
+ void GraphCmdBatch::text(int16_t x, int16_t y, int16_t font, uint16_t options, const char* text)
+ {
+     if (fits_descriptor(options, font) && (text == nullptr || strlen(text) <= max_label))
+     {
+         struct ft800_cmd& cmd = add(token_text, x, y, options, 2U);
+         cmd.font = static_cast<uint8_t>(font);
+         (void)set_text(cmd, text);
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_text(x, y, font, options, text);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::button(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* text)
+ {
+     if (fits_descriptor(options, font) && (text == nullptr || strlen(text) <= max_label))
+     {
+         struct ft800_cmd& cmd = add(token_button, x, y, options, 3U);
+         cmd.w = static_cast<uint16_t>(w);
+         cmd.h = static_cast<uint16_t>(h);
+         cmd.font = static_cast<uint8_t>(font);
+         (void)set_text(cmd, text);
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_button(x, y, w, h, font, options, text);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n)
+ {
+     if (fits_descriptor(options, font))
+     {
+         struct ft800_cmd& cmd = add(token_number, x, y, options, 3U);
+         cmd.font = static_cast<uint8_t>(font);
+         cmd.arg = static_cast<uint32_t>(n);
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_number(x, y, font, options, n);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range)
+ {
+     if (fits_descriptor(options, 0))
+     {
+         struct ft800_cmd& cmd = add(token_slider, x, y, options, 4U);
+         cmd.w = static_cast<uint16_t>(w);
+         cmd.h = static_cast<uint16_t>(h);
+         cmd.val = val;
+         cmd.range = range;
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_slider(x, y, w, h, options, val, range);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, uint16_t state, const char* text)
+ {
+     if (fits_descriptor(options, font) && (text == nullptr || strlen(text) <= max_label))
+     {
+         struct ft800_cmd& cmd = add(token_toggle, x, y, options, 3U);
+         cmd.w = static_cast<uint16_t>(w);
+         cmd.font = static_cast<uint8_t>(font);
+         cmd.val = state;
+         (void)set_text(cmd, text);
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_toggle(x, y, w, font, options, state, text);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::clock(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t h, uint16_t m, uint16_t s, uint16_t ms)
+ {
+     if (fits_descriptor(options, 0))
+     {
+         struct ft800_cmd& cmd = add(token_clock, x, y, options, 4U);
+         cmd.w = static_cast<uint16_t>(r);
+         cmd.arg = h;
+         cmd.arg2 = m;
+         cmd.count = s;
+         cmd.val = ms;
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_clock(x, y, r, options, h, m, s, ms);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::dial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val)
+ {
+     if (fits_descriptor(options, 0))
+     {
+         struct ft800_cmd& cmd = add(token_dial, x, y, options, 3U);
+         cmd.w = static_cast<uint16_t>(r);
+         cmd.val = val;
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_dial(x, y, r, options, val);
+     extend(true, before, words.size() - before);
+ }
+
+ /** Keys; the pressed key in the low byte of @p options travels in arg. */
+ void GraphCmdBatch::keys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys)
+ {
+     if (fits_descriptor(options & 0xFF00U, font) && (keys == nullptr || strlen(keys) <= max_label))
+     {
+         struct ft800_cmd& cmd = add(token_keys, x, y, options, 3U);
+         cmd.w = static_cast<uint16_t>(w);
+         cmd.h = static_cast<uint16_t>(h);
+         cmd.font = static_cast<uint8_t>(font);
+         cmd.arg = options & 0xFFU;
+         (void)set_text(cmd, keys);
+         return;
+     }
+     size_t before = words.size();
+     words.cmd_keys(x, y, w, h, font, options, keys);
+     extend(true, before, words.size() - before);
+ }
+
+ void GraphCmdBatch::gradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1)
+ {
+     struct ft800_cmd& cmd = add(token_gradient, x0, y0, 0U, 4U);
+     cmd.w = static_cast<uint16_t>(x1);
+     cmd.h = static_cast<uint16_t>(y1);
+     cmd.color0 = rgb0;
+     cmd.color1 = rgb1;
+ }
+
+ /** The driver has no gauge token, so gauges always go as words. */
+ void GraphCmdBatch::gauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                           uint16_t val, uint16_t range)
+ {
+     size_t before = words.size();
+     words.cmd_gauge(x, y, r, options, major, minor, val, range);
+     extend(true, before, words.size() - before);
+ }
+
+ /** Appends pre-encoded co-processor or display-list words, kept in order with the widgets. */
+ void GraphCmdBatch::raw(const uint32_t* data, size_t count)
+ {
+     if (data == nullptr || count == 0U)
+     {
+         return;
+     }
+     size_t before = words.size();
+     words.append(data, count);
+     extend(true, before, words.size() - before);
+ }
+
+ /**
+  * Encodes one descriptor into the co-processor words the driver writes
+  * to RAM_CMD for it. Returns false for a token it does not know. Shared
+  * with GraphFt800Sim, which serves EXEC_CMDS through it.
+  */
+ bool GraphCmdBatch::expand(const struct ft800_cmd& cmd, GraphCmdEncoder& out)
+ {
+     char label[sizeof(cmd.text)];
+     (void)memcpy(label, cmd.text, sizeof(label));
+     label[sizeof(label) - 1U] = '\0';
+
+     int16_t x = static_cast<int16_t>(cmd.x);
+     int16_t y = static_cast<int16_t>(cmd.y);
+     int16_t w = static_cast<int16_t>(cmd.w);
+     int16_t h = static_cast<int16_t>(cmd.h);
+     uint16_t options = static_cast<uint16_t>(cmd.options << 8);
+
+     switch (cmd.cmd)
+     {
+     case token_text:     out.cmd_text(x, y, cmd.font, options, label); break;
+     case token_button:   out.cmd_button(x, y, w, h, cmd.font, options, label); break;
+     case token_number:   out.cmd_number(x, y, cmd.font, options, static_cast<int32_t>(cmd.arg)); break;
+     case token_slider:   out.cmd_slider(x, y, w, h, options, cmd.val, cmd.range); break;
+     case token_toggle:   out.cmd_toggle(x, y, w, cmd.font, options, cmd.val, label); break;
+     case token_dial:     out.cmd_dial(x, y, w, options, cmd.val); break;
+     case token_gradient: out.cmd_gradient(x, y, cmd.color0, w, h, cmd.color1); break;
+     case token_keys:
+         out.cmd_keys(x, y, w, h, cmd.font, static_cast<uint16_t>(options | (cmd.arg & 0xFFU)), label);
+         break;
+     case token_clock:
+         out.cmd_clock(x, y, w, options, static_cast<uint16_t>(cmd.arg), static_cast<uint16_t>(cmd.arg2),
+                       static_cast<uint16_t>(cmd.count), cmd.val);
+         break;
+     default:
+         return false;
+     }
+     return true;
+ }
+
+ /**
+  * Sends the list in order. Descriptor runs go through EXEC_CMDS in chunks
+  * of at most set_chunk() descriptors and max_chunk_bytes of expansion;
+  * word runs through SUBMIT_CMDS.
+  */
+ bool GraphCmdBatch::submit(GraphFt800& ft800)
+ {
+     stats.submits++;
+     if (!use_exec)
+     {
+         return submit_expanded(ft800);
+     }
+
+     bool result = true;
+     for (size_t i = 0U; result && i < segments.size(); ++i)
+     {
+         const segment_t& segment = segments[i];
+         if (segment.raw)
+         {
+             result = send_words(ft800, words.data() + segment.first, segment.count);
+         }
+         else
+         {
+             result = submit_descriptors(ft800, segment.first, segment.count);
+         }
+     }
+     return result;
+ }
+
+ bool GraphCmdBatch::submit_descriptors(GraphFt800& ft800, size_t first, size_t count)
+ {
+     size_t end = first + count;
+     size_t i = first;
+
+     while (i < end)
+     {
+         size_t n = 0U;
+         size_t bytes = 0U;
+         while (i + n < end && n < chunk &&
+                (n == 0U || bytes + expanded_words[i + n] * sizeof(uint32_t) <= max_chunk_bytes))
+         {
+             bytes += expanded_words[i + n] * sizeof(uint32_t);
+             n++;
+         }
+
+         if (use_exec)
+         {
+             graph_status_t status = ft800.exec_cmds(&descriptors[i], n);
+             if (status.ok())
+             {
+                 stats.exec_calls++;
+                 stats.descriptors += static_cast<uint32_t>(n);
+                 i += n;
+                 continue;
+             }
+             if (status.sys_errno != ENOTTY)
+             {
+                 return false;
+             }
+             // Driver without EXEC_CMDS: expand here from now on.
+             use_exec = false;
+             stats.fallbacks++;
+         }
+
+         scratch.reset();
+         for (size_t k = 0U; k < n; ++k)
+         {
+             (void)expand(descriptors[i + k], scratch);
+         }
+         if (!send_words(ft800, scratch.data(), scratch.size()))
+         {
+             return false;
+         }
+         i += n;
+     }
+     return true;
+ }
+
+ /** Expands the whole list and sends it as one SUBMIT_CMDS batch. */
+ bool GraphCmdBatch::submit_expanded(GraphFt800& ft800)
+ {
+     scratch.reset();
+     for (const segment_t& segment : segments)
+     {
+         if (segment.raw)
+         {
+             scratch.append(words.data() + segment.first, segment.count);
+             continue;
+         }
+         for (size_t k = 0U; k < segment.count; ++k)
+         {
+             (void)expand(descriptors[segment.first + k], scratch);
+         }
+     }
+     return (scratch.size() == 0U) || send_words(ft800, scratch.data(), scratch.size());
+ }
+
+ bool GraphCmdBatch::send_words(GraphFt800& ft800, const uint32_t* data, size_t count)
+ {
+     bool result = ft800.submit_cmds(data, count);
+     if (result)
+     {
+         stats.submit_calls++;
+         stats.raw_words += static_cast<uint32_t>(count);
+     }
+     return result;
+ }
@@ -0,0 +1,133 @@
+/**
+ * @file graph_cmd_batch.h
+ * @brief Widget lists packed into driver descriptors and sent through FT800_IOCTL_EXEC_CMDS.
+ */
+
+ #ifndef GRAPH_CMD_BATCH_H
+ #define GRAPH_CMD_BATCH_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <vector>
+ #include "graph_cmd_encoder.h"
+ #include "graph_ft800.h"
+
+ /**
+  * Collects widgets as struct ft800_cmd descriptors and hands them to the
+  * driver in chunks through EXEC_CMDS; the driver encodes each one into
+  * RAM_CMD. A screen of widgets then costs one syscall per chunk instead
+  * of one ioctl per widget.
+  *
+  * Descriptor fields as the driver decodes them (tokens from src/ft800.h;
+  * options travel as OPT_* >> 8, all widget options being multiples of 256):
+  *
+  *     text     x, y, font, options, text
+  *     button   x, y, w, h, font, options, text
+  *     number   x, y, font, options, arg = value
+  *     slider   x, y, w, h, options, val, range
+  *     toggle   x, y, w, font, options, val = state, text
+  *     clock    x, y, w = radius, options, arg = h, arg2 = m, count = s, val = ms
+  *     dial     x, y, w = radius, options, val
+  *     keys     x, y, w, h, font, options, text, arg = pressed key
+  *     gradient x, y, color0, w = x1, h = y1, color1
+  *
+  * Anything without a descriptor token (gauge, raw() words such as colours,
+  * labels longer than 63 characters) is kept in order as co-processor
+  * words and sent with SUBMIT_CMDS between descriptor chunks. A driver
+  * without EXEC_CMDS (ENOTTY) gets the whole list expanded in user space.
+  *
+  * Chunks are kept small on purpose. The driver writes a chunk to RAM_CMD
+  * before moving REG_CMD_WRITE, so the co-processor cannot start on it
+  * until the whole chunk is on the bus; one call for a 48-widget panel
+  * sends ~1 KB and then waits for the co-processor to go through it,
+  * slower than one ioctl per widget. A few hundred bytes per call keep
+  * the bus and the co-processor busy at the same time while still saving
+  * most of the syscalls.
+  *
+  *     GraphCmdBatch batch;
+  *     batch.raw(header.data(), header.size());     // DLSTART, clear, ...
+  *     batch.button(10, 10, 100, 40, 27, 0, "Start");
+  *     batch.slider(10, 80, 200, 10, 0, level, 100);
+  *     batch.submit(ft800);
+  */
+ class GraphCmdBatch
+ {
+ public:
+     static const size_t default_chunk = 8U;         //!< Descriptors per EXEC_CMDS call
+     static const size_t max_chunk_bytes = 256U;     //!< RAM_CMD bytes one call may expand to
+
+     // ft800_cmd.cmd tokens (src/ft800.h); not co-processor opcodes.
+     static const uint32_t token_text = 0x0C000000U;
+     static const uint32_t token_button = 0x0D000000U;
+     static const uint32_t token_number = 0x0E000000U;
+     static const uint32_t token_slider = 0x10000000U;
+     static const uint32_t token_toggle = 0x11000000U;
+     static const uint32_t token_clock = 0x12000000U;
+     static const uint32_t token_dial = 0x13000000U;
+     static const uint32_t token_keys = 0x1A000000U;
+     static const uint32_t token_gradient = 0xFFFFFF2DU;
+
+     struct stats_t
+     {
+         uint32_t submits;
+         uint32_t exec_calls;       //!< EXEC_CMDS ioctls
+         uint32_t submit_calls;     //!< SUBMIT_CMDS batches (raw words or fallback)
+         uint32_t descriptors;      //!< Sent as descriptors
+         uint32_t raw_words;        //!< Sent as co-processor words
+         uint32_t fallbacks;        //!< Driver without EXEC_CMDS detected
+     };
+
+     GraphCmdBatch();
+     ~GraphCmdBatch();
+
+     void reset();
+     void set_chunk(size_t descriptors) { chunk = (descriptors > 0U) ? descriptors : 1U; }
+
+     void text(int16_t x, int16_t y, int16_t font, uint16_t options, const char* text);
+     void button(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* text);
+     void number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n);
+     void slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range);
+     void toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, uint16_t state, const char* text);
+     void clock(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t h, uint16_t m, uint16_t s, uint16_t ms);
+     void dial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val);
+     void keys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys);
+     void gradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1);
+     void gauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                uint16_t val, uint16_t range);
+     void raw(const uint32_t* words, size_t count);
+
+     size_t descriptor_count() const;
+     size_t raw_word_count() const { return words.size(); }
+
+     bool submit(GraphFt800& ft800);
+     bool uses_exec_cmds() const { return use_exec; }
+     const stats_t& get_stats() const { return stats; }
+
+     static bool expand(const struct ft800_cmd& cmd, GraphCmdEncoder& out);
+
+ private:
+     struct segment_t
+     {
+         bool raw;        //!< Words in the raw encoder, else descriptors
+         size_t first;
+         size_t count;
+     };
+
+     struct ft800_cmd& add(uint32_t token, int16_t x, int16_t y, uint16_t options, uint32_t words_after);
+     bool set_text(struct ft800_cmd& cmd, const char* label);
+     void extend(bool raw, size_t index, size_t count);
+     bool submit_descriptors(GraphFt800& ft800, size_t first, size_t count);
+     bool submit_expanded(GraphFt800& ft800);
+     bool send_words(GraphFt800& ft800, const uint32_t* data, size_t count);
+
+     std::vector<struct ft800_cmd> descriptors;
+     std::vector<uint32_t> expanded_words;    //!< RAM_CMD words per descriptor
+     std::vector<segment_t> segments;
+     GraphCmdEncoder words;
+     GraphCmdEncoder scratch;
+     size_t chunk;
+     bool use_exec;
+     stats_t stats;
+ };
+
+ #endif // GRAPH_CMD_BATCH_H
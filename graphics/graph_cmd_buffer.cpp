@@ -0,0 +1,210 @@
+/**
+ * @file graph_cmd_buffer.cpp
+ * @brief Frame-scoped FT800 command buffer.
+ */
+
+ #include "graph_cmd_buffer.h"
+ #include "graph_cmd_fifo.h"
+
+ /** 64-bit FNV-1a over the encoded words. */
+ static uint64_t hash_words(const uint32_t* words, size_t count)
+ {
+     uint64_t hash = 0xCBF29CE484222325ULL;
+     for (size_t i = 0U; i < count; ++i)
+     {
+         uint32_t value = words[i];
+         for (uint32_t b = 0U; b < 4U; ++b)
+         {
+             hash ^= (value & 0xFFU);
+             hash *= 0x100000001B3ULL;
+             value >>= 8;
+         }
+     }
+     return hash;
+ }
+
+ GraphCmdBuffer::GraphCmdBuffer(GraphFt800& ft800)
+     : ft800(ft800), mode(submit_mode_t::SUBMIT_CMDS), fifo(nullptr),
+       skip_unchanged(false), last_frame_valid(false), last_frame_hash(0U), last_frame_size(0U),
+       frame_count(0U), skipped_count(0U), failure_count(0U),
+       recover_faults(false), good_hash(0U), sent_hash(0U), sent_valid(false), suspect_valid(false),
+       suspect_hash(0U), quarantine_valid(false), quarantine_hash(0U), recovery_count(0U), quarantined_count(0U)
+ {
+ }
+
+ GraphCmdBuffer::~GraphCmdBuffer() {}
+
+ /** Selects how frames reach the driver; PUSH_MMAP maps the staging area on first use. */
+ bool GraphCmdBuffer::set_submit_mode(submit_mode_t new_mode)
+ {
+     bool result = true;
+
+     if (new_mode == submit_mode_t::PUSH_MMAP)
+     {
+         result = ft800.map_staging();
+         if (result)
+         {
+             use_storage(ft800.staging_buffer(), ft800.staging_bytes() / sizeof(uint32_t));
+         }
+     }
+     else
+     {
+         result = (new_mode != submit_mode_t::FIFO_RING) || (fifo != nullptr);
+         if (result)
+         {
+             use_owned_storage();
+         }
+     }
+
+     if (result)
+     {
+         mode = new_mode;
+     }
+     return result;
+ }
+
+ /** Discards any pending words and opens a new display list. */
+ void GraphCmdBuffer::begin_frame()
+ {
+     reset();
+     cmd_dlstart();
+ }
+
+ /** Terminates the display list, swaps it in and submits the frame. */
+ bool GraphCmdBuffer::end_frame()
+ {
+     display();
+     cmd_swap();
+
+     uint64_t hash = hash_words(data(), size());
+     if (skip_unchanged && last_frame_valid && !overflowed() &&
+         hash == last_frame_hash && size() == last_frame_size)
+     {
+         reset();
+         skipped_count++;
+         return true;
+     }
+
+     if (recover_faults && mode == submit_mode_t::FIFO_RING && ft800.is_faulted())
+     {
+         // The ring takes words whether or not the co-processor is running;
+         // check before queueing a frame behind a fault.
+         (void)recover_from_fault(hash);
+     }
+     if (recover_faults && quarantine_valid && hash == quarantine_hash)
+     {
+         reset();
+         failure_count++;
+         quarantined_count++;
+         return false;
+     }
+
+     size_t frame_size = size();
+     if (recover_faults && !overflowed())
+     {
+         frame_copy.assign(data(), data() + size());
+     }
+     bool result = flush();
+     last_frame_valid = result;
+     if (result)
+     {
+         frame_count++;
+         last_frame_hash = hash;
+         last_frame_size = frame_size;
+         if (recover_faults)
+         {
+             // The frame before this one was accepted and followed; keep it for replay.
+             if (sent_valid)
+             {
+                 good_frame.swap(sent_frame);
+                 good_hash = sent_hash;
+                 suspect_valid = false;
+             }
+             sent_frame.swap(frame_copy);
+             sent_hash = hash;
+             sent_valid = true;
+         }
+     }
+     else if (recover_faults && mode != submit_mode_t::FIFO_RING && ft800.is_faulted())
+     {
+         (void)recover_from_fault(hash);
+     }
+     return result;
+ }
+
+ /** Submits a saved frame outside the encoder storage. */
+ bool GraphCmdBuffer::submit_copy(const std::vector<uint32_t>& words)
+ {
+     if (mode == submit_mode_t::FIFO_RING)
+     {
+         return (fifo != nullptr) && fifo->write(words.data(), words.size());
+     }
+     return ft800.submit_cmds(words.data(), words.size());
+ }
+
+ /**
+  * Resets the faulted co-processor, quarantines a frame that faulted it
+  * twice in a row and puts the last good frame back on screen.
+  */
+ bool GraphCmdBuffer::recover_from_fault(uint64_t rejected_hash)
+ {
+     uint64_t suspect = sent_valid ? sent_hash : rejected_hash;
+     if (suspect_valid && suspect == suspect_hash)
+     {
+         quarantine_valid = true;
+         quarantine_hash = suspect;
+     }
+     suspect_valid = true;
+     suspect_hash = suspect;
+     sent_valid = false;
+
+     if (!ft800.recover())
+     {
+         return false;
+     }
+     recovery_count++;
+
+     bool result = !good_frame.empty() && submit_copy(good_frame);
+     if (result)
+     {
+         last_frame_hash = good_hash;
+         last_frame_size = good_frame.size();
+     }
+     last_frame_valid = result;
+     return result;
+ }
+
+ /** Submits all pending words to the co-processor FIFO. */
+ bool GraphCmdBuffer::flush()
+ {
+     bool result = true;
+
+     if (overflowed())
+     {
+         // Frame did not fit the staging area; never push a truncated list.
+         result = false;
+         failure_count++;
+     }
+     else if (size() > 0U)
+     {
+         if (mode == submit_mode_t::PUSH_MMAP)
+         {
+             result = ft800.push_mmap(0U, static_cast<uint32_t>(size_bytes()));
+         }
+         else if (mode == submit_mode_t::FIFO_RING)
+         {
+             result = (fifo != nullptr) && fifo->write(data(), size());
+         }
+         else
+         {
+             result = ft800.submit_cmds(data(), size());
+         }
+         if (!result)
+         {
+             failure_count++;
+         }
+     }
+
+     reset();
+     return result;
+ }
@@ -0,0 +1,115 @@
+/**
+ * @file graph_cmd_buffer.h
+ * @brief Frame-scoped FT800 command buffer flushed with a single ioctl.
+ */
+
+ #ifndef GRAPH_CMD_BUFFER_H
+ #define GRAPH_CMD_BUFFER_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <vector>
+ #include "graph_cmd_encoder.h"
+ #include "graph_ft800.h"
+ 
+ class GraphCmdFifo;
+
+ /**
+  * Collects a whole frame in user space and hands it to the driver through
+  * FT800_IOCTL_SUBMIT_CMDS, instead of one legacy ioctl per primitive.
+  * In PUSH_MMAP mode the frame is encoded straight into the driver's mmap'ed
+  * staging area and pushed by offset/length, so nothing is copied from user space.
+  * In FIFO_RING mode frames are streamed through an attached GraphCmdFifo,
+  * without waiting for the previous frame to drain.
+  *
+  * With set_fault_recovery(true), when a submission fails because the
+  * co-processor faulted (REG_CMD_READ = 0xFFF), or in FIFO_RING mode when a
+  * status read before the frame shows the fault, the buffer resets it with
+  * GraphFt800::recover() and replays the last good frame so the screen is
+  * valid again within one frame time. A frame counts as good once a later
+  * frame was accepted after it. The frame that was in flight when the fault
+  * was found is the suspect; one that is suspected twice in a row is
+  * quarantined and refused from then on. GraphRenderThread turns recovery
+  * on for its buffer.
+  *
+  * With set_skip_unchanged(true) a frame identical to the last one sent is
+  * dropped instead of submitted. It is off by default so every end_frame()
+  * reaches the driver; whoever sets the buffer up turns it on, as
+  * GraphRenderThread does for the buffer it renders the scene into.
+  *
+  *     buffer.begin_frame();
+  *     buffer.clear_color_rgb(0, 0, 0);
+  *     buffer.clear(true, true, true);
+  *     buffer.cmd_button(...);
+  *     buffer.end_frame();
+  */
+ class GraphCmdBuffer : public GraphCmdEncoder
+ {
+ public:
+     enum class submit_mode_t : uint8_t
+     {
+         SUBMIT_CMDS = 0,
+         PUSH_MMAP,
+         FIFO_RING
+     };
+ 
+     explicit GraphCmdBuffer(GraphFt800& ft800);
+     ~GraphCmdBuffer();
+ 
+     void attach_fifo(GraphCmdFifo* ring) { fifo = ring; }
+     bool set_submit_mode(submit_mode_t new_mode);
+     submit_mode_t submit_mode() const { return mode; }
+
+     void begin_frame();
+     bool end_frame();
+     bool flush();
+
+     void set_skip_unchanged(bool enable) { skip_unchanged = enable; }
+     void invalidate() { last_frame_valid = false; }
+
+     uint32_t frames_submitted() const { return frame_count; }
+     uint32_t frames_skipped() const { return skipped_count; }
+     uint32_t submit_failures() const { return failure_count; }
+
+     /**
+      * Off by default. Replaying needs the frame's words after the encoder
+      * has moved on, so while enabled every end_frame() copies the whole
+      * frame into a host vector, PUSH_MMAP frames included, which gives up
+      * that mode's zero-copy path.
+      */
+     void set_fault_recovery(bool enable) { recover_faults = enable; }
+     uint32_t fault_recoveries() const { return recovery_count; }
+     uint32_t frames_quarantined() const { return quarantined_count; }
+
+ private:
+     bool submit_copy(const std::vector<uint32_t>& words);
+     bool recover_from_fault(uint64_t rejected_hash);
+
+     GraphFt800& ft800;
+     submit_mode_t mode;
+     GraphCmdFifo* fifo;
+     bool skip_unchanged;
+     bool last_frame_valid;
+     uint64_t last_frame_hash;
+     size_t last_frame_size;
+     uint32_t frame_count;
+     uint32_t skipped_count;
+     uint32_t failure_count;
+
+     // Fault recovery: last good frame, frame in flight, quarantine
+     bool recover_faults;
+     std::vector<uint32_t> good_frame;
+     std::vector<uint32_t> sent_frame;
+     std::vector<uint32_t> frame_copy;
+     uint64_t good_hash;
+     uint64_t sent_hash;
+     bool sent_valid;
+     bool suspect_valid;
+     uint64_t suspect_hash;
+     bool quarantine_valid;
+     uint64_t quarantine_hash;
+     uint32_t recovery_count;
+     uint32_t quarantined_count;
+ };
+
+ #endif // GRAPH_CMD_BUFFER_H
@@ -0,0 +1,514 @@
+/**
+ * @file graph_cmd_encoder.cpp
+ * @brief Encodes FT800 co-processor and display-list words in user space.
+ */
+
+ #include <cstdint>
+ #include <cstring>
+ #include "graph_cmd_encoder.h"
+ #include "graph_dl.h"
+ #include "graph_ft800Cmds.h"
+
+ static inline uint32_t pack16(int32_t lo, int32_t hi)
+ {
+     return (static_cast<uint32_t>(hi & 0xFFFF) << 16) | static_cast<uint32_t>(lo & 0xFFFF);
+ }
+
+ // A typical screen (icons, a dozen buttons) stays well under 1 KB.
+ static const size_t initial_owned_words = 256U;
+
+ GraphCmdEncoder::GraphCmdEncoder()
+     : storage(nullptr), external(false), capacity(0U), count(0U), overflow(false)
+ {
+ }
+
+ /** Encodes into a caller-owned block from the start; see use_storage(). */
+ GraphCmdEncoder::GraphCmdEncoder(uint32_t* buffer, size_t capacity_words)
+     : storage(nullptr), external(true), capacity(0U), count(0U), overflow(false)
+ {
+     use_storage(buffer, capacity_words);
+ }
+
+ GraphCmdEncoder::~GraphCmdEncoder() {}
+
+ /** Discards all encoded words, keeping the allocation. */
+ void GraphCmdEncoder::reset()
+ {
+     count = 0U;
+     overflow = false;
+ }
+
+ /**
+  * Encodes into caller-owned memory (e.g. an mmap'ed staging area) instead
+  * of the internal vector. Words that do not fit are dropped and flagged.
+  */
+ void GraphCmdEncoder::use_storage(uint32_t* buffer, size_t capacity_words)
+ {
+     storage = buffer;
+     external = true;
+     capacity = (buffer != nullptr) ? capacity_words : 0U;
+     reset();
+ }
+
+ /** Switches back to the internal, growable storage. */
+ void GraphCmdEncoder::use_owned_storage()
+ {
+     storage = owned.data();
+     external = false;
+     capacity = owned.size();
+     reset();
+ }
+
+ /** Returns the encoded words. */
+ const uint32_t* GraphCmdEncoder::data() const
+ {
+     return storage;
+ }
+
+ /** Returns the number of encoded words. */
+ size_t GraphCmdEncoder::size() const
+ {
+     return count;
+ }
+
+ /** Returns the number of encoded bytes. */
+ size_t GraphCmdEncoder::size_bytes() const
+ {
+     return count * sizeof(uint32_t);
+ }
+
+ /** True if words were dropped because fixed storage ran out. */
+ bool GraphCmdEncoder::overflowed() const
+ {
+     return overflow;
+ }
+
+ /** Makes room for @p extra more words, growing owned storage if needed. */
+ bool GraphCmdEncoder::reserve(size_t extra)
+ {
+     if ((count + extra) > capacity)
+     {
+         if (external)
+         {
+             overflow = true;
+             return false;
+         }
+         size_t new_size = (owned.size() > 0U) ? owned.size() * 2U : initial_owned_words;
+         while (new_size < (count + extra))
+         {
+             new_size *= 2U;
+         }
+         owned.resize(new_size);
+         storage = owned.data();
+         capacity = owned.size();
+     }
+     return true;
+ }
+
+ /** Appends one word. */
+ void GraphCmdEncoder::push(uint32_t value)
+ {
+     if (count < capacity || reserve(1U))
+     {
+         storage[count++] = value;
+     }
+ }
+
+ /** Appends one raw word. */
+ void GraphCmdEncoder::word(uint32_t value)
+ {
+     push(value);
+ }
+
+ /** Appends a block of pre-encoded words. */
+ void GraphCmdEncoder::append(const uint32_t* block, size_t block_count)
+ {
+     if (block != nullptr && block_count > 0U && reserve(block_count))
+     {
+         (void)memcpy(&storage[count], block, block_count * sizeof(uint32_t));
+         count += block_count;
+     }
+ }
+
+ /** Appends a NUL-terminated string padded to a 4-byte boundary. */
+ void GraphCmdEncoder::string(const char* text)
+ {
+     const char* s = (text != nullptr) ? text : "";
+     size_t length = strlen(s) + 1U;
+
+     for (size_t i = 0U; i < length; i += 4U)
+     {
+         uint32_t value = 0U;
+         for (size_t b = 0U; b < 4U && (i + b) < length; ++b)
+         {
+             value |= static_cast<uint32_t>(static_cast<uint8_t>(s[i + b])) << (8U * b);
+         }
+         push(value);
+     }
+ }
+
+ /** Appends raw bytes, zero-padded to a 4-byte boundary. */
+ void GraphCmdEncoder::bytes(const uint8_t* data, size_t len)
+ {
+     size_t whole = len / 4U;
+     size_t tail = len % 4U;
+
+     if (data == nullptr || !reserve(whole + ((tail != 0U) ? 1U : 0U)))
+     {
+         return;
+     }
+     for (size_t i = 0U; i < whole; ++i)
+     {
+         const uint8_t* b = &data[i * 4U];
+         push(static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+              (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24));
+     }
+     if (tail != 0U)
+     {
+         uint32_t value = 0U;
+         for (size_t b = 0U; b < tail; ++b)
+         {
+             value |= static_cast<uint32_t>(data[whole * 4U + b]) << (8U * b);
+         }
+         push(value);
+     }
+ }
+
+ /** Starts a new display list. */
+ void GraphCmdEncoder::cmd_dlstart()
+ {
+     push(CMD_DLSTART);
+ }
+
+ /** Swaps display list. */
+ void GraphCmdEncoder::cmd_swap()
+ {
+     push(CMD_SWAP);
+ }
+
+ /** Raises INT_CMDFLAG after @p delay_ms once the co-processor reaches this point. */
+ void GraphCmdEncoder::cmd_interrupt(uint32_t delay_ms)
+ {
+     push(CMD_INTERRUPT);
+     push(delay_ms);
+ }
+
+ /** Draws a button. */
+ void GraphCmdEncoder::cmd_button(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* text)
+ {
+     push(CMD_BUTTON);
+     push(pack16(x, y));
+     push(pack16(w, h));
+     push(pack16(font, options));
+     string(text);
+ }
+
+ /** Draws text. */
+ void GraphCmdEncoder::cmd_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char* text)
+ {
+     push(CMD_TEXT);
+     push(pack16(x, y));
+     push(pack16(font, options));
+     string(text);
+ }
+
+ /** Draws a spinner. */
+ void GraphCmdEncoder::cmd_spinner(int16_t x, int16_t y, uint16_t style, uint16_t scale)
+ {
+     push(CMD_SPINNER);
+     push(pack16(x, y));
+     push(pack16(style, scale));
+ }
+
+ /** Draws a slider; @p val runs from 0 to @p range. */
+ void GraphCmdEncoder::cmd_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range)
+ {
+     push(CMD_SLIDER);
+     push(pack16(x, y));
+     push(pack16(w, h));
+     push(pack16(options, val));
+     push(range);
+ }
+
+ /** Draws a toggle; @p text holds both labels separated by 0xFF. */
+ void GraphCmdEncoder::cmd_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, uint16_t state, const char* text)
+ {
+     push(CMD_TOGGLE);
+     push(pack16(x, y));
+     push(pack16(w, font));
+     push(pack16(options, state));
+     string(text);
+ }
+
+ /** Draws a rotary dial; @p val is the angle, 0 to 65535 for a full turn. */
+ void GraphCmdEncoder::cmd_dial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val)
+ {
+     push(CMD_DIAL);
+     push(pack16(x, y));
+     push(pack16(r, options));
+     push(val);
+ }
+
+ /** Draws a gauge with @p major / @p minor tick counts. */
+ void GraphCmdEncoder::cmd_gauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                                 uint16_t val, uint16_t range)
+ {
+     push(CMD_GAUGE);
+     push(pack16(x, y));
+     push(pack16(r, options));
+     push(pack16(major, minor));
+     push(pack16(val, range));
+ }
+
+ /** Draws an analogue clock face. */
+ void GraphCmdEncoder::cmd_clock(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t h, uint16_t m, uint16_t s, uint16_t ms)
+ {
+     push(CMD_CLOCK);
+     push(pack16(x, y));
+     push(pack16(r, options));
+     push(pack16(h, m));
+     push(pack16(s, ms));
+ }
+
+ /** Draws a row of keys, one per character of @p keys. */
+ void GraphCmdEncoder::cmd_keys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys)
+ {
+     push(CMD_KEYS);
+     push(pack16(x, y));
+     push(pack16(w, h));
+     push(pack16(font, options));
+     string(keys);
+ }
+
+ /** Draws a decimal number; the co-processor does the formatting. */
+ void GraphCmdEncoder::cmd_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n)
+ {
+     push(CMD_NUMBER);
+     push(pack16(x, y));
+     push(pack16(font, options));
+     push(static_cast<uint32_t>(n));
+ }
+
+ /** Fills the screen with a smooth gradient between two points (colours 0xRRGGBB). */
+ void GraphCmdEncoder::cmd_gradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1)
+ {
+     push(CMD_GRADIENT);
+     push(pack16(x0, y0));
+     push(rgb0);
+     push(pack16(x1, y1));
+     push(rgb1);
+ }
+
+ /** Draws a progress bar; @p val runs from 0 to @p range. */
+ void GraphCmdEncoder::cmd_progress(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range)
+ {
+     push(CMD_PROGRESS);
+     push(pack16(x, y));
+     push(pack16(w, h));
+     push(pack16(options, val));
+     push(range);
+ }
+
+ /** Draws a scroll bar whose thumb covers @p size of @p range. */
+ void GraphCmdEncoder::cmd_scrollbar(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val,
+                                     uint16_t size, uint16_t range)
+ {
+     push(CMD_SCROLLBAR);
+     push(pack16(x, y));
+     push(pack16(w, h));
+     push(pack16(options, val));
+     push(pack16(size, range));
+ }
+
+ /** Sets the widget foreground colour (0xRRGGBB) until the next CMD_DLSTART. */
+ void GraphCmdEncoder::cmd_fgcolor(uint32_t rgb)
+ {
+     push(CMD_FGCOLOR);
+     push(rgb);
+ }
+
+ /** Sets the widget background colour (0xRRGGBB). */
+ void GraphCmdEncoder::cmd_bgcolor(uint32_t rgb)
+ {
+     push(CMD_BGCOLOR);
+     push(rgb);
+ }
+
+ /** Sets the highlight colour of 3D buttons and keys (0xRRGGBB). */
+ void GraphCmdEncoder::cmd_gradcolor(uint32_t rgb)
+ {
+     push(CMD_GRADCOLOR);
+     push(rgb);
+ }
+
+ /**
+  * Tracks touches on the area tagged @p tag; REG_TRACKER then reports the
+  * slider position or dial angle. @p w = @p h = 1 tracks rotation about (x, y).
+  */
+ void GraphCmdEncoder::cmd_track(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t tag)
+ {
+     push(CMD_TRACK);
+     push(pack16(x, y));
+     push(pack16(w, h));
+     push(tag);
+ }
+
+ /** Starts calibration; the trailing word receives the result. */
+ void GraphCmdEncoder::cmd_calibrate()
+ {
+     push(CMD_CALIBRATE);
+     push(0U);
+ }
+
+ /** Decompresses a zlib stream into RAM_G at @p ptr on the co-processor. */
+ void GraphCmdEncoder::cmd_inflate(uint32_t ptr, const uint8_t* data, size_t len)
+ {
+     push(CMD_INFLATE);
+     push(ptr);
+     bytes(data, len);
+ }
+
+ /** Clears @p num bytes of RAM_G at @p ptr on the co-processor. */
+ void GraphCmdEncoder::cmd_memzero(uint32_t ptr, uint32_t num)
+ {
+     push(CMD_MEMZERO);
+     push(ptr);
+     push(num);
+ }
+
+ /** Copies @p num bytes within device memory on the co-processor, in command order. */
+ void GraphCmdEncoder::cmd_memcpy(uint32_t dest, uint32_t src, uint32_t num)
+ {
+     push(CMD_MEMCPY);
+     push(dest);
+     push(src);
+     push(num);
+ }
+
+ /** Begins a graphics primitive. */
+ void GraphCmdEncoder::begin(uint8_t primitive)
+ {
+     push(Graph_dl::begin(primitive));
+ }
+
+ /** Selects a bitmap handle and begins a bitmap drawing context. */
+ void GraphCmdEncoder::begin_bitmap(uint8_t handle)
+ {
+     bitmap_handle(handle);
+     begin(PRIM_BITMAPS);
+ }
+
+ /** Selects the bitmap handle used by following bitmap commands. */
+ void GraphCmdEncoder::bitmap_handle(uint8_t handle)
+ {
+     push(Graph_dl::bitmap_handle(handle));
+ }
+
+ /** Sets the RAM_G address of the current bitmap. */
+ void GraphCmdEncoder::bitmap_source(uint32_t addr)
+ {
+     push(Graph_dl::bitmap_source(addr));
+ }
+
+ /** Configures bitmap layout. */
+ void GraphCmdEncoder::bitmap_layout(uint16_t format, uint16_t linestride, uint16_t height)
+ {
+     push(Graph_dl::bitmap_layout(format, linestride, height));
+ }
+
+ /** Configures bitmap size. */
+ void GraphCmdEncoder::bitmap_size(uint8_t filter, uint8_t wrapx, uint8_t wrapy, uint16_t width, uint16_t height)
+ {
+     push(Graph_dl::bitmap_size(filter, wrapx, wrapy, width, height));
+ }
+
+ /** Selects the bitmap cell used by VERTEX2F. */
+ void GraphCmdEncoder::cell(uint8_t cell)
+ {
+     push(Graph_dl::cell(cell));
+ }
+
+ /** Clears screen with parameters. */
+ void GraphCmdEncoder::clear(bool c, bool s, bool t)
+ {
+     push(Graph_dl::clear(c, s, t));
+ }
+
+ /** Sets clear color using RGB. */
+ void GraphCmdEncoder::clear_color_rgb(uint8_t r, uint8_t g, uint8_t b)
+ {
+     push(Graph_dl::clear_color_rgb(r, g, b));
+ }
+
+ /** Sets the current drawing color. */
+ void GraphCmdEncoder::color_rgb(uint8_t r, uint8_t g, uint8_t b)
+ {
+     push(Graph_dl::color_rgb(r, g, b));
+ }
+
+ /** Sets the current drawing alpha. */
+ void GraphCmdEncoder::color_a(uint8_t alpha)
+ {
+     push(Graph_dl::color_a(alpha));
+ }
+
+ /** Sets point radius in 1/16 pixel. */
+ void GraphCmdEncoder::point_size(uint16_t size)
+ {
+     push(Graph_dl::point_size(size));
+ }
+
+ /** Sets line width in 1/16 pixel. */
+ void GraphCmdEncoder::line_width(uint16_t width)
+ {
+     push(Graph_dl::line_width(width));
+ }
+
+ /** Sets a tag for current context. */
+ void GraphCmdEncoder::tag(uint8_t tag)
+ {
+     push(Graph_dl::tag(tag));
+ }
+
+ /** Enables or disables writes to the tag buffer. */
+ void GraphCmdEncoder::tag_mask(bool mask)
+ {
+     push(Graph_dl::tag_mask(mask));
+ }
+
+ /** Emits a vertex in 1/16 pixel coordinates. */
+ void GraphCmdEncoder::vertex2f(int16_t x, int16_t y)
+ {
+     push(Graph_dl::vertex2f(x, y));
+ }
+
+ /** Emits a vertex in whole pixels with bitmap handle and cell. */
+ void GraphCmdEncoder::vertex2ii(uint16_t x, uint16_t y, uint8_t handle, uint8_t cell)
+ {
+     push(Graph_dl::vertex2ii(x, y, handle, cell));
+ }
+
+ /** Pushes the graphics context. */
+ void GraphCmdEncoder::save_context()
+ {
+     push(Graph_dl::save_context());
+ }
+
+ /** Pops the graphics context. */
+ void GraphCmdEncoder::restore_context()
+ {
+     push(Graph_dl::restore_context());
+ }
+
+ /** Signals end of display list. */
+ void GraphCmdEncoder::display()
+ {
+     push(Graph_dl::display());
+ }
+
+ /** Closes drawing group. */
+ void GraphCmdEncoder::end()
+ {
+     push(Graph_dl::end());
+ }
+
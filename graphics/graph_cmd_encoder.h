@@ -0,0 +1,110 @@
+/**
+ * @file graph_cmd_encoder.h
+ * @brief User-space encoder for FT800 co-processor and display-list words.
+ */
+
+ #ifndef GRAPH_CMD_ENCODER_H
+ #define GRAPH_CMD_ENCODER_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <vector>
+
+ /**
+  * Appends co-processor commands and display-list words to a contiguous
+  * buffer of 32-bit little-endian words, exactly as they are written to RAM_CMD.
+  * No device access happens here; see GraphCmdBuffer for submission.
+  * Storage is an internal vector, allocated on the first word, or any
+  * caller-owned block such as a stack array; an encoder built on one never
+  * touches the heap.
+  */
+ class GraphCmdEncoder
+ {
+ public:
+     GraphCmdEncoder();
+     GraphCmdEncoder(uint32_t* buffer, size_t capacity_words);
+     virtual ~GraphCmdEncoder();
+
+     // storage may point into owned, so a copy would alias the source's words.
+     GraphCmdEncoder(const GraphCmdEncoder&) = delete;
+     GraphCmdEncoder& operator=(const GraphCmdEncoder&) = delete;
+
+     void reset();
+     void use_storage(uint32_t* buffer, size_t capacity_words);
+     void use_owned_storage();
+     const uint32_t* data() const;
+     size_t size() const;
+     size_t size_bytes() const;
+     bool overflowed() const;
+
+     void word(uint32_t value);
+     void append(const uint32_t* words, size_t count);
+
+     // Co-processor commands
+     void cmd_dlstart();
+     void cmd_swap();
+     void cmd_interrupt(uint32_t delay_ms);
+     void cmd_button(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* text);
+     void cmd_text(int16_t x, int16_t y, int16_t font, uint16_t options, const char* text);
+     void cmd_spinner(int16_t x, int16_t y, uint16_t style, uint16_t scale);
+     void cmd_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range);
+     void cmd_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, uint16_t state, const char* text);
+     void cmd_dial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val);
+     void cmd_gauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                    uint16_t val, uint16_t range);
+     void cmd_clock(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t h, uint16_t m, uint16_t s, uint16_t ms);
+     void cmd_keys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys);
+     void cmd_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n);
+     void cmd_gradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1);
+     void cmd_progress(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range);
+     void cmd_scrollbar(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t size,
+                        uint16_t range);
+     void cmd_fgcolor(uint32_t rgb);
+     void cmd_bgcolor(uint32_t rgb);
+     void cmd_gradcolor(uint32_t rgb);
+     void cmd_track(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t tag);
+     void cmd_calibrate();
+     void cmd_inflate(uint32_t ptr, const uint8_t* data, size_t len);
+     void cmd_memzero(uint32_t ptr, uint32_t num);
+     void cmd_memcpy(uint32_t dest, uint32_t src, uint32_t num);
+
+     // Display-list words
+     void begin(uint8_t primitive);
+     void begin_bitmap(uint8_t handle);
+     void bitmap_handle(uint8_t handle);
+     void bitmap_source(uint32_t addr);
+     void bitmap_layout(uint16_t format, uint16_t linestride, uint16_t height);
+     void bitmap_size(uint8_t filter, uint8_t wrapx, uint8_t wrapy, uint16_t width, uint16_t height);
+     void cell(uint8_t cell);
+     void clear(bool c, bool s, bool t);
+     void clear_color_rgb(uint8_t r, uint8_t g, uint8_t b);
+     void color_rgb(uint8_t r, uint8_t g, uint8_t b);
+     void color_a(uint8_t alpha);
+     void point_size(uint16_t size);
+     void line_width(uint16_t width);
+     void tag(uint8_t tag);
+     void tag_mask(bool mask);
+     void vertex2f(int16_t x, int16_t y);
+     void vertex2ii(uint16_t x, uint16_t y, uint8_t handle, uint8_t cell);
+     void save_context();
+     void restore_context();
+     void display();
+     void end();
+
+ protected:
+     void push(uint32_t value);
+     bool reserve(size_t extra);
+     void string(const char* text);
+     void bytes(const uint8_t* data, size_t len);
+
+ private:
+     std::vector<uint32_t> owned;
+     uint32_t* storage;
+     bool external;     // storage is caller-owned and fixed in size
+     size_t capacity;
+     size_t count;
+     bool overflow;
+ };
+
+ #endif // GRAPH_CMD_ENCODER_H
+
@@ -0,0 +1,193 @@
+/**
+ * @file graph_cmd_fifo.cpp
+ * @brief Host-side RAM_CMD ring manager.
+ */
+
+ #include "graph_cmd_fifo.h"
+ #include "graph_ft800Reg.h"
+
+ static const uint32_t fifo_mask = GraphCmdFifo::fifo_size - 1U;
+
+ // The ring can never be completely full: REG_CMD_WRITE == REG_CMD_READ means empty.
+ static const uint32_t fifo_usable = GraphCmdFifo::fifo_size - sizeof(uint32_t);
+
+ // When the ring is full, wait for a useful amount of room rather than one word.
+ static const uint32_t min_wait_bytes = GraphCmdFifo::fifo_size / 4U;
+
+ GraphCmdFifo::GraphCmdFifo(GraphFt800& ft800)
+     : ft800(ft800), read_ptr(0U), write_ptr(0U), committed_ptr(0U), fault(false),
+       waiter(ft800), wraps(0U), stalls(0U)
+ {
+     ft800.add_fault_listener(this);
+ }
+
+ GraphCmdFifo::~GraphCmdFifo()
+ {
+     ft800.remove_fault_listener(this);
+ }
+
+ /** The co-processor was reset; both ring pointers are back at 0. */
+ void GraphCmdFifo::coprocessor_reset(uint32_t last_idle_epoch)
+ {
+     (void)last_idle_epoch;
+     read_ptr = 0U;
+     write_ptr = 0U;
+     committed_ptr = 0U;
+     fault = false;
+ }
+
+ /** Loads both pointers from the device, e.g. after a reset or CLEAR_DL. */
+ bool GraphCmdFifo::sync()
+ {
+     uint16_t rd = 0U;
+     uint16_t wr = 0U;
+     bool result = ft800.get_cmd_status(&rd, &wr);
+
+     if (result)
+     {
+         fault = (rd == fault_pointer);
+         read_ptr = rd & fifo_mask;
+         write_ptr = wr & fifo_mask;
+         committed_ptr = write_ptr;
+     }
+     return result && !fault;
+ }
+
+ /** Bytes that can be written without overtaking the co-processor. */
+ uint32_t GraphCmdFifo::free_space() const
+ {
+     return fifo_usable - used_space();
+ }
+
+ /** Bytes written but not yet consumed, as of the last read-pointer refresh. */
+ uint32_t GraphCmdFifo::used_space() const
+ {
+     return (static_cast<uint32_t>(write_ptr) - read_ptr) & fifo_mask;
+ }
+
+ /** Re-reads REG_CMD_READ and flags a co-processor fault. */
+ bool GraphCmdFifo::refresh_read_pointer()
+ {
+     uint16_t rd = 0U;
+     uint16_t wr = 0U;
+     bool result = ft800.get_cmd_status(&rd, &wr);
+
+     if (result)
+     {
+         if (rd == fault_pointer)
+         {
+             fault = true;
+             result = false;
+         }
+         else
+         {
+             read_ptr = rd & fifo_mask;
+         }
+     }
+     return result;
+ }
+
+ /** Publishes the host write pointer so the co-processor starts on new words. */
+ bool GraphCmdFifo::commit()
+ {
+     bool result = true;
+
+     if (committed_ptr != write_ptr)
+     {
+         result = ft800.write_reg32(REG_CMD_WRITE, write_ptr);
+         if (result)
+         {
+             committed_ptr = write_ptr;
+         }
+     }
+     return result;
+ }
+
+ /** Blocks until at least @p bytes are free, or the waiter policy times out. */
+ bool GraphCmdFifo::wait_for_space(uint32_t bytes)
+ {
+     bool result = true;
+     bool stalled = false;
+
+     waiter.start("fifo_space");
+     while (result && free_space() < bytes)
+     {
+         result = refresh_read_pointer();
+         if (result && free_space() < bytes)
+         {
+             stalled = true;
+             result = waiter.pause();
+         }
+     }
+     waiter.finish(result);
+
+     if (stalled)
+     {
+         stalls++;
+     }
+     return result;
+ }
+
+ /**
+  * Appends words to the ring. Only blocks if the ring is full; the write
+  * pointer is committed before any wait so the co-processor never starves.
+  */
+ bool GraphCmdFifo::write(const uint32_t* words, size_t count)
+ {
+     const uint8_t* bytes = reinterpret_cast<const uint8_t*>(words);
+     uint32_t remaining = static_cast<uint32_t>(count * sizeof(uint32_t));
+     bool result = !fault && (words != nullptr || count == 0U);
+
+     while (result && remaining > 0U)
+     {
+         uint32_t wanted = (remaining < fifo_usable) ? remaining : fifo_usable;
+         if (free_space() < wanted)
+         {
+             // Cached view is short: refresh before assuming we must block.
+             result = refresh_read_pointer();
+             if (result && free_space() < sizeof(uint32_t))
+             {
+                 uint32_t low_water = (wanted < min_wait_bytes) ? wanted : min_wait_bytes;
+                 result = commit() && wait_for_space(low_water);
+             }
+             if (!result)
+             {
+                 break;
+             }
+         }
+
+         uint32_t chunk = remaining;
+         if (chunk > free_space())
+         {
+             chunk = free_space();
+         }
+         if (chunk > (fifo_size - write_ptr))
+         {
+             chunk = fifo_size - write_ptr;
+         }
+
+         result = ft800.mem_write(RAM_CMD + write_ptr, bytes, chunk);
+         if (result)
+         {
+             write_ptr = static_cast<uint16_t>((write_ptr + chunk) & fifo_mask);
+             if (write_ptr == 0U)
+             {
+                 wraps++;
+             }
+             bytes += chunk;
+             remaining -= chunk;
+         }
+     }
+
+     if (result)
+     {
+         result = commit();
+     }
+     return result;
+ }
+
+ /** Blocks until the co-processor has consumed everything written so far. */
+ bool GraphCmdFifo::wait_idle()
+ {
+     return commit() && wait_for_space(fifo_usable);
+ }
@@ -0,0 +1,66 @@
+/**
+ * @file graph_cmd_fifo.h
+ * @brief Host-side mirror of the FT800 RAM_CMD ring (REG_CMD_READ / REG_CMD_WRITE).
+ */
+
+ #ifndef GRAPH_CMD_FIFO_H
+ #define GRAPH_CMD_FIFO_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include "graph_ft800.h"
+ #include "graph_wait.h"
+
+ /**
+  * Streams co-processor words into the 4 KB RAM_CMD ring while the
+  * co-processor is still executing earlier commands.
+  *
+  * The write pointer is owned by the host and only ever written; the read
+  * pointer is re-read from the device only when the cached free space is
+  * not enough for the next chunk. Writes that cross the end of the ring are
+  * split automatically. Blocking uses an adaptive GraphWait.
+  * After GraphFt800::recover() the mirror restarts at offset 0 with the
+  * fault cleared.
+  */
+ class GraphCmdFifo : public GraphFaultListener
+ {
+ public:
+     static const uint32_t fifo_size = 4096U;
+     static const uint16_t fault_pointer = 0x0FFFU;   //!< REG_CMD_READ after a co-processor fault
+     explicit GraphCmdFifo(GraphFt800& ft800);
+     ~GraphCmdFifo();
+
+     bool sync();
+     bool write(const uint32_t* words, size_t count);
+     bool wait_idle();
+
+     uint32_t free_space() const;
+     uint32_t used_space() const;
+     bool faulted() const { return fault; }
+
+     uint16_t read_pointer() const { return read_ptr; }
+     uint16_t write_pointer() const { return write_ptr; }
+
+     GraphWait& get_waiter() { return waiter; }
+
+     uint32_t wrap_count() const { return wraps; }
+     uint32_t stall_count() const { return stalls; }
+
+     void coprocessor_reset(uint32_t last_idle_epoch) override;
+
+ private:
+     bool refresh_read_pointer();
+     bool commit();
+     bool wait_for_space(uint32_t bytes);
+
+     GraphFt800& ft800;
+     uint16_t read_ptr;
+     uint16_t write_ptr;
+     uint16_t committed_ptr;
+     bool fault;
+     GraphWait waiter;
+     uint32_t wraps;
+     uint32_t stalls;
+ };
+
+ #endif // GRAPH_CMD_FIFO_H
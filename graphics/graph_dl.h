@@ -0,0 +1,174 @@
+/**
+ * @file graph_dl.h
+ * @brief Typed, constexpr encoders for FT800 display-list words.
+ */
+
+ #ifndef GRAPH_DL_H
+ #define GRAPH_DL_H
+
+ #include <cstdint>
+ #include "graph_ft800Cmds.h"
+
+ /**
+  * Replacements for the CLEAR_COLOR_RGB()/VERTEX2F()/... macros in
+  * src/ft800.h and src/ft800_regs.h. Every builder is constexpr, so a
+  * fragment declared as
+  *
+  *     static constexpr uint32_t frame[] = {
+  *         Graph_dl::clear_color_rgb(0, 0, 0),
+  *         Graph_dl::clear(true, true, true),
+  *         ...
+  *     };
+  *
+  * is encoded by the compiler and placed in .rodata. Arguments are range
+  * checked: in a constant expression an out-of-range value fails to compile;
+  * at run time (GraphCmdEncoder) it is masked to the field width as before.
+  */
+ namespace Graph_dl
+ {
+     // Deliberately not constexpr: reaching it in a constant expression is a
+     // compile error that names the problem.
+     inline void argument_out_of_range() {}
+
+     /** Returns @p value if it is within [lo, hi]. */
+     constexpr int32_t checked(int32_t value, int32_t lo, int32_t hi)
+     {
+         return (value >= lo && value <= hi) ? value : (argument_out_of_range(), value);
+     }
+
+     /** Returns @p value if it fits in @p bits unsigned bits. */
+     constexpr uint32_t checked(uint32_t value, uint32_t bits)
+     {
+         return (value <= ((1UL << bits) - 1U)) ? value : (argument_out_of_range(), value & ((1UL << bits) - 1U));
+     }
+
+     /** Packs an 8-bit opcode and its 24-bit operand. */
+     constexpr uint32_t op(uint32_t opcode, uint32_t operand)
+     {
+         return (opcode << 24) | (operand & 0x00FFFFFFU);
+     }
+
+     constexpr uint32_t display()
+     {
+         return op(DL_DISPLAY, 0U);
+     }
+
+     constexpr uint32_t clear(bool c, bool s, bool t)
+     {
+         return op(DL_CLEAR, (c ? 4U : 0U) | (s ? 2U : 0U) | (t ? 1U : 0U));
+     }
+
+     constexpr uint32_t clear_color_rgb(uint8_t r, uint8_t g, uint8_t b)
+     {
+         return op(DL_CLEAR_COLOR_RGB, (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b);
+     }
+
+     constexpr uint32_t clear_color_a(uint8_t alpha)
+     {
+         return op(DL_CLEAR_COLOR_A, alpha);
+     }
+
+     constexpr uint32_t clear_tag(uint8_t tag)
+     {
+         return op(DL_CLEAR_TAG, tag);
+     }
+
+     constexpr uint32_t color_rgb(uint8_t r, uint8_t g, uint8_t b)
+     {
+         return op(DL_COLOR_RGB, (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b);
+     }
+
+     constexpr uint32_t color_a(uint8_t alpha)
+     {
+         return op(DL_COLOR_A, alpha);
+     }
+
+     constexpr uint32_t tag(uint8_t tag)
+     {
+         return op(DL_TAG, tag);
+     }
+
+     constexpr uint32_t tag_mask(bool mask)
+     {
+         return op(DL_TAG_MASK, mask ? 1U : 0U);
+     }
+
+     /** @p primitive is one of the PRIM_* values. */
+     constexpr uint32_t begin(uint32_t primitive)
+     {
+         return op(DL_BEGIN, checked(primitive, 4U));
+     }
+
+     constexpr uint32_t end()
+     {
+         return op(DL_END, 0U);
+     }
+
+     constexpr uint32_t save_context()
+     {
+         return op(DL_SAVE_CONTEXT, 0U);
+     }
+
+     constexpr uint32_t restore_context()
+     {
+         return op(DL_RESTORE_CONTEXT, 0U);
+     }
+
+     /** Point radius in 1/16 pixel. */
+     constexpr uint32_t point_size(uint32_t size)
+     {
+         return op(DL_POINT_SIZE, checked(size, 13U));
+     }
+
+     /** Line width in 1/16 pixel. */
+     constexpr uint32_t line_width(uint32_t width)
+     {
+         return op(DL_LINE_WIDTH, checked(width, 12U));
+     }
+
+     constexpr uint32_t bitmap_handle(uint32_t handle)
+     {
+         return op(DL_BITMAP_HANDLE, checked(handle, 5U));
+     }
+
+     constexpr uint32_t bitmap_source(uint32_t addr)
+     {
+         return op(DL_BITMAP_SOURCE, checked(addr, 20U));
+     }
+
+     constexpr uint32_t bitmap_layout(uint32_t format, uint32_t linestride, uint32_t height)
+     {
+         return op(DL_BITMAP_LAYOUT,
+                   (checked(format, 5U) << 19) | (checked(linestride, 10U) << 9) | checked(height, 9U));
+     }
+
+     constexpr uint32_t bitmap_size(uint32_t filter, uint32_t wrapx, uint32_t wrapy, uint32_t width, uint32_t height)
+     {
+         return op(DL_BITMAP_SIZE,
+                   (checked(filter, 1U) << 20) | (checked(wrapx, 1U) << 19) | (checked(wrapy, 1U) << 18) |
+                   (checked(width, 9U) << 9) | checked(height, 9U));
+     }
+
+     constexpr uint32_t cell(uint32_t cell)
+     {
+         return op(DL_CELL, checked(cell, 7U));
+     }
+
+     /** Vertex in 1/16 pixel; each coordinate is a signed 15-bit value. */
+     constexpr uint32_t vertex2f(int32_t x, int32_t y)
+     {
+         return 0x40000000U |
+                ((static_cast<uint32_t>(checked(x, -16384, 16383)) & 0x7FFFU) << 15) |
+                (static_cast<uint32_t>(checked(y, -16384, 16383)) & 0x7FFFU);
+     }
+
+     /** Vertex in whole pixels (0..511) with bitmap handle and cell. */
+     constexpr uint32_t vertex2ii(uint32_t x, uint32_t y, uint32_t handle, uint32_t cell)
+     {
+         return 0x80000000U |
+                (checked(x, 9U) << 21) | (checked(y, 9U) << 12) |
+                (checked(handle, 5U) << 7) | checked(cell, 7U);
+     }
+ }
+
+ #endif // GRAPH_DL_H
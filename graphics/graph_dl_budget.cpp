@@ -0,0 +1,280 @@
+/**
+ * @file graph_dl_budget.cpp
+ * @brief Per-frame RAM_DL / RAM_CMD usage accounting and budget warnings.
+ */
+
+ #include <cstring>
+ #include "graph_dl_budget.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_ft800Reg.h"
+
+ GraphDlBudget::GraphDlBudget(GraphFt800& ft800)
+     : ft800(ft800), waiter(ft800), warning_percent(default_warning_percent), readback(false),
+       warning_stream(stderr), report(), stats()
+ {
+ }
+
+ GraphDlBudget::~GraphDlBudget() {}
+
+ /**
+  * Argument words after @p opcode and whether a NUL-terminated string
+  * follows them. Returns false for unknown opcodes and for CMD_INFLATE and
+  * CMD_LOADIMAGE, whose payload length is not encoded in the stream.
+  * CMD_MEMWRITE reports its two fixed arguments; the payload follows.
+  */
+ bool GraphDlBudget::command_layout(uint32_t opcode, uint32_t* args, bool* has_string)
+ {
+     *args = 0U;
+     *has_string = false;
+
+     switch (opcode)
+     {
+     case CMD_DLSTART:
+     case CMD_SWAP:
+     case CMD_STOP:
+     case CMD_LOADIDENTITY:
+     case CMD_SETMATRIX:
+     case CMD_SCREENSAVER:
+     case CMD_LOGO:
+     case CMD_COLDSTART:     break;
+     case CMD_INTERRUPT:
+     case CMD_BGCOLOR:
+     case CMD_FGCOLOR:
+     case CMD_GRADCOLOR:
+     case CMD_CALIBRATE:
+     case CMD_SNAPSHOT:
+     case CMD_GETPTR:
+     case CMD_ROTATE:        *args = 1U; break;
+     case CMD_SPINNER:
+     case CMD_REGREAD:
+     case CMD_MEMZERO:
+     case CMD_APPEND:
+     case CMD_TRANSLATE:
+     case CMD_SCALE:
+     case CMD_SETFONT:
+     case CMD_MEMWRITE:      *args = 2U; break;
+     case CMD_DIAL:
+     case CMD_NUMBER:
+     case CMD_MEMCRC:
+     case CMD_MEMSET:
+     case CMD_MEMCPY:
+     case CMD_GETPROPS:
+     case CMD_TRACK:         *args = 3U; break;
+     case CMD_GRADIENT:
+     case CMD_PROGRESS:
+     case CMD_SLIDER:
+     case CMD_SCROLLBAR:
+     case CMD_GAUGE:
+     case CMD_CLOCK:
+     case CMD_SKETCH:        *args = 4U; break;
+     case CMD_GETMATRIX:     *args = 6U; break;
+     case CMD_BITMAP_TRANSFORM: *args = 13U; break;
+     case CMD_TEXT:          *args = 2U; *has_string = true; break;
+     case CMD_BUTTON:
+     case CMD_KEYS:
+     case CMD_TOGGLE:        *args = 3U; *has_string = true; break;
+     default:
+         return false;
+     }
+     return true;
+ }
+
+ /**
+  * Display-list words a co-processor command leaves in RAM_DL. Measured
+  * on the FT800 with the default theme for typical sizes; long labels and
+  * large gauges use more.
+  */
+ uint32_t GraphDlBudget::widget_dl_words(uint32_t opcode, uint32_t text_length)
+ {
+     switch (opcode)
+     {
+     case CMD_TEXT:       return 4U + text_length;
+     case CMD_BUTTON:     return 14U + text_length;
+     case CMD_KEYS:       return 6U + 10U * text_length;
+     case CMD_TOGGLE:     return 20U + text_length;
+     case CMD_PROGRESS:   return 12U;
+     case CMD_SLIDER:
+     case CMD_SCROLLBAR:  return 16U;
+     case CMD_GAUGE:      return 60U;
+     case CMD_CLOCK:      return 50U;
+     case CMD_DIAL:
+     case CMD_CALIBRATE:  return 20U;
+     case CMD_NUMBER:     return 10U;
+     case CMD_SPINNER:    return 40U;
+     case CMD_GRADIENT:   return 30U;
+     case CMD_SETMATRIX:  return 6U;
+     default:             return 0U;
+     }
+ }
+
+ /**
+  * Walks an encoded co-processor stream and estimates the RAM_DL words it
+  * produces. Stops at a command whose length cannot be determined.
+  */
+ uint32_t GraphDlBudget::estimate_dl_words(const uint32_t* words, size_t count)
+ {
+     uint32_t total = 0U;
+     size_t i = 0U;
+
+     while (words != nullptr && i < count)
+     {
+         uint32_t word = words[i];
+         if ((word & 0xFFFFFF00U) != 0xFFFFFF00U)
+         {
+             total++;   // plain display-list word
+             i++;
+             continue;
+         }
+
+         uint32_t args = 0U;
+         bool has_string = false;
+         if (!command_layout(word, &args, &has_string) || i + 1U + args > count)
+         {
+             break;
+         }
+         size_t next = i + 1U + args;
+         uint32_t text_length = 0U;
+
+         if (has_string)
+         {
+             const uint8_t* text = reinterpret_cast<const uint8_t*>(&words[next]);
+             size_t text_bytes = (count - next) * sizeof(uint32_t);
+             const void* end = memchr(text, 0, text_bytes);
+             if (end == nullptr)
+             {
+                 break;
+             }
+             text_length = static_cast<uint32_t>(static_cast<const uint8_t*>(end) - text);
+             next += (text_length + 4U) / 4U;
+         }
+         else if (word == CMD_MEMWRITE)
+         {
+             next += (words[i + 2U] + 3U) / 4U;
+         }
+         else if (word == CMD_APPEND)
+         {
+             total += words[i + 2U] / 4U;
+         }
+         else if (word == CMD_DLSTART)
+         {
+             total = 0U;
+         }
+
+         total += widget_dl_words(word, text_length);
+         i = next;
+     }
+     return total;
+ }
+
+ /** Starts the report for a new frame. */
+ void GraphDlBudget::begin_frame()
+ {
+     report.frame = stats.frames;
+     report.cmd_bytes = 0U;
+     report.dl_bytes_estimated = 0U;
+     report.dl_bytes_measured = 0U;
+     report.measured = false;
+     report.over_threshold = false;
+     report.refused = false;
+     report.fault = false;
+     report.widgets.clear();
+ }
+
+ /** Records one widget's own fragment. */
+ void GraphDlBudget::add_widget(const char* kind, uint8_t tag, const uint32_t* words, size_t count)
+ {
+     widget_usage_t usage;
+     usage.kind = kind;
+     usage.tag = tag;
+     usage.cmd_words = static_cast<uint32_t>(count);
+     usage.dl_words = estimate_dl_words(words, count);
+     report.widgets.push_back(usage);
+ }
+
+ /**
+  * Checks a frame from CMD_DLSTART up to, but not including, the closing
+  * DISPLAY and CMD_SWAP against both budgets before it is submitted.
+  * Returns false if its display list cannot fit RAM_DL.
+  */
+ bool GraphDlBudget::admit(const uint32_t* frame_words, size_t count)
+ {
+     report.cmd_bytes = static_cast<uint32_t>((count + 2U) * sizeof(uint32_t));
+     report.dl_bytes_estimated = (estimate_dl_words(frame_words, count) + 1U) * 4U;
+     report.refused = report.dl_bytes_estimated > dl_budget_bytes;
+     return !report.refused;
+ }
+
+ /**
+  * Closes the frame: reads REG_CMD_DL back when the frame was submitted and
+  * readback is on, updates the statistics and warns if a threshold was
+  * crossed.
+  */
+ void GraphDlBudget::end_frame(bool submitted)
+ {
+     if (submitted && readback)
+     {
+         GraphWait::wait_result_t result = waiter.wait_idle();
+         uint32_t value = 0U;
+         if (result == GraphWait::wait_result_t::WAIT_FAULT)
+         {
+             report.fault = true;
+         }
+         else if (result == GraphWait::wait_result_t::WAIT_DONE && ft800.read_reg32(REG_CMD_DL, &value))
+         {
+             report.dl_bytes_measured = value;
+             report.measured = true;
+         }
+     }
+
+     uint32_t dl_bytes = report.measured ? report.dl_bytes_measured : report.dl_bytes_estimated;
+     report.over_threshold = report.refused || report.fault ||
+                             (dl_bytes * 100U >= dl_budget_bytes * warning_percent) ||
+                             (report.cmd_bytes * 100U >= cmd_budget_bytes * warning_percent);
+
+     stats.frames++;
+     stats.refused += report.refused ? 1U : 0U;
+     stats.faults += report.fault ? 1U : 0U;
+     stats.max_cmd_bytes = (report.cmd_bytes > stats.max_cmd_bytes) ? report.cmd_bytes : stats.max_cmd_bytes;
+     stats.max_dl_bytes = (dl_bytes > stats.max_dl_bytes) ? dl_bytes : stats.max_dl_bytes;
+     if (report.over_threshold)
+     {
+         stats.warnings++;
+         warn();
+     }
+ }
+
+ void GraphDlBudget::warn()
+ {
+     if (warning_stream != nullptr)
+     {
+         (void)fprintf(warning_stream, "ft800: frame %u %s display-list budget (warning at %u%%)\n", report.frame,
+                       report.refused ? "exceeds" : (report.fault ? "faulted at" : "is close to"), warning_percent);
+         print_report(warning_stream);
+     }
+ }
+
+ /** Writes the last frame's report, one line per widget. */
+ void GraphDlBudget::print_report(FILE* stream) const
+ {
+     if (stream == nullptr)
+     {
+         return;
+     }
+     uint32_t widget_cmd = 0U, widget_dl = 0U;
+     (void)fprintf(stream, "  %-10s %5s %9s %9s\n", "widget", "tag", "cmd words", "dl words");
+     for (const widget_usage_t& w : report.widgets)
+     {
+         (void)fprintf(stream, "  %-10s %5u %9u %9u\n", w.kind, w.tag, w.cmd_words, w.dl_words);
+         widget_cmd += w.cmd_words;
+         widget_dl += w.dl_words;
+     }
+     uint32_t frame_cmd = report.cmd_bytes / 4U;
+     uint32_t frame_dl = report.dl_bytes_estimated / 4U;
+     (void)fprintf(stream, "  %-10s %5s %9u %9u\n", "(frame)", "", (frame_cmd > widget_cmd) ? frame_cmd - widget_cmd : 0U,
+                   (frame_dl > widget_dl) ? frame_dl - widget_dl : 0U);
+     (void)fprintf(stream, "  RAM_CMD %u / %u bytes (%u%%), RAM_DL %u / %u bytes (%u%%) %s\n",
+                   report.cmd_bytes, cmd_budget_bytes, report.cmd_bytes * 100U / cmd_budget_bytes,
+                   report.measured ? report.dl_bytes_measured : report.dl_bytes_estimated, dl_budget_bytes,
+                   (report.measured ? report.dl_bytes_measured : report.dl_bytes_estimated) * 100U / dl_budget_bytes,
+                   report.measured ? "measured" : "estimated");
+ }
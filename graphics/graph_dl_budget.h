@@ -0,0 +1,113 @@
+/**
+ * @file graph_dl_budget.h
+ * @brief Per-frame RAM_DL / RAM_CMD usage accounting and budget warnings.
+ */
+
+ #ifndef GRAPH_DL_BUDGET_H
+ #define GRAPH_DL_BUDGET_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <cstdio>
+ #include <vector>
+ #include "graph_ft800.h"
+ #include "graph_wait.h"
+
+ /**
+  * Instrumented frame builder support. The FT800 display list is limited to
+  * 8 KB and the co-processor FIFO to 4 KB; running past either faults the
+  * co-processor (REG_CMD_READ = 0xFFF) and costs a reset.
+  *
+  * Attached to a GraphScene, every rendered frame gets a report with the
+  * co-processor and display-list words each visible widget contributes and
+  * the frame totals. Frames whose estimated display list does not fit are
+  * refused instead of submitted. With set_readback(true), REG_CMD_DL is
+  * read back once the co-processor has executed CMD_SWAP, giving the real
+  * RAM_DL use. Frames above the warning threshold (percent of either
+  * budget) print a warning with the per-widget breakdown.
+  *
+  *     GraphDlBudget budget(ft800);
+  *     budget.set_warning_threshold(85U);
+  *     budget.set_readback(true);        // tuning run only
+  *     scene.attach_budget(&budget);
+  *     scene.render(buffer);
+  *     budget.print_report(stdout);
+  *
+  * Display-list use of co-processor widgets is an estimate (per widget, plus
+  * per character for text); the read-back value is authoritative.
+  * The readback waits for the co-processor to go idle, so it serialises
+  * rendering and is off by default; without it, reports carry the estimate
+  * and co-processor faults are left to whoever waits on the FIFO.
+  */
+ class GraphDlBudget
+ {
+ public:
+     static const uint32_t dl_budget_bytes = 8U * 1024U;     // RAM_DL
+     static const uint32_t cmd_budget_bytes = 4U * 1024U - 4U; // RAM_CMD; one word stays free
+     static const uint8_t default_warning_percent = 90U;
+
+     struct widget_usage_t
+     {
+         const char* kind;
+         uint8_t tag;
+         uint32_t cmd_words;    //!< Words this widget adds to the co-processor stream
+         uint32_t dl_words;     //!< Estimated words it leaves in RAM_DL
+     };
+
+     struct report_t
+     {
+         uint32_t frame;
+         uint32_t cmd_bytes;            //!< Whole frame, DLSTART to SWAP
+         uint32_t dl_bytes_estimated;
+         uint32_t dl_bytes_measured;    //!< REG_CMD_DL after CMD_SWAP
+         bool measured;
+         bool over_threshold;
+         bool refused;                  //!< Estimated DL exceeded RAM_DL; not submitted
+         bool fault;                    //!< Co-processor reported 0xFFF
+         std::vector<widget_usage_t> widgets;
+     };
+
+     struct stats_t
+     {
+         uint32_t frames;
+         uint32_t warnings;
+         uint32_t refused;
+         uint32_t faults;
+         uint32_t max_cmd_bytes;
+         uint32_t max_dl_bytes;         //!< Largest measured (or estimated) display list
+     };
+
+     explicit GraphDlBudget(GraphFt800& ft800);
+     ~GraphDlBudget();
+
+     void set_warning_threshold(uint8_t percent) { warning_percent = (percent > 100U) ? 100U : percent; }
+     uint8_t get_warning_threshold() const { return warning_percent; }
+     void set_readback(bool enable) { readback = enable; }
+     void set_warning_stream(FILE* stream) { warning_stream = stream; }
+
+     void begin_frame();
+     void add_widget(const char* kind, uint8_t tag, const uint32_t* words, size_t count);
+     bool admit(const uint32_t* frame_words, size_t count);
+     void end_frame(bool submitted);
+
+     const report_t& last_report() const { return report; }
+     const stats_t& get_stats() const { return stats; }
+     void print_report(FILE* stream) const;
+
+     static bool command_layout(uint32_t opcode, uint32_t* args, bool* has_string);
+     static uint32_t widget_dl_words(uint32_t opcode, uint32_t text_length);
+     static uint32_t estimate_dl_words(const uint32_t* words, size_t count);
+
+ private:
+     void warn();
+
+     GraphFt800& ft800;
+     GraphWait waiter;
+     uint8_t warning_percent;
+     bool readback;
+     FILE* warning_stream;
+     report_t report;
+     stats_t stats;
+ };
+
+ #endif // GRAPH_DL_BUDGET_H
@@ -0,0 +1,216 @@
+/**
+ * @file graph_frame_pacer.cpp
+ * @brief Schedules frame submission against the display's real vsync.
+ */
+
+ #include <cstdint>
+ #include <ctime>
+ #include <unistd.h>
+ #include "graph_frame_pacer.h"
+ #include "graph_ft800Reg.h"
+
+ // REG_FRAMES is sampled this often while looking for an edge.
+ static const uint32_t edge_poll_us = 200U;
+ // Give up on an edge after this long: the display is not scanning out.
+ static const uint64_t edge_timeout_ns = 100000000ULL;
+ // Starting guess for encode + submit time, refined by frame_done().
+ static const uint64_t initial_lead_ns = 2000000ULL;
+ // A sample this close to a vsync may read either side of it, so REG_FRAMES
+ // one frame off the prediction is not treated as drift.
+ static const uint32_t drift_slack_frames = 1U;
+
+ GraphFramePacer::GraphFramePacer(GraphFt800& ft800)
+     : ft800(ft800), period_ns(0U), anchor_ns(0U), anchor_frames(0U),
+       lead_ns(initial_lead_ns), margin_ns(static_cast<uint64_t>(default_margin_us) * 1000U),
+       slot_ns(0U), last_slot_ns(0U), target_vsync_ns(0U), jitter_total_ns(0U), relock_pending(false), stats()
+ {
+ }
+
+ GraphFramePacer::~GraphFramePacer() {}
+
+ uint64_t GraphFramePacer::now_ns()
+ {
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+ }
+
+ void GraphFramePacer::sleep_until_ns(uint64_t when_ns)
+ {
+     struct timespec when;
+     when.tv_sec = static_cast<time_t>(when_ns / 1000000000ULL);
+     when.tv_nsec = static_cast<long>(when_ns % 1000000000ULL);
+     (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, nullptr);
+ }
+
+ /**
+  * Polls REG_FRAMES until it increments and timestamps the change halfway
+  * between the last two reads.
+  */
+ bool GraphFramePacer::wait_edge(uint32_t* frames, uint64_t* when_ns)
+ {
+     uint32_t first = 0U;
+     if (!ft800.read_reg32(REG_FRAMES, &first))
+     {
+         return false;
+     }
+     uint64_t before = now_ns();
+     uint64_t deadline = before + edge_timeout_ns;
+
+     while (before < deadline)
+     {
+         (void)usleep(edge_poll_us);
+         uint32_t value = 0U;
+         if (!ft800.read_reg32(REG_FRAMES, &value))
+         {
+             return false;
+         }
+         uint64_t after = now_ns();
+         if (value != first)
+         {
+             *frames = value;
+             *when_ns = before + (after - before) / 2U;
+             return true;
+         }
+         before = after;
+     }
+     return false;
+ }
+
+ /** Measures the refresh period over about @p window_ms and locks the phase. */
+ bool GraphFramePacer::calibrate(uint32_t window_ms)
+ {
+     uint32_t f0 = 0U, f1 = 0U;
+     uint64_t t0 = 0U, t1 = 0U;
+
+     if (!wait_edge(&f0, &t0))
+     {
+         return false;
+     }
+     (void)usleep(window_ms * 1000U);
+     if (!wait_edge(&f1, &t1) || f1 == f0)
+     {
+         return false;
+     }
+     period_ns = (t1 - t0) / (f1 - f0);
+     anchor_ns = t1;
+     anchor_frames = f1;
+     relock_pending = false;
+     stats.period_ns = period_ns;
+     return true;
+ }
+
+ /** First vsync strictly after @p after_ns on the calibrated grid. */
+ uint64_t GraphFramePacer::next_vsync_ns(uint64_t after_ns) const
+ {
+     if (after_ns < anchor_ns)
+     {
+         return anchor_ns;
+     }
+     return anchor_ns + ((after_ns - anchor_ns) / period_ns + 1U) * period_ns;
+ }
+
+ /**
+  * Sleeps until the latest point at which the next frame can still be
+  * submitted in time for a vsync. If that point has already passed for the
+  * coming vsync, aims for the one after. A re-lock flagged by frame_done()
+  * is done here first, where the caller is idle anyway.
+  */
+ bool GraphFramePacer::wait_for_slot()
+ {
+     if (!is_calibrated() && !calibrate())
+     {
+         return false;
+     }
+     if (relock_pending)
+     {
+         uint32_t frames = 0U;
+         uint64_t edge = 0U;
+         if (!wait_edge(&frames, &edge))
+         {
+             return false;
+         }
+         anchor_ns = edge;
+         anchor_frames = frames;
+         relock_pending = false;
+         stats.resyncs++;
+     }
+
+     uint64_t now = now_ns();
+     uint64_t budget = lead_ns + margin_ns;
+     uint64_t target = next_vsync_ns(now);
+     if (target < now + budget)
+     {
+         target += period_ns;
+     }
+     sleep_until_ns(target - budget);
+
+     last_slot_ns = slot_ns;
+     slot_ns = now_ns();
+     target_vsync_ns = target;
+     return true;
+ }
+
+ /**
+  * Call once the frame has been handed to the co-processor. Updates the
+  * lead estimate, miss and jitter counters, and checks the phase against
+  * REG_FRAMES with one read; it never waits for an edge itself.
+  */
+ bool GraphFramePacer::frame_done()
+ {
+     if (!is_calibrated() || slot_ns == 0U)
+     {
+         return false;
+     }
+     uint64_t done = now_ns();
+     uint64_t busy = done - slot_ns;
+
+     // Fast attack, slow decay: one slow frame widens the window at once.
+     lead_ns = (busy > lead_ns) ? busy : (lead_ns * 7U + busy) / 8U;
+
+     stats.frames++;
+     if (done > target_vsync_ns)
+     {
+         stats.missed_frames += static_cast<uint32_t>((done - target_vsync_ns) / period_ns + 1U);
+     }
+
+     if (last_slot_ns != 0U)
+     {
+         uint64_t interval = slot_ns - last_slot_ns;
+         uint64_t offset = interval % period_ns;
+         uint64_t jitter = (offset > period_ns / 2U) ? (period_ns - offset) : offset;
+         jitter_total_ns += jitter;
+         stats.jitter_avg_ns = jitter_total_ns / stats.frames;
+         if (jitter > stats.jitter_max_ns)
+         {
+             stats.jitter_max_ns = jitter;
+         }
+     }
+     stats.lead_ns = lead_ns;
+
+     // REG_FRAMES should still show the frame before the target vsync. If
+     // it is further off than the slack, the host clock and the panel have
+     // drifted apart: re-lock at the next wait_for_slot().
+     uint32_t frames = 0U;
+     if (!ft800.read_reg32(REG_FRAMES, &frames))
+     {
+         return false;
+     }
+     uint32_t predicted = anchor_frames + static_cast<uint32_t>((done - anchor_ns) / period_ns);
+     uint32_t drift = (frames > predicted) ? (frames - predicted) : (predicted - frames);
+     if (drift > drift_slack_frames && done < target_vsync_ns)
+     {
+         relock_pending = true;
+     }
+     return true;
+ }
+
+ /** Clears the counters, keeping the calibration and lead estimate. */
+ void GraphFramePacer::reset_stats()
+ {
+     stats = stats_t();
+     stats.period_ns = period_ns;
+     stats.lead_ns = lead_ns;
+     jitter_total_ns = 0U;
+     last_slot_ns = 0U;
+ }
@@ -0,0 +1,82 @@
+/**
+ * @file graph_frame_pacer.h
+ * @brief Schedules frame submission against the display's real vsync.
+ */
+
+ #ifndef GRAPH_FRAME_PACER_H
+ #define GRAPH_FRAME_PACER_H
+
+ #include <cstdint>
+ #include "graph_ft800.h"
+
+ /**
+  * Replaces "usleep(20 ms) to give the LCD a frame". calibrate() times
+  * REG_FRAMES edges to learn the refresh period and phase; wait_for_slot()
+  * then sleeps until just before the next vsync, leaving room for the
+  * measured encode/submit time, so CMD_SWAP lands at the coming frame
+  * boundary without idling a whole frame. frame_done() learns the submit
+  * time, counts frames that missed their vsync, and when REG_FRAMES is more
+  * than a frame from the prediction has the next wait_for_slot() re-lock
+  * the phase.
+  *
+  *     pacer.calibrate();
+  *     for (;;)
+  *     {
+  *         pacer.wait_for_slot();
+  *         scene.render(buffer);
+  *         pacer.frame_done();
+  *     }
+  */
+ class GraphFramePacer
+ {
+ public:
+     static const uint32_t default_calibration_ms = 250U;
+     static const uint32_t default_margin_us = 1000U;
+
+     struct stats_t
+     {
+         uint32_t frames;          //!< frame_done() calls
+         uint32_t missed_frames;   //!< vsyncs passed before a frame was submitted
+         uint32_t resyncs;         //!< Phase re-locks after drift
+         uint64_t period_ns;       //!< Measured refresh period
+         uint64_t lead_ns;         //!< Current submit-time estimate
+         uint64_t jitter_avg_ns;   //!< Mean slot deviation from the vsync grid
+         uint64_t jitter_max_ns;
+     };
+
+     explicit GraphFramePacer(GraphFt800& ft800);
+     ~GraphFramePacer();
+
+     bool calibrate(uint32_t window_ms = default_calibration_ms);
+     bool is_calibrated() const { return period_ns != 0U; }
+     uint64_t frame_period_ns() const { return period_ns; }
+     void set_margin_us(uint32_t margin_us) { margin_ns = static_cast<uint64_t>(margin_us) * 1000U; }
+
+     bool wait_for_slot();
+     bool frame_done();
+
+     const stats_t& get_stats() const { return stats; }
+     void reset_stats();
+
+ private:
+     static uint64_t now_ns();
+     static void sleep_until_ns(uint64_t when_ns);
+
+     bool wait_edge(uint32_t* frames, uint64_t* when_ns);
+     uint64_t next_vsync_ns(uint64_t after_ns) const;
+
+     GraphFt800& ft800;
+     uint64_t period_ns;
+     uint64_t anchor_ns;       //!< Host time of an observed REG_FRAMES edge
+     uint32_t anchor_frames;   //!< REG_FRAMES just after that edge
+     uint64_t lead_ns;
+     uint64_t margin_ns;
+     uint64_t slot_ns;         //!< When the current slot opened
+     uint64_t last_slot_ns;
+     uint64_t target_vsync_ns;
+     uint64_t jitter_total_ns;
+     bool relock_pending;      //!< Drift seen; re-lock in wait_for_slot()
+     stats_t stats;
+ };
+
+ #endif // GRAPH_FRAME_PACER_H
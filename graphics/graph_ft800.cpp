@@ -6,135 +6,310 @@
  * Provides all FT800 operations through a safe user-space wrapper.
  */
 
- #include <fcntl.h>
- #include <unistd.h>
- #include <sys/ioctl.h>
+ #include <poll.h>
+ #include <algorithm>
+ #include <cerrno>
+ #include <ctime>
  #include <cstdio>
  #include <cstdint>
  #include <cstring>
+ #include <endian.h>
+ #include <sys/ioctl.h>
  #include "graph_ft800.h"
+ #include "graph_cmd_encoder.h"
  #include "graph_ft800_ioctl.h"  // IOCTL command definitions and structures
+ #include "graph_ft800Reg.h"
+ #include "trace.h"
+ #include "ft800_uapi.h"         // FT800_IOCTL_* (SUBMIT_CMDS, PUSH_MMAP, MEMREAD, ...)
+ 
+ // Largest single SUBMIT_CMDS transfer: the 4 KB RAM_CMD ring less one word,
+ // since REG_CMD_WRITE may never catch up with REG_CMD_READ.
+ static const size_t max_submit_bytes = 4096U - sizeof(uint32_t);
+
+ // Label words of an immediately drawn widget: 63 characters and the NUL,
+ // the same limit as the legacy button and text ioctls.
+ static const size_t max_label_words = 16U;
+
+ // Not an ioctl: reads through the driver's pread() are accounted under this id.
+ static const unsigned long pread_request = 0xFFFFFFFFUL;
+
+ // Low byte of REG_ID on every FT800.
+ static const uint32_t ft800_chip_id = 0x7CU;
+
+ const GraphFt800::retry_policy_t GraphFt800::default_retry_policy = {4U, 50U, 2000U};
+
+ thread_local GraphFt800::call_status_t GraphFt800::last_call = {nullptr, {graph_error_t::NONE, 0, 0U}};
+
+ // Requests with their own statistics; anything else is counted as "other".
+ static const struct
+ {
+     unsigned long request;
+     const char* name;
+ } ioctl_names[] = {
+     {FT800_IOCTL_SUBMIT_CMDS,     "SUBMIT_CMDS"},
+     {FT800_IOCTL_PUSH_MMAP,       "PUSH_MMAP"},
+     {FT800_IOCTL_EXEC_CMDS,       "EXEC_CMDS"},
+     {FT800_IOCTL_GET_STATUS,      "GET_STATUS"},
+     {FT800_IOCTL_MEMREAD,         "MEMREAD"},
+     {pread_request,               "PREAD"},
+     {FT800_IOCTL_MEMWRITE,        "MEMWRITE"},
+     {FT800_IOC_INITIALISE,        "INITIALISE"},
+     {FT800_IOC_CMD_DLSTART,       "CMD_DLSTART"},
+     {FT800_IOC_CMD_SWAP,          "CMD_SWAP"},
+     {FT800_IOC_CMD_BUTTON,        "CMD_BUTTON"},
+     {FT800_IOC_CMD_TEXT,          "CMD_TEXT"},
+     {FT800_IOC_CMD_SPINNER,       "CMD_SPINNER"},
+     {FT800_IOC_CMD_CALIBRATE,     "CMD_CALIBRATE"},
+     {FT800_IOC_BEGIN_BITMAP,      "BEGIN_BITMAP"},
+     {FT800_IOC_BITMAP_LAYOUT,     "BITMAP_LAYOUT"},
+     {FT800_IOC_BITMAP_SIZE,       "BITMAP_SIZE"},
+     {FT800_IOC_CLEAR,             "CLEAR"},
+     {FT800_IOC_CLEAR_COLOR_RGB,   "CLEAR_COLOR_RGB"},
+     {FT800_IOC_DISPLAY,           "DISPLAY"},
+     {FT800_IOC_END,               "END"},
+     {FT800_IOC_GET_TOUCH_RAW,     "GET_TOUCH_RAW"},
+     {FT800_IOC_GET_TOUCH_SCREEN,  "GET_TOUCH_SCREEN"},
+     {FT800_IOC_GET_TOUCH_TAG,     "GET_TOUCH_TAG"},
+     {FT800_IOC_SET_TAG,           "SET_TAG"},
+     {FT800_IOC_FIFO_EMPTY,        "FIFO_EMPTY"},
+     {FT800_IOC_UPDATE_FIFO_PTR,   "UPDATE_FIFO_PTR"},
+     {FT800_IOC_LOAD_BITMAP,       "LOAD_BITMAP"},
+     {FT800_IOC_SET_CALIBRATION,   "SET_CALIBRATION"},
+     {FT800_IOC_GET_CAL_STATUS,    "GET_CAL_STATUS"},
+ };
+ static const size_t known_ioctls = sizeof(ioctl_names) / sizeof(ioctl_names[0]);
+
+ static uint64_t timespec_ns(const struct timespec& t)
+ {
+     return static_cast<uint64_t>(t.tv_sec) * 1000000000ULL + static_cast<uint64_t>(t.tv_nsec);
+ }
+
+ static uint64_t elapsed_ns(const struct timespec& start, const struct timespec& end)
+ {
+     return static_cast<uint64_t>(end.tv_sec - start.tv_sec) * 1000000000ULL +
+            static_cast<uint64_t>(end.tv_nsec) - static_cast<uint64_t>(start.tv_nsec);
+ }
  
  GraphFt800::GraphFt800(const char* device_path)
-     : fd(-1), display_initialised(false), write_index(0)
+     : transport(nullptr), display_initialised(false), write_index(0), staging(nullptr), staging_size(0U),
+       idle_count(0U), fault_stats(), retry(default_retry_policy),
+       ioctl_stats(), last_stats(0U), pending_interrupts(0U), use_pread(false), pread_probed(false),
+       burst_gap(default_burst_gap)
  {
-     if (device_path != nullptr)
-     {
-         fd = open(device_path, O_RDWR);
-     }
+     init_ioctl_stats();
+     owned_transport.reset(new GraphDeviceTransport(device_path));
+     transport = owned_transport.get();
+ }
+ 
+ /** Drives the FT800 through @p device_transport (e.g. GraphFt800Sim) instead of /dev/ft800. */
+ GraphFt800::GraphFt800(GraphTransport& device_transport)
+     : transport(&device_transport), display_initialised(false), write_index(0), staging(nullptr), staging_size(0U),
+       idle_count(0U), fault_stats(), retry(default_retry_policy),
+       ioctl_stats(), last_stats(0U), pending_interrupts(0U), use_pread(false), pread_probed(false),
+       burst_gap(default_burst_gap)
+ {
+     init_ioctl_stats();
  }
  
  GraphFt800::~GraphFt800()
  {
-     if (fd >= 0)
-     {
-         (void)close(fd);
-     }
+     unmap_staging();
  }
  
  /** Initializes the FT800 display. */
  bool GraphFt800::initialise()
  {
-     int status = ioctl(fd, FT800_IOC_INITIALISE);
-     display_initialised = (status == 0);
+     display_initialised = call(FT800_IOC_INITIALISE, nullptr).ok();
      return display_initialised;
  }
  
  /** Starts a new display list. */
- void GraphFt800::cmd_dlstart()
+ graph_status_t GraphFt800::cmd_dlstart()
  {
-     (void)ioctl(fd, FT800_IOC_CMD_DLSTART);
+     return call(FT800_IOC_CMD_DLSTART, nullptr);
  }
  
  /** Swaps display list. */
- void GraphFt800::cmd_swap()
+ graph_status_t GraphFt800::cmd_swap()
  {
-     (void)ioctl(fd, FT800_IOC_CMD_SWAP);
+     return call(FT800_IOC_CMD_SWAP, nullptr);
  }
  
  /** Draws a button. */
- void GraphFt800::cmd_button(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t font, uint16_t options, const char* text)
+ graph_status_t GraphFt800::cmd_button(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t font, uint16_t options, const char* text)
  {
      struct ft800_cmd_button args = {x, y, w, h, font, options};
      (void)strncpy(args.text, text, sizeof(args.text) - 1);
      args.text[sizeof(args.text) - 1] = '\0';
-     (void)ioctl(fd, FT800_IOC_CMD_BUTTON, &args);
+     return call(FT800_IOC_CMD_BUTTON, &args);
  }
  
  /** Draws text. */
- void GraphFt800::cmd_text(uint16_t x, uint16_t y, uint16_t font, uint16_t options, const char* text)
+ graph_status_t GraphFt800::cmd_text(uint16_t x, uint16_t y, uint16_t font, uint16_t options, const char* text)
  {
      struct ft800_cmd_text args = {x, y, font, options};
      (void)strncpy(args.text, text, sizeof(args.text) - 1);
      args.text[sizeof(args.text) - 1] = '\0';
-     (void)ioctl(fd, FT800_IOC_CMD_TEXT, &args);
+     return call(FT800_IOC_CMD_TEXT, &args);
  }
  
  /** Draws a spinner. */
- void GraphFt800::cmd_spinner(uint16_t x, uint16_t y, uint16_t style, uint16_t scale)
+ graph_status_t GraphFt800::cmd_spinner(uint16_t x, uint16_t y, uint16_t style, uint16_t scale)
  {
      struct ft800_cmd_spinner args = {x, y, style, scale};
-     (void)ioctl(fd, FT800_IOC_CMD_SPINNER, &args);
+     return call(FT800_IOC_CMD_SPINNER, &args);
+ }
+
+ // The driver has no ioctl per widget beyond button, text and spinner: the
+ // others are encoded here and written with SUBMIT_CMDS. Screens with many
+ // widgets should build one GraphCmdEncoder frame instead.
+
+ /** Sends one encoded command; the words fit the stack buffer of the caller. */
+ graph_status_t GraphFt800::submit_encoded(const GraphCmdEncoder& encoder)
+ {
+     if (!check_argument(!encoder.overflowed()))
+     {
+         return last_status();
+     }
+     (void)submit_cmds(encoder.data(), encoder.size());
+     return last_status();
+ }
+
+ /** Draws a slider. */
+ graph_status_t GraphFt800::cmd_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range)
+ {
+     uint32_t words[5];
+     GraphCmdEncoder encoder(words, 5U);
+     encoder.cmd_slider(x, y, w, h, options, val, range);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws a toggle switch. */
+ graph_status_t GraphFt800::cmd_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, uint16_t state, const char* text)
+ {
+     uint32_t words[4U + max_label_words];
+     GraphCmdEncoder encoder(words, sizeof(words) / sizeof(words[0]));
+     encoder.cmd_toggle(x, y, w, font, options, state, text);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws a rotary dial. */
+ graph_status_t GraphFt800::cmd_dial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val)
+ {
+     uint32_t words[4];
+     GraphCmdEncoder encoder(words, 4U);
+     encoder.cmd_dial(x, y, r, options, val);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws a gauge. */
+ graph_status_t GraphFt800::cmd_gauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                                      uint16_t val, uint16_t range)
+ {
+     uint32_t words[5];
+     GraphCmdEncoder encoder(words, 5U);
+     encoder.cmd_gauge(x, y, r, options, major, minor, val, range);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws an analogue clock. */
+ graph_status_t GraphFt800::cmd_clock(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t h, uint16_t m, uint16_t s, uint16_t ms)
+ {
+     uint32_t words[5];
+     GraphCmdEncoder encoder(words, 5U);
+     encoder.cmd_clock(x, y, r, options, h, m, s, ms);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws a row of keys. */
+ graph_status_t GraphFt800::cmd_keys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys)
+ {
+     uint32_t words[4U + max_label_words];
+     GraphCmdEncoder encoder(words, sizeof(words) / sizeof(words[0]));
+     encoder.cmd_keys(x, y, w, h, font, options, keys);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws a number formatted by the co-processor. */
+ graph_status_t GraphFt800::cmd_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n)
+ {
+     uint32_t words[4];
+     GraphCmdEncoder encoder(words, 4U);
+     encoder.cmd_number(x, y, font, options, n);
+     return submit_encoded(encoder);
+ }
+
+ /** Draws a gradient. */
+ graph_status_t GraphFt800::cmd_gradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1)
+ {
+     uint32_t words[5];
+     GraphCmdEncoder encoder(words, 5U);
+     encoder.cmd_gradient(x0, y0, rgb0, x1, y1, rgb1);
+     return submit_encoded(encoder);
  }
  
  /** Starts calibration. */
- void GraphFt800::cmd_calibrate()
+ graph_status_t GraphFt800::cmd_calibrate()
  {
-     (void)ioctl(fd, FT800_IOC_CMD_CALIBRATE);
+     return call(FT800_IOC_CMD_CALIBRATE, nullptr);
  }
  
  /** Begins a bitmap drawing context. */
- void GraphFt800::begin_bitmap(uint8_t handle)
+ graph_status_t GraphFt800::begin_bitmap(uint8_t handle)
  {
-     (void)ioctl(fd, FT800_IOC_BEGIN_BITMAP, &handle);
+     return call(FT800_IOC_BEGIN_BITMAP, &handle);
  }
  
  /** Configures bitmap layout. */
- void GraphFt800::bitmap_layout(uint16_t format, uint16_t linestride, uint16_t height)
+ graph_status_t GraphFt800::bitmap_layout(uint16_t format, uint16_t linestride, uint16_t height)
  {
      struct ft800_bitmap_layout args = {format, linestride, height};
-     (void)ioctl(fd, FT800_IOC_BITMAP_LAYOUT, &args);
+     return call(FT800_IOC_BITMAP_LAYOUT, &args);
  }
  
  /** Configures bitmap size. */
- void GraphFt800::bitmap_size(uint8_t filter, uint8_t wrapx, uint8_t wrapy, uint16_t width, uint16_t height)
+ graph_status_t GraphFt800::bitmap_size(uint8_t filter, uint8_t wrapx, uint8_t wrapy, uint16_t width, uint16_t height)
  {
      struct ft800_bitmap_size args = {filter, wrapx, wrapy, width, height};
-     (void)ioctl(fd, FT800_IOC_BITMAP_SIZE, &args);
+     return call(FT800_IOC_BITMAP_SIZE, &args);
  }
  
  /** Clears screen with parameters. */
- void GraphFt800::clear(bool c, bool s, bool t)
+ graph_status_t GraphFt800::clear(bool c, bool s, bool t)
  {
      struct ft800_clear_args args = {c, s, t};
-     (void)ioctl(fd, FT800_IOC_CLEAR, &args);
+     return call(FT800_IOC_CLEAR, &args);
  }
  
  /** Sets clear color using RGB. */
- void GraphFt800::clear_color_rgb(uint8_t r, uint8_t g, uint8_t b)
+ graph_status_t GraphFt800::clear_color_rgb(uint8_t r, uint8_t g, uint8_t b)
  {
      struct ft800_rgb args = {r, g, b};
-     (void)ioctl(fd, FT800_IOC_CLEAR_COLOR_RGB, &args);
+     return call(FT800_IOC_CLEAR_COLOR_RGB, &args);
  }
  
  /** Signals end of display list. */
- void GraphFt800::display()
+ graph_status_t GraphFt800::display()
  {
-     (void)ioctl(fd, FT800_IOC_DISPLAY);
+     return call(FT800_IOC_DISPLAY, nullptr);
  }
  
  /** Closes drawing group. */
- void GraphFt800::end()
+ graph_status_t GraphFt800::end()
  {
-     (void)ioctl(fd, FT800_IOC_END);
+     return call(FT800_IOC_END, nullptr);
  }
  
  /** Reads raw touch coordinates. */
  bool GraphFt800::get_touch_raw_xy(uint16_t* x, uint16_t* y)
  {
      struct ft800_touch_xy coords;
-     int status = ioctl(fd, FT800_IOC_GET_TOUCH_RAW, &coords);
-     if (status == 0 && x != nullptr && y != nullptr)
+     if (x == nullptr || y == nullptr)
+     {
+         set_last(graph_status_t::failure(graph_error_t::INVALID_ARGUMENT));
+         return false;
+     }
+     if (call(FT800_IOC_GET_TOUCH_RAW, &coords).ok())
      {
          *x = coords.x;
          *y = coords.y;
@@ -147,8 +322,12 @@
  bool GraphFt800::get_touch_screen_xy(uint16_t* x, uint16_t* y)
  {
      struct ft800_touch_xy coords;
-     int status = ioctl(fd, FT800_IOC_GET_TOUCH_SCREEN, &coords);
-     if (status == 0 && x != nullptr && y != nullptr)
+     if (x == nullptr || y == nullptr)
+     {
+         set_last(graph_status_t::failure(graph_error_t::INVALID_ARGUMENT));
+         return false;
+     }
+     if (call(FT800_IOC_GET_TOUCH_SCREEN, &coords).ok())
      {
          *x = coords.x;
          *y = coords.y;
@@ -157,52 +336,750 @@
      return false;
  }
  
- /** Gets current touch tag. */
+ /** Gets current touch tag; 0 (no tag) if it cannot be read. */
  uint8_t GraphFt800::get_touch_tag()
  {
-     uint8_t tag = 0U;
-     (void)ioctl(fd, FT800_IOC_GET_TOUCH_TAG, &tag);
-     return tag;
+     return read_touch_tag().value_or(0U);
+ }
+
+ /** Reads the current touch tag. */
+ graph_result_t<uint8_t> GraphFt800::read_touch_tag()
+ {
+     graph_result_t<uint8_t> result = {graph_status_t::success(), 0U};
+     result.status = call(FT800_IOC_GET_TOUCH_TAG, &result.value);
+     return result;
  }
  
  /** Sets a tag for current context. */
- void GraphFt800::tag(uint8_t tag)
+ graph_status_t GraphFt800::tag(uint8_t tag)
  {
-     (void)ioctl(fd, FT800_IOC_SET_TAG, &tag);
+     return call(FT800_IOC_SET_TAG, &tag);
  }
  
- /** Checks if display FIFO is empty. */
+ /** Checks if display FIFO is empty; false if it cannot be read. */
  bool GraphFt800::fifo_empty()
+ {
+     return read_fifo_empty().value_or(false);
+ }
+
+ /** Reads whether the display FIFO is empty. */
+ graph_result_t<bool> GraphFt800::read_fifo_empty()
  {
      int status = 0;
-     (void)ioctl(fd, FT800_IOC_FIFO_EMPTY, &status);
-     return (status != 0);
+     graph_result_t<bool> result = {call(FT800_IOC_FIFO_EMPTY, &status), false};
+     result.value = (status != 0);
+     return result;
  }
  
  /** Updates FIFO write pointer. */
- void GraphFt800::update_fifo_write_pointer(uint32_t ptr)
+ graph_status_t GraphFt800::update_fifo_write_pointer(uint32_t ptr)
  {
-     (void)ioctl(fd, FT800_IOC_UPDATE_FIFO_PTR, &ptr);
+     return call(FT800_IOC_UPDATE_FIFO_PTR, &ptr);
  }
  
  /** Uploads a bitmap to FT800 RAM. */
- void GraphFt800::load_bitmap(uint32_t dst_addr, const void* src, size_t size)
+ graph_status_t GraphFt800::load_bitmap(uint32_t dst_addr, const void* src, size_t size)
  {
      struct ft800_load_bitmap args = {dst_addr, const_cast<void*>(src), size};
-     (void)ioctl(fd, FT800_IOC_LOAD_BITMAP, &args);
+     return call(FT800_IOC_LOAD_BITMAP, &args, static_cast<uint32_t>(size));
  }
  
  /** Manually sets calibration values. */
- void GraphFt800::set_calibration(const struct ft800_cal_data& cal)
+ graph_status_t GraphFt800::set_calibration(const struct ft800_cal_data& cal)
  {
-     (void)ioctl(fd, FT800_IOC_SET_CALIBRATION, &cal);
+     return call(FT800_IOC_SET_CALIBRATION, const_cast<struct ft800_cal_data*>(&cal));
  }
  
- /** Returns calibration status. */
+ /** Returns calibration status; false if it cannot be read. */
  bool GraphFt800::calibration_complete()
+ {
+     return read_calibration_status().value_or(false);
+ }
+
+ /** Reads whether touch calibration has completed. */
+ graph_result_t<bool> GraphFt800::read_calibration_status()
  {
      int status = 0;
-     (void)ioctl(fd, FT800_IOC_GET_CAL_STATUS, &status);
-     return (status != 0);
+     graph_result_t<bool> result = {call(FT800_IOC_GET_CAL_STATUS, &status), false};
+     result.value = (status != 0);
+     return result;
+ }
+ 
+ /** Copies a block of pre-encoded co-processor words into RAM_CMD. */
+ bool GraphFt800::submit_cmds(const uint32_t* words, size_t count)
+ {
+     const uint8_t* bytes = reinterpret_cast<const uint8_t*>(words);
+     size_t remaining = count * sizeof(uint32_t);
+     bool result = check_argument(words != nullptr);
+ 
+     while (result && remaining > 0U)
+     {
+         size_t chunk = (remaining > max_submit_bytes) ? max_submit_bytes : remaining;
+         struct ft800_uapi_cmdlist list = {
+             RAM_CMD,
+             static_cast<__u32>(chunk),
+             static_cast<__u64>(reinterpret_cast<uintptr_t>(bytes))
+         };
+         result = call(FT800_IOCTL_SUBMIT_CMDS, &list, static_cast<uint32_t>(chunk)).ok();
+         bytes += chunk;
+         remaining -= chunk;
+     }
+     return result;
+ }
+ 
+ /** Hands @p count widget descriptors to the driver, which encodes them into RAM_CMD. */
+ graph_status_t GraphFt800::exec_cmds(const struct ft800_cmd* cmds, size_t count)
+ {
+     if (!check_argument(cmds != nullptr && count > 0U && count <= UINT32_MAX))
+     {
+         return last_status();
+     }
+     struct ft800_uapi_exec_cmds batch;
+     batch.user_ptr = static_cast<__u64>(reinterpret_cast<uintptr_t>(cmds));
+     batch.count = static_cast<__u32>(count);
+     return call(FT800_IOCTL_EXEC_CMDS, &batch, static_cast<uint32_t>(count * sizeof(struct ft800_cmd)));
+ }
+
+ /** Maps the driver's command staging area into user space. */
+ bool GraphFt800::map_staging(size_t bytes)
+ {
+     if (staging != nullptr)
+     {
+         return (bytes <= staging_size);
+     }
+     if (!transport->is_open() || bytes == 0U)
+     {
+         return false;
+     }
+ 
+     void* area = transport->mmap(bytes);
+     if (area == nullptr)
+     {
+         return false;
+     }
+     staging = static_cast<uint32_t*>(area);
+     staging_size = bytes;
+     return true;
+ }
+ 
+ /** Releases the staging mapping, if any. */
+ void GraphFt800::unmap_staging()
+ {
+     if (staging != nullptr)
+     {
+         transport->munmap(staging, staging_size);
+         staging = nullptr;
+         staging_size = 0U;
+     }
+ }
+ 
+ /** Pushes @p len bytes starting at @p offset of the staging area into RAM_CMD. */
+ bool GraphFt800::push_mmap(uint32_t offset, uint32_t len)
+ {
+     bool result = check_argument((staging != nullptr) && ((static_cast<size_t>(offset) + len) <= staging_size));
+ 
+     while (result && len > 0U)
+     {
+         uint32_t chunk = (len > max_submit_bytes) ? static_cast<uint32_t>(max_submit_bytes) : len;
+         struct ft800_uapi_mmap_push push = { offset, chunk };
+         result = call(FT800_IOCTL_PUSH_MMAP, &push, chunk).ok();
+         offset += chunk;
+         len -= chunk;
+     }
+     return result;
+ }
+ 
+ /** Reads the co-processor FIFO pointers in one status call. */
+ bool GraphFt800::get_cmd_status(uint16_t* read_ptr, uint16_t* write_ptr)
+ {
+     struct ft800_status status;
+     bool result = call(FT800_IOCTL_GET_STATUS, &status).ok();
+     if (result && read_ptr != nullptr && write_ptr != nullptr)
+     {
+         *read_ptr = le16toh(status.cmd_read);
+         *write_ptr = le16toh(status.cmd_write);
+     }
+     if (result && status.cmd_read == status.cmd_write)
+     {
+         idle_count++;   // everything queued so far has executed
+     }
+     return result;
+ }
+ 
+ /** Reads FT800 memory in 4 KB pieces, one transfer each. */
+ bool GraphFt800::mem_read(uint32_t addr, void* dst, size_t len)
+ {
+     uint8_t* out = static_cast<uint8_t*>(dst);
+     bool result = check_argument(dst != nullptr);
+ 
+     while (result && len > 0U)
+     {
+         size_t chunk = (len > sizeof(ft800_mem_op::data)) ? sizeof(ft800_mem_op::data) : len;
+         result = read_burst(addr, out, chunk).ok();
+         addr += static_cast<uint32_t>(chunk);
+         out += chunk;
+         len -= chunk;
+     }
+     return result;
+ }
+
+ /**
+  * One contiguous read of at most 4 KB. MEMREAD copies a whole ft800_mem_op
+  * (4 KB) in and out, so where probe_pread() found that the driver's
+  * pread() reads FT800 addresses, that moves only the bytes asked for.
+  */
+ graph_status_t GraphFt800::read_burst(uint32_t addr, void* dst, size_t len)
+ {
+     if (!pread_probed.load(std::memory_order_relaxed))
+     {
+         probe_pread();
+     }
+     if (use_pread.load(std::memory_order_relaxed))
+     {
+         graph_status_t status = read_pread(addr, dst, len);
+         bool unsupported = (status.sys_errno == EINVAL || status.sys_errno == ENOSYS ||
+                             status.sys_errno == EOPNOTSUPP || status.sys_errno == ENOTTY);
+         if (!unsupported)
+         {
+             return status;
+         }
+         use_pread.store(false, std::memory_order_relaxed);   // stopped working: stay on MEMREAD
+     }
+     return read_memread(addr, dst, len);
+ }
+
+ graph_status_t GraphFt800::read_memread(uint32_t addr, void* dst, size_t len)
+ {
+     struct ft800_mem_op op;
+     op.addr = addr;
+     op.len = static_cast<__u32>(len);
+     graph_status_t status = call(FT800_IOCTL_MEMREAD, &op, static_cast<uint32_t>(len));
+     if (status.ok())
+     {
+         (void)memcpy(dst, op.data, len);
+     }
+     return status;
+ }
+
+ graph_status_t GraphFt800::read_pread(uint32_t addr, void* dst, size_t len)
+ {
+     return attempt(pread_request, static_cast<uint32_t>(len), [&]() -> int
+     {
+         ssize_t got = transport->pread(dst, len, static_cast<off_t>(addr));
+         if (got >= 0 && static_cast<size_t>(got) != len)
+         {
+             errno = EIO;
+             return -1;
+         }
+         return (got < 0) ? -1 : 0;
+     });
+ }
+
+ /**
+  * Enables pread() bursts only if the driver's read() honours the file
+  * offset as an FT800 address: REG_ID and ROM_CHIPID read through pread()
+  * must match MEMREAD, and REG_ID must hold the FT800 id. A driver that
+  * ignored the offset would otherwise return plausible but wrong registers.
+  * Runs before the first burst; if MEMREAD itself fails it is tried again.
+  */
+ void GraphFt800::probe_pread()
+ {
+     static const uint32_t probe_addrs[2] = {REG_ID, ROM_CHIPID};
+     uint32_t expected[2] = {0U, 0U};
+     for (size_t i = 0U; i < 2U; ++i)
+     {
+         if (!read_memread(probe_addrs[i], &expected[i], sizeof(expected[i])).ok())
+         {
+             return;
+         }
+     }
+     // A burst on another thread meanwhile sees use_pread still false and
+     // takes MEMREAD, which is always correct.
+     pread_probed.store(true, std::memory_order_relaxed);
+
+     bool matches = ((le32toh(expected[0]) & 0xFFU) == ft800_chip_id);
+     for (size_t i = 0U; matches && i < 2U; ++i)
+     {
+         uint32_t got = ~expected[i];
+         matches = read_pread(probe_addrs[i], &got, sizeof(got)).ok() && got == expected[i];
+     }
+     use_pread.store(matches, std::memory_order_relaxed);
+     set_last(graph_status_t::success(0U));   // a refused pread() is not the caller's error
+ }
+ 
+ /** Writes FT800 memory through MEMWRITE, in 4 KB pieces. */
+ bool GraphFt800::mem_write(uint32_t addr, const void* src, size_t len)
+ {
+     const uint8_t* in = static_cast<const uint8_t*>(src);
+     struct ft800_mem_op op;
+     bool result = check_argument(src != nullptr);
+ 
+     while (result && len > 0U)
+     {
+         size_t chunk = (len > sizeof(op.data)) ? sizeof(op.data) : len;
+         op.addr = addr;
+         op.len = static_cast<__u32>(chunk);
+         (void)memcpy(op.data, in, chunk);
+         result = call(FT800_IOCTL_MEMWRITE, &op, static_cast<uint32_t>(chunk)).ok();
+         addr += static_cast<uint32_t>(chunk);
+         in += chunk;
+         len -= chunk;
+     }
+     return result;
+ }
+ 
+ /** Reads a 32-bit register. */
+ bool GraphFt800::read_reg32(uint32_t addr, uint32_t* value)
+ {
+     uint32_t raw = 0U;
+     bool result = check_argument(value != nullptr) && mem_read(addr, &raw, sizeof(raw));
+     if (result)
+     {
+         *value = le32toh(raw);
+     }
+     return result;
+ }
+ 
+ /**
+  * Reads @p count 32-bit registers (at most max_burst_regs, any order) into
+  * @p values. Registers are sorted and read in runs: a run extends over
+  * gaps of up to get_burst_gap() unrequested bytes, since a few extra bytes
+  * on the bus cost less than another round trip, but never over
+  * REG_INT_FLAGS unless it was asked for, as reading clears it. A
+  * requested REG_INT_FLAGS is also latched for take_interrupts().
+  */
+ bool GraphFt800::read_regs(const uint32_t* addrs, uint32_t* values, size_t count)
+ {
+     uint8_t order[max_burst_regs];
+     bool result = check_argument(addrs != nullptr && values != nullptr && count <= max_burst_regs);
+
+     for (size_t i = 0U; result && i < count; ++i)
+     {
+         result = check_argument((addrs[i] & 3U) == 0U);
+         // Insertion sort; count is small.
+         size_t j = i;
+         while (j > 0U && addrs[order[j - 1U]] > addrs[i])
+         {
+             order[j] = order[j - 1U];
+             j--;
+         }
+         order[j] = static_cast<uint8_t>(i);
+     }
+
+     size_t first = 0U;
+     while (result && first < count)
+     {
+         uint32_t start = addrs[order[first]];
+         uint32_t end = start + sizeof(uint32_t);
+         size_t last = first + 1U;
+         while (last < count)
+         {
+             uint32_t next = addrs[order[last]];
+             bool bridges_flags = (end <= REG_INT_FLAGS && REG_INT_FLAGS < next);
+             if (next >= end && (next - end > burst_gap || next + sizeof(uint32_t) - start > max_burst_bytes ||
+                                 bridges_flags))
+             {
+                 break;
+             }
+             end = (next + sizeof(uint32_t) > end) ? next + static_cast<uint32_t>(sizeof(uint32_t)) : end;
+             last++;
+         }
+
+         // Reading REG_INT_FLAGS clears it: latch it under the same lock as
+         // take_interrupts(), or a concurrent waiter would find it empty.
+         uint32_t run[max_burst_bytes / sizeof(uint32_t)];
+         std::unique_lock<std::mutex> guard(interrupt_lock, std::defer_lock);
+         bool has_flags = (start <= REG_INT_FLAGS && REG_INT_FLAGS < end);
+         if (has_flags)
+         {
+             guard.lock();
+         }
+         result = read_burst(start, run, end - start).ok();
+         for (size_t k = first; result && k < last; ++k)
+         {
+             values[order[k]] = le32toh(run[(addrs[order[k]] - start) / sizeof(uint32_t)]);
+         }
+         if (result && has_flags)
+         {
+             uint32_t flags = le32toh(run[(REG_INT_FLAGS - start) / sizeof(uint32_t)]);
+             pending_interrupts.store(static_cast<uint8_t>(pending_interrupts.load() | flags));
+         }
+         first = last;
+     }
+     return result;
+ }
+
+ /** Writes a 32-bit register. */
+ bool GraphFt800::write_reg32(uint32_t addr, uint32_t value)
+ {
+     uint32_t raw = htole32(value);
+     return mem_write(addr, &raw, sizeof(raw));
+ }
+ 
+ /**
+  * Blocks until the driver signals an FT800 interrupt on the device fd.
+  * Returns 1 on an event, 0 on timeout and -1 if the driver cannot poll.
+  */
+ int GraphFt800::wait_event(int timeout_ms)
+ {
+     short revents = 0;
+     int status = transport->poll(static_cast<short>(POLLIN | POLLPRI), timeout_ms, &revents);
+ 
+     if (status < 0 || (revents & (POLLERR | POLLNVAL)) != 0)
+     {
+         return -1;
+     }
+     return (status > 0) ? 1 : 0;
+ }
+
+ /** Adds @p flags to REG_INT_MASK and sets REG_INT_EN, keeping other users' bits. */
+ bool GraphFt800::unmask_interrupts(uint8_t flags)
+ {
+     std::lock_guard<std::mutex> guard(interrupt_lock);
+     uint32_t mask = 0U;
+     return read_reg32(REG_INT_MASK, &mask) &&
+            write_reg32(REG_INT_MASK, mask | flags) &&
+            write_reg32(REG_INT_EN, 1U);
+ }
+
+ /**
+  * Reads (and so clears) REG_INT_FLAGS, latches what it found and returns
+  * the latched bits among @p flags, which are then consumed. On a failed
+  * read nothing is consumed.
+  */
+ graph_result_t<uint8_t> GraphFt800::take_interrupts(uint8_t flags)
+ {
+     std::lock_guard<std::mutex> guard(interrupt_lock);
+     graph_result_t<uint8_t> result = {graph_status_t::success(), 0U};
+     uint32_t raised = 0U;
+     if (!read_reg32(REG_INT_FLAGS, &raised))
+     {
+         result.status = last_status();
+         return result;
+     }
+     uint8_t latched = static_cast<uint8_t>(pending_interrupts.load() | raised);
+     result.value = static_cast<uint8_t>(latched & flags);
+     pending_interrupts.store(static_cast<uint8_t>(latched & ~flags));
+     return result;
+ }
+
+ /** True if the co-processor has stopped on an illegal command or overflow. */
+ bool GraphFt800::is_faulted()
+ {
+     uint16_t rd = 0U;
+     uint16_t wr = 0U;
+     return get_cmd_status(&rd, &wr) && (rd == fault_pointer);
+ }
+
+ /**
+  * Minimal co-processor reset: hold REG_CPURESET, zero the ring and
+  * display-list pointers and release it. RAM_G, the swapped display list and
+  * the touch engine are untouched, so the screen keeps its last frame and
+  * resident bitmaps stay valid. Listeners then resynchronise their mirrors.
+  */
+ bool GraphFt800::recover()
+ {
+     TRACE_SCOPE(trace, trace_category_t::FT800, "recover", fault_stats.faults, 0U);
+     struct timespec start;
+     struct timespec end;
+     uint32_t last_idle = idle_count;
+     uint16_t rd = fault_pointer;
+     uint16_t wr = fault_pointer;
+
+     (void)clock_gettime(CLOCK_MONOTONIC, &start);
+     fault_stats.faults++;
+
+     bool result = write_reg32(REG_CPURESET, 1U) &&
+                   write_reg32(REG_CMD_READ, 0U) &&
+                   write_reg32(REG_CMD_WRITE, 0U) &&
+                   write_reg32(REG_CMD_DL, 0U) &&
+                   write_reg32(REG_CPURESET, 0U) &&
+                   get_cmd_status(&rd, &wr) && (rd == 0U) && (wr == 0U);
+     if (result)
+     {
+         write_index = 0U;
+         for (GraphFaultListener* listener : fault_listeners)
+         {
+             listener->coprocessor_reset(last_idle);
+         }
+         fault_stats.recoveries++;
+     }
+     else
+     {
+         fault_stats.failed_recoveries++;
+     }
+     TRACE_SET_RESULT(trace, result ? 0 : -1);
+
+     (void)clock_gettime(CLOCK_MONOTONIC, &end);
+     uint64_t elapsed = elapsed_ns(start, end);
+     fault_stats.last_recovery_ns = elapsed;
+     fault_stats.total_recovery_ns += elapsed;
+     if (elapsed > fault_stats.max_recovery_ns)
+     {
+         fault_stats.max_recovery_ns = elapsed;
+     }
+     return result;
+ }
+
+ /** Registers @p listener to be told about co-processor resets. */
+ void GraphFt800::add_fault_listener(GraphFaultListener* listener)
+ {
+     if (listener != nullptr &&
+         std::find(fault_listeners.begin(), fault_listeners.end(), listener) == fault_listeners.end())
+     {
+         fault_listeners.push_back(listener);
+     }
+ }
+
+ /** Stops notifying @p listener. */
+ void GraphFt800::remove_fault_listener(GraphFaultListener* listener)
+ {
+     fault_listeners.erase(std::remove(fault_listeners.begin(), fault_listeners.end(), listener),
+                           fault_listeners.end());
+ }
+
+ /** Sets how often and how long EAGAIN / EBUSY / EINTR are retried. */
+ void GraphFt800::set_retry_policy(const retry_policy_t& policy)
+ {
+     retry = policy;
+     if (retry.max_attempts == 0U)
+     {
+         retry.max_attempts = 1U;
+     }
+ }
+
+ void GraphFt800::init_ioctl_stats()
+ {
+     ioctl_stats.reset(new ioctl_counters_t[known_ioctls + 1U]);
+     for (size_t i = 0U; i < known_ioctls; ++i)
+     {
+         ioctl_stats[i].request = ioctl_names[i].request;
+         ioctl_stats[i].name = ioctl_names[i].name;
+     }
+     ioctl_stats[known_ioctls].request = 0U;
+     ioctl_stats[known_ioctls].name = "other";
+     reset_ioctl_stats();
+ }
+
+ /** Statistics slot of @p request; the table is fixed, so no allocation here. */
+ GraphFt800::ioctl_counters_t& GraphFt800::stats_for(unsigned long request)
+ {
+     size_t hint = last_stats.load(std::memory_order_relaxed);
+     if (ioctl_stats[hint].request == request)
+     {
+         return ioctl_stats[hint];
+     }
+     for (size_t i = 0U; i < known_ioctls; ++i)
+     {
+         if (ioctl_stats[i].request == request)
+         {
+             last_stats.store(i, std::memory_order_relaxed);
+             return ioctl_stats[i];
+         }
+     }
+     return ioctl_stats[known_ioctls];
+ }
+
+ /** Histogram bucket of one call: [0, 1 us), then powers of two up to the last, open bucket. */
+ uint32_t GraphFt800::latency_bucket(uint64_t ns)
+ {
+     uint64_t us = ns / 1000U;
+     uint32_t bucket = 0U;
+     while (us > 0U && bucket < latency_buckets - 1U)
+     {
+         us >>= 1;
+         bucket++;
+     }
+     return bucket;
+ }
+
+ /** Lower bound of @p bucket in nanoseconds. */
+ uint64_t GraphFt800::latency_bucket_floor_ns(uint32_t bucket)
+ {
+     return (bucket == 0U) ? 0U : (1000ULL << (bucket - 1U));
+ }
+
+ /** Records a failed argument check in last_status(). */
+ bool GraphFt800::check_argument(bool valid)
+ {
+     if (!transport->is_open())
+     {
+         set_last(graph_status_t::failure(graph_error_t::NOT_OPEN));
+         return false;
+     }
+     if (!valid)
+     {
+         set_last(graph_status_t::failure(graph_error_t::INVALID_ARGUMENT));
+     }
+     return valid;
+ }
+
+ /**
+  * Issues one driver request, retrying EAGAIN, EBUSY and EINTR with
+  * exponential backoff per the retry policy. Every attempt is timed into the
+  * request's latency histogram; the outcome is counted and kept in
+  * last_status().
+  */
+ graph_status_t GraphFt800::call(unsigned long request, void* arg, uint32_t bytes)
+ {
+     if (bytes == 0U)
+     {
+         bytes = _IOC_SIZE(request);
+     }
+     return attempt(request, bytes, [&]() { return transport->ioctl(request, arg); });
+ }
+
+ /** Runs @p op (returning -1 and errno on failure) under the retry policy, recording each attempt. */
+ template <typename Op>
+ graph_status_t GraphFt800::attempt(unsigned long request, uint32_t bytes, Op op)
+ {
+     graph_status_t status = graph_status_t::success(0U);
+     uint32_t backoff_us = retry.initial_backoff_us;
+
+     while (true)
+     {
+         struct timespec start;
+         struct timespec end;
+         (void)clock_gettime(CLOCK_MONOTONIC, &start);
+         int rc = op();
+         int error = (rc < 0) ? errno : 0;
+         (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+         status.attempts++;
+         status.error = graph_status_t::classify(error);
+         status.sys_errno = error;
+         bool again = (status.error == graph_error_t::BUSY) && (status.attempts < retry.max_attempts);
+         record(request, bytes, start, end, status, again);
+         if (!again)
+         {
+             break;
+         }
+         if (error != EINTR && backoff_us > 0U)
+         {
+             struct timespec pause = {0, static_cast<long>(backoff_us) * 1000L};
+             (void)nanosleep(&pause, nullptr);
+             backoff_us = (backoff_us * 2U > retry.max_backoff_us) ? retry.max_backoff_us : backoff_us * 2U;
+         }
+     }
+     set_last(status);
+     return status;
+ }
+
+ /**
+  * Accounts and traces one attempt; @p retrying means another attempt
+  * follows. Lock-free, as it runs on every submission: each counter is
+  * updated on its own, so a concurrent snapshot may see one attempt half
+  * counted but never a torn value.
+  */
+ void GraphFt800::record(unsigned long request, uint32_t bytes, const struct timespec& start, const struct timespec& end,
+                         const graph_status_t& status, bool retrying)
+ {
+     uint64_t ns = elapsed_ns(start, end);
+     ioctl_counters_t& stats = stats_for(request);
+
+     TRACE_EVENT(trace_category_t::FT800, stats.name, static_cast<uint32_t>(request), bytes, -status.sys_errno,
+                 timespec_ns(start), timespec_ns(end));
+
+     (void)stats.total_ns.fetch_add(ns, std::memory_order_relaxed);
+     uint64_t max_ns = stats.max_ns.load(std::memory_order_relaxed);
+     while (ns > max_ns && !stats.max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed))
+     {
+     }
+     (void)stats.histogram[latency_bucket(ns)].fetch_add(1U, std::memory_order_relaxed);
+     if (retrying)
+     {
+         (void)stats.retries.fetch_add(1U, std::memory_order_relaxed);
+         return;
+     }
+     (void)stats.calls.fetch_add(1U, std::memory_order_relaxed);
+     if (!status.ok())
+     {
+         (void)stats.errors.fetch_add(1U, std::memory_order_relaxed);
+         stats.last_errno.store(status.sys_errno, std::memory_order_relaxed);
+     }
+ }
+
+ /** Snapshot of the per-request counters, requests never issued left out. */
+ std::vector<GraphFt800::ioctl_stats_t> GraphFt800::get_ioctl_stats()
+ {
+     std::vector<ioctl_stats_t> used;
+     for (size_t i = 0U; i <= known_ioctls; ++i)
+     {
+         const ioctl_counters_t& live = ioctl_stats[i];
+         ioctl_stats_t stats;
+         stats.request = live.request;
+         stats.name = live.name;
+         stats.calls = live.calls.load(std::memory_order_relaxed);
+         if (stats.calls == 0U)
+         {
+             continue;
+         }
+         stats.errors = live.errors.load(std::memory_order_relaxed);
+         stats.retries = live.retries.load(std::memory_order_relaxed);
+         stats.total_ns = live.total_ns.load(std::memory_order_relaxed);
+         stats.max_ns = live.max_ns.load(std::memory_order_relaxed);
+         for (uint32_t b = 0U; b < latency_buckets; ++b)
+         {
+             stats.histogram[b] = live.histogram[b].load(std::memory_order_relaxed);
+         }
+         stats.last_errno = live.last_errno.load(std::memory_order_relaxed);
+         used.push_back(stats);
+     }
+     return used;
+ }
+
+ /** Zeroes the counters; attempts recorded concurrently may survive in part. */
+ void GraphFt800::reset_ioctl_stats()
+ {
+     for (size_t i = 0U; i <= known_ioctls; ++i)
+     {
+         ioctl_counters_t& stats = ioctl_stats[i];
+         stats.calls.store(0U, std::memory_order_relaxed);
+         stats.errors.store(0U, std::memory_order_relaxed);
+         stats.retries.store(0U, std::memory_order_relaxed);
+         stats.total_ns.store(0U, std::memory_order_relaxed);
+         stats.max_ns.store(0U, std::memory_order_relaxed);
+         for (uint32_t b = 0U; b < latency_buckets; ++b)
+         {
+             stats.histogram[b].store(0U, std::memory_order_relaxed);
+         }
+         stats.last_errno.store(0, std::memory_order_relaxed);
+     }
+ }
+
+ /** Writes one line per request: counts, mean/max latency and the non-empty histogram buckets. */
+ void GraphFt800::print_ioctl_stats(FILE* stream)
+ {
+     if (stream == nullptr)
+     {
+         return;
+     }
+     std::vector<ioctl_stats_t> used = get_ioctl_stats();
+     (void)fprintf(stream, "%-16s %10s %8s %8s %10s %10s  attempts per latency bucket (us)\n",
+                   "ioctl", "calls", "errors", "retries", "mean us", "max us");
+     for (const ioctl_stats_t& stats : used)
+     {
+         uint64_t samples = stats.calls + stats.retries;
+         (void)fprintf(stream, "%-16s %10llu %8llu %8llu %10.1f %10.1f ", stats.name,
+                       static_cast<unsigned long long>(stats.calls), static_cast<unsigned long long>(stats.errors),
+                       static_cast<unsigned long long>(stats.retries),
+                       (samples > 0U) ? static_cast<double>(stats.total_ns) / samples / 1000.0 : 0.0,
+                       static_cast<double>(stats.max_ns) / 1000.0);
+         for (uint32_t b = 0U; b < latency_buckets; ++b)
+         {
+             if (stats.histogram[b] > 0U)
+             {
+                 if (b == 0U)
+                 {
+                     (void)fprintf(stream, " <1:%u", stats.histogram[b]);
+                 }
+                 else
+                 {
+                     (void)fprintf(stream, " %llu+:%u",
+                                   static_cast<unsigned long long>(latency_bucket_floor_ns(b) / 1000U), stats.histogram[b]);
+                 }
+             }
+         }
+         (void)fprintf(stream, "\n");
+     }
  }
- 
\ No newline at end of file
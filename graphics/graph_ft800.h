@@ -7,45 +7,244 @@
  #ifndef GRAPH_FT800_H
  #define GRAPH_FT800_H
  
+ #include <atomic>
  #include <cstdint>
  #include <cstddef>
+ #include <cstdio>
+ #include <ctime>
+ #include <memory>
+ #include <mutex>
+ #include <vector>
+ #include "graph_status.h"
+ #include "graph_transport.h"
  
  struct ft800_cal_data;  // Forward declare for calibration
+ struct ft800_cmd;       // Driver widget descriptor (ft800_uapi.h)
+ class GraphCmdEncoder;
  
+ /**
+  * Host-side state that mirrors the co-processor (ring pointers, RAM_G
+  * uploads still in flight) and must be fixed up after GraphFt800::recover().
+  */
+ class GraphFaultListener
+ {
+ public:
+     virtual ~GraphFaultListener() {}
+
+     /** @p last_idle_epoch: idle_epoch() when the fault was found; later work was lost. */
+     virtual void coprocessor_reset(uint32_t last_idle_epoch) = 0;
+ };
+
+ /**
+  * User-space face of the FT800 driver. Every driver request goes through
+  * one instrumented path: EAGAIN / EBUSY / EINTR are retried per
+  * retry_policy_t, each attempt's latency lands in a per-request histogram
+  * and failures are counted, so SPI stalls show up in get_ioctl_stats()
+  * rather than as dropped frames. Drawing calls return a graph_status_t,
+  * reads a graph_result_t; calls that keep their bool result leave the
+  * detail in last_status().
+  *
+  * Drawing, the command FIFO, staging and recover() belong to one thread
+  * (GraphRenderThread). Register and memory reads (mem_read(), read_reg32(),
+  * read_regs()) and the interrupt calls (unmask_interrupts(),
+  * take_interrupts(), wait_event()) may also be made from another thread,
+  * as GraphTouchInput does: the driver serialises SPI transfers,
+  * REG_INT_FLAGS is latched under its own lock, the ioctl statistics are
+  * atomic and last_status() is kept per thread.
+  */
  class GraphFt800
  {
  public:
      explicit GraphFt800(const char* device_path);
+     explicit GraphFt800(GraphTransport& device_transport);
      ~GraphFt800();
  
      bool initialise();
-     void cmd_dlstart();
-     void cmd_swap();
-     void cmd_button(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t font, uint16_t options, const char* text);
-     void cmd_text(uint16_t x, uint16_t y, uint16_t font, uint16_t options, const char* text);
-     void cmd_spinner(uint16_t x, uint16_t y, uint16_t style, uint16_t scale);
-     void cmd_calibrate();
-     void begin_bitmap(uint8_t handle);
-     void bitmap_layout(uint16_t format, uint16_t linestride, uint16_t height);
-     void bitmap_size(uint8_t filter, uint8_t wrapx, uint8_t wrapy, uint16_t width, uint16_t height);
-     void clear(bool c, bool s, bool t);
-     void clear_color_rgb(uint8_t r, uint8_t g, uint8_t b);
-     void display();
-     void end();
+     graph_status_t cmd_dlstart();
+     graph_status_t cmd_swap();
+     graph_status_t cmd_button(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t font, uint16_t options, const char* text);
+     graph_status_t cmd_text(uint16_t x, uint16_t y, uint16_t font, uint16_t options, const char* text);
+     graph_status_t cmd_spinner(uint16_t x, uint16_t y, uint16_t style, uint16_t scale);
+     graph_status_t cmd_slider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range);
+     graph_status_t cmd_toggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, uint16_t state, const char* text);
+     graph_status_t cmd_dial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val);
+     graph_status_t cmd_gauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                              uint16_t val, uint16_t range);
+     graph_status_t cmd_clock(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t h, uint16_t m, uint16_t s, uint16_t ms);
+     graph_status_t cmd_keys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys);
+     graph_status_t cmd_number(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t n);
+     graph_status_t cmd_gradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1);
+     graph_status_t cmd_calibrate();
+     graph_status_t begin_bitmap(uint8_t handle);
+     graph_status_t bitmap_layout(uint16_t format, uint16_t linestride, uint16_t height);
+     graph_status_t bitmap_size(uint8_t filter, uint8_t wrapx, uint8_t wrapy, uint16_t width, uint16_t height);
+     graph_status_t clear(bool c, bool s, bool t);
+     graph_status_t clear_color_rgb(uint8_t r, uint8_t g, uint8_t b);
+     graph_status_t display();
+     graph_status_t end();
      bool get_touch_raw_xy(uint16_t* x, uint16_t* y);
      bool get_touch_screen_xy(uint16_t* x, uint16_t* y);
      uint8_t get_touch_tag();
-     void tag(uint8_t tag);
+     graph_result_t<uint8_t> read_touch_tag();
+     graph_status_t tag(uint8_t tag);
      bool fifo_empty();
-     void update_fifo_write_pointer(uint32_t ptr);
-     void load_bitmap(uint32_t dst_addr, const void* src, size_t size);
-     void set_calibration(const struct ft800_cal_data& cal);
+     graph_result_t<bool> read_fifo_empty();
+     graph_status_t update_fifo_write_pointer(uint32_t ptr);
+     graph_status_t load_bitmap(uint32_t dst_addr, const void* src, size_t size);
+     graph_status_t set_calibration(const struct ft800_cal_data& cal);
      bool calibration_complete();
+     graph_result_t<bool> read_calibration_status();
+     bool submit_cmds(const uint32_t* words, size_t count);
+     graph_status_t exec_cmds(const struct ft800_cmd* cmds, size_t count);
+ 
+     // Zero-copy path through the driver's mmap'ed staging area
+     static const size_t default_staging_bytes = 4096U;
+     bool map_staging(size_t bytes = default_staging_bytes);
+     void unmap_staging();
+     uint32_t* staging_buffer() { return staging; }
+     size_t staging_bytes() const { return staging_size; }
+     bool push_mmap(uint32_t offset, uint32_t len);
+ 
+     // Raw memory-mapped access
+     bool get_cmd_status(uint16_t* read_ptr, uint16_t* write_ptr);
+     bool mem_read(uint32_t addr, void* dst, size_t len);
+     bool mem_write(uint32_t addr, const void* src, size_t len);
+     bool read_reg32(uint32_t addr, uint32_t* value);
+     bool write_reg32(uint32_t addr, uint32_t value);
+
+     // Scatter/gather register reads: adjacent registers share one transfer
+     static const size_t max_burst_regs = 32U;
+     static const uint32_t max_burst_bytes = 256U;
+     static const uint32_t default_burst_gap = 16U;
+     bool read_regs(const uint32_t* addrs, uint32_t* values, size_t count);
+     void set_burst_gap(uint32_t bytes) { burst_gap = bytes; }
+     uint32_t get_burst_gap() const { return burst_gap; }
+     int wait_event(int timeout_ms);
+
+     // REG_INT_FLAGS is cleared by reading it, so several waiters share it
+     // through one latch: each takes only its own bits, the rest stay pending.
+     bool unmask_interrupts(uint8_t flags);
+     graph_result_t<uint8_t> take_interrupts(uint8_t flags);
+     bool interrupts_latched(uint8_t flags) const { return (pending_interrupts.load() & flags) != 0U; }
+
+     // Co-processor fault (REG_CMD_READ = 0xFFF) detection and recovery
+     struct fault_stats_t
+     {
+         uint32_t faults;              //!< recover() calls
+         uint32_t recoveries;          //!< Co-processor running again afterwards
+         uint32_t failed_recoveries;
+         uint64_t last_recovery_ns;
+         uint64_t max_recovery_ns;
+         uint64_t total_recovery_ns;
+     };
+
+     static const uint16_t fault_pointer = 0x0FFFU;
+     bool is_faulted();
+     bool recover();
+     void add_fault_listener(GraphFaultListener* listener);
+     void remove_fault_listener(GraphFaultListener* listener);
+     uint32_t idle_epoch() const { return idle_count; }
+     const fault_stats_t& get_fault_stats() const { return fault_stats; }
+ 
+     // Driver call policy and instrumentation
+     struct retry_policy_t
+     {
+         uint16_t max_attempts;         //!< 1 disables retrying
+         uint32_t initial_backoff_us;   //!< Doubled after each busy attempt
+         uint32_t max_backoff_us;
+     };
+
+     static const retry_policy_t default_retry_policy;
+     static const uint32_t latency_buckets = 16U;   //!< <1 us, then [2^(n-1), 2^n) us, last bucket open
+
+     struct ioctl_stats_t
+     {
+         unsigned long request;
+         const char* name;
+         uint64_t calls;           //!< Operations; a retried call counts once
+         uint64_t errors;          //!< Operations that failed after retries
+         uint64_t retries;         //!< Extra attempts after EAGAIN / EBUSY / EINTR
+         uint64_t total_ns;        //!< All attempts
+         uint64_t max_ns;
+         uint32_t histogram[latency_buckets];   //!< Attempts per latency bucket
+         int last_errno;
+     };
+
+     void set_retry_policy(const retry_policy_t& policy);
+     const retry_policy_t& get_retry_policy() const { return retry; }
+     /** Status of the calling thread's last request on this device. */
+     graph_status_t last_status() const
+     {
+         return (last_call.device == this) ? last_call.status : graph_status_t::success(0U);
+     }
+     std::vector<ioctl_stats_t> get_ioctl_stats();
+     void reset_ioctl_stats();
+     void print_ioctl_stats(FILE* stream);
+     static uint32_t latency_bucket(uint64_t ns);
+     static uint64_t latency_bucket_floor_ns(uint32_t bucket);
+
+     GraphTransport& get_transport() { return *transport; }
  
  private:
-     int fd;
+     template <typename Op>
+     graph_status_t attempt(unsigned long request, uint32_t bytes, Op op);
+     graph_status_t call(unsigned long request, void* arg, uint32_t bytes = 0U);
+     graph_status_t submit_encoded(const GraphCmdEncoder& encoder);
+     graph_status_t read_burst(uint32_t addr, void* dst, size_t len);
+     graph_status_t read_memread(uint32_t addr, void* dst, size_t len);
+     graph_status_t read_pread(uint32_t addr, void* dst, size_t len);
+     void probe_pread();
+     void record(unsigned long request, uint32_t bytes, const struct timespec& start, const struct timespec& end,
+                 const graph_status_t& status, bool retrying);
+     bool check_argument(bool valid);
+     void set_last(const graph_status_t& status)
+     {
+         last_call.device = this;
+         last_call.status = status;
+     }
+     // Live counters of one request. Updated with relaxed atomics so the
+     // per-frame submission path takes no lock; readers get a snapshot.
+     struct ioctl_counters_t
+     {
+         unsigned long request;
+         const char* name;
+         std::atomic<uint64_t> calls;
+         std::atomic<uint64_t> errors;
+         std::atomic<uint64_t> retries;
+         std::atomic<uint64_t> total_ns;
+         std::atomic<uint64_t> max_ns;
+         std::atomic<uint32_t> histogram[latency_buckets];
+         std::atomic<int> last_errno;
+     };
+
+     // last_status() of each thread: the device it last called and the outcome.
+     struct call_status_t
+     {
+         const GraphFt800* device;
+         graph_status_t status;
+     };
+     static thread_local call_status_t last_call;
+
+     void init_ioctl_stats();
+     ioctl_counters_t& stats_for(unsigned long request);
+
+     std::unique_ptr<GraphDeviceTransport> owned_transport;
+     GraphTransport* transport;
      bool display_initialised;
      uint32_t write_index;
+     uint32_t* staging;
+     size_t staging_size;
+     std::vector<GraphFaultListener*> fault_listeners;
+     uint32_t idle_count;
+     fault_stats_t fault_stats;
+     retry_policy_t retry;
+     std::unique_ptr<ioctl_counters_t[]> ioctl_stats;   //!< Fixed table, one slot per known request + "other"
+     std::atomic<size_t> last_stats;
+     std::mutex interrupt_lock;
+     std::atomic<uint8_t> pending_interrupts;
+     std::atomic<bool> use_pread;      //!< Set by probe_pread() once read() is known to honour the offset
+     std::atomic<bool> pread_probed;
+     uint32_t burst_gap;
  };
  
  #endif // GRAPH_FT800_H
@@ -0,0 +1,121 @@
+/*!
+ * \file ft800Cmds.h
+ * \brief FT800 display-list opcodes, primitives and co-processor command tokens
+ *
+ * Values follow the FT800 Series Programmer's Guide. These are the raw words
+ * the co-processor consumes from RAM_CMD, not the driver descriptor tokens
+ * used by struct ft800_cmd.
+ */
+
+#include <cstdint>
+
+ #ifndef FT800_CMDS_H
+ #define FT800_CMDS_H
+
+ // --------------------------------------
+ // Display-list opcodes (bits 31..24)
+ // --------------------------------------
+
+ static const uint32_t DL_DISPLAY          = 0x00;
+ static const uint32_t DL_BITMAP_SOURCE    = 0x01;
+ static const uint32_t DL_CLEAR_COLOR_RGB  = 0x02;
+ static const uint32_t DL_TAG              = 0x03;
+ static const uint32_t DL_COLOR_RGB        = 0x04;
+ static const uint32_t DL_BITMAP_HANDLE    = 0x05;
+ static const uint32_t DL_CELL             = 0x06;
+ static const uint32_t DL_BITMAP_LAYOUT    = 0x07;
+ static const uint32_t DL_BITMAP_SIZE      = 0x08;
+ static const uint32_t DL_POINT_SIZE       = 0x0D;
+ static const uint32_t DL_LINE_WIDTH       = 0x0E;
+ static const uint32_t DL_CLEAR_COLOR_A    = 0x0F;
+ static const uint32_t DL_COLOR_A          = 0x10;
+ static const uint32_t DL_CLEAR_TAG        = 0x12;
+ static const uint32_t DL_TAG_MASK         = 0x14;
+ static const uint32_t DL_BEGIN            = 0x1F;
+ static const uint32_t DL_END              = 0x21;
+ static const uint32_t DL_SAVE_CONTEXT     = 0x22;
+ static const uint32_t DL_RESTORE_CONTEXT  = 0x23;
+ static const uint32_t DL_CLEAR            = 0x26;
+
+ // --------------------------------------
+ // Graphics primitives for BEGIN
+ // --------------------------------------
+
+ static const uint8_t PRIM_BITMAPS      = 1;
+ static const uint8_t PRIM_POINTS       = 2;
+ static const uint8_t PRIM_LINES        = 3;
+ static const uint8_t PRIM_LINE_STRIP   = 4;
+ static const uint8_t PRIM_RECTS        = 9;
+
+ // --------------------------------------
+ // Co-processor commands
+ // --------------------------------------
+
+ static const uint32_t CMD_DLSTART         = 0xFFFFFF00;
+ static const uint32_t CMD_SWAP            = 0xFFFFFF01;
+ static const uint32_t CMD_INTERRUPT       = 0xFFFFFF02;
+ static const uint32_t CMD_BGCOLOR         = 0xFFFFFF09;
+ static const uint32_t CMD_FGCOLOR         = 0xFFFFFF0A;
+ static const uint32_t CMD_GRADIENT        = 0xFFFFFF0B;
+ static const uint32_t CMD_TEXT            = 0xFFFFFF0C;
+ static const uint32_t CMD_BUTTON          = 0xFFFFFF0D;
+ static const uint32_t CMD_KEYS            = 0xFFFFFF0E;
+ static const uint32_t CMD_PROGRESS        = 0xFFFFFF0F;
+ static const uint32_t CMD_SLIDER          = 0xFFFFFF10;
+ static const uint32_t CMD_SCROLLBAR       = 0xFFFFFF11;
+ static const uint32_t CMD_TOGGLE          = 0xFFFFFF12;
+ static const uint32_t CMD_GAUGE           = 0xFFFFFF13;
+ static const uint32_t CMD_CLOCK           = 0xFFFFFF14;
+ static const uint32_t CMD_CALIBRATE       = 0xFFFFFF15;
+ static const uint32_t CMD_SPINNER         = 0xFFFFFF16;
+ static const uint32_t CMD_STOP            = 0xFFFFFF17;
+ static const uint32_t CMD_MEMCRC          = 0xFFFFFF18;
+ static const uint32_t CMD_REGREAD         = 0xFFFFFF19;
+ static const uint32_t CMD_MEMWRITE        = 0xFFFFFF1A;
+ static const uint32_t CMD_MEMSET          = 0xFFFFFF1B;
+ static const uint32_t CMD_MEMZERO         = 0xFFFFFF1C;
+ static const uint32_t CMD_MEMCPY          = 0xFFFFFF1D;
+ static const uint32_t CMD_APPEND          = 0xFFFFFF1E;
+ static const uint32_t CMD_SNAPSHOT        = 0xFFFFFF1F;
+ static const uint32_t CMD_BITMAP_TRANSFORM = 0xFFFFFF21;
+ static const uint32_t CMD_INFLATE         = 0xFFFFFF22;
+ static const uint32_t CMD_GETPTR          = 0xFFFFFF23;
+ static const uint32_t CMD_LOADIMAGE       = 0xFFFFFF24;
+ static const uint32_t CMD_GETPROPS        = 0xFFFFFF25;
+ static const uint32_t CMD_LOADIDENTITY    = 0xFFFFFF26;
+ static const uint32_t CMD_TRANSLATE       = 0xFFFFFF27;
+ static const uint32_t CMD_SCALE           = 0xFFFFFF28;
+ static const uint32_t CMD_ROTATE          = 0xFFFFFF29;
+ static const uint32_t CMD_SETMATRIX       = 0xFFFFFF2A;
+ static const uint32_t CMD_SETFONT         = 0xFFFFFF2B;
+ static const uint32_t CMD_TRACK           = 0xFFFFFF2C;
+ static const uint32_t CMD_DIAL            = 0xFFFFFF2D;
+ static const uint32_t CMD_NUMBER          = 0xFFFFFF2E;
+ static const uint32_t CMD_SCREENSAVER     = 0xFFFFFF2F;
+ static const uint32_t CMD_SKETCH          = 0xFFFFFF30;
+ static const uint32_t CMD_LOGO            = 0xFFFFFF31;
+ static const uint32_t CMD_COLDSTART       = 0xFFFFFF32;
+ static const uint32_t CMD_GETMATRIX       = 0xFFFFFF33;
+ static const uint32_t CMD_GRADCOLOR       = 0xFFFFFF34;
+
+ // --------------------------------------
+ // Widget options
+ // --------------------------------------
+
+ static const uint16_t OPT_3D        = 0;
+ static const uint16_t OPT_MONO      = 1;
+ static const uint16_t OPT_NODL      = 2;
+ static const uint16_t OPT_FLAT      = 256;
+ static const uint16_t OPT_SIGNED    = 256;     // CMD_NUMBER: value is signed
+ static const uint16_t OPT_CENTERX   = 512;
+ static const uint16_t OPT_CENTERY   = 1024;
+ static const uint16_t OPT_CENTER    = 1536;
+ static const uint16_t OPT_RIGHTX    = 2048;
+ static const uint16_t OPT_NOBACK    = 4096;
+ static const uint16_t OPT_NOTICKS   = 8192;
+ static const uint16_t OPT_NOHM      = 16384;
+ static const uint16_t OPT_NOPOINTER = 16384;
+ static const uint16_t OPT_NOSECS    = 32768;
+ static const uint16_t OPT_NOHANDS   = 49152;
+
+ #endif // FT800_CMDS_H
@@ -116,5 +116,15 @@
  
  static const uint32_t DLSWAP_FRAME = 0x00000002; //!< Swap DL at frame end
  
+ // REG_INT_FLAGS / REG_INT_MASK bits
+ static const uint8_t INT_SWAP         = 0x01;
+ static const uint8_t INT_TOUCH        = 0x02;
+ static const uint8_t INT_TAG          = 0x04;
+ static const uint8_t INT_SOUND        = 0x08;
+ static const uint8_t INT_PLAYBACK     = 0x10;
+ static const uint8_t INT_CMDEMPTY     = 0x20;
+ static const uint8_t INT_CMDFLAG      = 0x40; //!< Raised by CMD_INTERRUPT
+ static const uint8_t INT_CONVCOMPLETE = 0x80;
+ 
  #endif // FT800_REG_H
  
\ No newline at end of file
@@ -0,0 +1,1239 @@
+/**
+ * @file graph_ft800_sim.cpp
+ * @brief Software FT800 model answering the driver's ioctl surface.
+ */
+
+ #include <cerrno>
+ #include <cstdint>
+ #include <cstring>
+ #include <ctime>
+ #include <poll.h>
+ #include <endian.h>
+ #ifdef GRAPH_HAVE_ZLIB
+ # include <zlib.h>
+ #endif
+ #include "graph_ft800_sim.h"
+ #include "graph_cmd_batch.h"
+ #include "graph_cmd_encoder.h"
+ #include "graph_dl.h"
+ #include "graph_dl_budget.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_ft800Reg.h"
+ #include "graph_ft800_ioctl.h"
+ #include "ft800_uapi.h"
+
+ static const uint32_t ring_size = 4096U;
+ static const uint32_t ring_mask = ring_size - 1U;
+ static const uint32_t ring_fault = 0x0FFFU;
+ static const uint32_t ram_g_size = 256U * 1024U;
+ static const uint32_t ram_dl_size = 8U * 1024U;
+ static const uint32_t chip_id = 0x7CU;
+ static const uint32_t untouched_xy = 0x80008000U;
+
+ // Address header per SPI transfer: 3 bytes, plus a dummy byte on reads.
+ static const uint32_t write_header = 3U;
+ static const uint32_t read_header = 4U;
+
+ // 10 MHz SPI and ~5 us per ioctl round trip, roughly what the BeagleBone
+ // McSPI driver achieves; about 50 co-processor clocks per word at 48 MHz.
+ const GraphFt800Sim::spi_model_t GraphFt800Sim::default_spi_model = { 10000000U, 5000U, 500U, 1000U, 16666667U, true };
+
+ GraphFt800Sim::GraphFt800Sim()
+     : spi(default_spi_model), memory(memory_size, 0U), start_ns(now_ns()), busy_until_ns(0U),
+       visible_read(0U), cmd_read(0U), cmd_write(0U), cmd_dl(0U), inflate_end(0U),
+       faulted(false), capturing(false), in_reset(false), stats()
+ {
+     load_font_rom();
+     reset_device();
+ }
+
+ GraphFt800Sim::~GraphFt800Sim() {}
+
+ uint64_t GraphFt800Sim::now_ns()
+ {
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+ }
+
+ static void sleep_for_ns(uint64_t ns)
+ {
+     // nanosleep overshoots by tens of microseconds, which would charge
+     // every long transfer extra; sleep short of the deadline and spin
+     // the rest.
+     static const uint64_t spin_ns = 100000U;
+     uint64_t start = 0U;
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     start = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+     if (ns > spin_ns)
+     {
+         uint64_t coarse = ns - spin_ns;
+         struct timespec delay = { static_cast<time_t>(coarse / 1000000000ULL), static_cast<long>(coarse % 1000000000ULL) };
+         (void)nanosleep(&delay, nullptr);
+     }
+     for (;;)
+     {
+         (void)clock_gettime(CLOCK_MONOTONIC, &now);
+         uint64_t t = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+         if (t - start >= ns)
+         {
+             break;
+         }
+     }
+ }
+
+ static bool overlaps(uint32_t addr, size_t len, uint32_t reg_addr)
+ {
+     return (reg_addr + 4U > addr) && (reg_addr < addr + len);
+ }
+
+ void GraphFt800Sim::set_spi_model(const spi_model_t& model)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     spi = model;
+     if (spi.spi_hz == 0U)
+     {
+         spi.spi_hz = default_spi_model.spi_hz;
+     }
+     if (spi.frame_period_ns == 0U)
+     {
+         spi.frame_period_ns = default_spi_model.frame_period_ns;
+     }
+ }
+
+ /** Accounts one call moving @p bytes over @p transfers chip-select cycles. */
+ void GraphFt800Sim::charge(uint32_t transfers, uint64_t bytes)
+ {
+     uint64_t cost = spi.syscall_ns + static_cast<uint64_t>(transfers) * spi.transfer_ns +
+                     (bytes * 8U * 1000000000ULL) / spi.spi_hz;
+     stats.spi_transfers += transfers;
+     stats.spi_bytes += bytes;
+     stats.modelled_ns += cost;
+     if (spi.realtime)
+     {
+         sleep_for_ns(cost);
+     }
+ }
+
+ /**
+  * Fills the ROM font metric blocks (fonts 16..31 at ROM_FONT, 148 bytes
+  * each). Heights and formats are the FT800's; the proportional widths are
+  * an approximation, close enough for layout code to be exercised.
+  */
+ void GraphFt800Sim::load_font_rom()
+ {
+     static const uint8_t heights[16] = {8U, 8U, 16U, 16U, 13U, 17U, 20U, 22U, 29U, 38U, 16U, 20U, 25U, 28U, 36U, 49U};
+     uint32_t glyphs = 0x0B0000U;
+
+     for (uint32_t f = 0U; f < 16U; ++f)
+     {
+         uint8_t block[148];
+         (void)memset(block, 0, sizeof(block));
+         uint32_t height = heights[f];
+         bool fixed = (f < 4U);
+         uint32_t widest = 0U;
+
+         for (uint32_t c = 32U; c < 127U; ++c)
+         {
+             uint32_t w = fixed ? 8U : (height * 11U + 10U) / 20U;
+             if (!fixed)
+             {
+                 if (strchr(" .,:;'!|il", static_cast<int>(c)) != nullptr)
+                 {
+                     w = (height + 3U) / 4U;
+                 }
+                 else if (strchr("mwMW@", static_cast<int>(c)) != nullptr)
+                 {
+                     w = (height * 4U + 4U) / 5U;
+                 }
+             }
+             block[c] = static_cast<uint8_t>(w);
+             widest = (w > widest) ? w : widest;
+         }
+
+         uint32_t format = (f < 10U) ? 1U : 2U;   // L1 for 16..25, L4 for 26..31
+         uint32_t stride = (format == 1U) ? (widest + 7U) / 8U : (widest + 1U) / 2U;
+         uint32_t tail[5] = {htole32(format), htole32(stride), htole32(widest), htole32(height), htole32(glyphs)};
+         (void)memcpy(&block[128], tail, sizeof(tail));
+         (void)memcpy(&memory[ROM_FONT + f * sizeof(block)], block, sizeof(block));
+         glyphs += stride * height * 128U;
+     }
+ }
+
+ /** Power-on state: registers, empty ring, identity touch transform. */
+ void GraphFt800Sim::reset_device()
+ {
+     (void)memset(&memory[REG_ID], 0, RAM_CMD - REG_ID);
+     set_reg(REG_ID, chip_id);
+     set_reg(REG_FREQUENCY, 48000000U);
+     set_reg(REG_HSIZE, 480U);
+     set_reg(REG_VSIZE, 272U);
+     set_reg(REG_INT_MASK, 0xFFU);
+     set_reg(REG_TOUCH_RAW_XY, 0xFFFFFFFFU);
+     set_reg(REG_TOUCH_SCREEN_XY, untouched_xy);
+     set_reg(REG_TOUCH_TAG_XY, untouched_xy);
+     set_reg(REG_TOUCH_TRANSFORM_A, 0x10000U);
+     set_reg(REG_TOUCH_TRANSFORM_E, 0x10000U);
+     set_reg(ROM_FONT_ADDR, ROM_FONT);
+     busy_until_ns = 0U;
+     visible_read = cmd_read = cmd_write = cmd_dl = 0U;
+     faulted = false;
+     capturing = false;
+     in_reset = false;
+ }
+
+ uint32_t GraphFt800Sim::reg(uint32_t addr) const
+ {
+     uint32_t raw;
+     (void)memcpy(&raw, &memory[addr], sizeof(raw));
+     return le32toh(raw);
+ }
+
+ void GraphFt800Sim::set_reg(uint32_t addr, uint32_t value)
+ {
+     uint32_t raw = htole32(value);
+     (void)memcpy(&memory[addr], &raw, sizeof(raw));
+ }
+
+ /** Brings the time-derived registers and the host-visible read pointer up to date. */
+ void GraphFt800Sim::refresh_registers()
+ {
+     uint64_t now = now_ns();
+     uint64_t elapsed = now - start_ns;
+     set_reg(REG_FRAMES, static_cast<uint32_t>(elapsed / spi.frame_period_ns));
+     set_reg(REG_CLOCK, static_cast<uint32_t>((elapsed * 48U) / 1000U));
+
+     uint32_t target = faulted ? ring_fault : cmd_read;
+     if (now >= busy_until_ns && visible_read != target)
+     {
+         visible_read = target;
+         if (!faulted && visible_read == cmd_write)
+         {
+             raise_interrupt(INT_CMDEMPTY);
+         }
+     }
+     set_reg(REG_CMD_READ, visible_read);
+     set_reg(REG_CMD_WRITE, cmd_write);
+     set_reg(REG_CMD_DL, cmd_dl);
+ }
+
+ void GraphFt800Sim::read_mem(uint32_t addr, void* dst, size_t len)
+ {
+     (void)memcpy(dst, &memory[addr], len);
+     if (overlaps(addr, len, REG_INT_FLAGS))
+     {
+         set_reg(REG_INT_FLAGS, 0U);   // read-to-clear
+     }
+ }
+
+ /** Host write through SPI, including the register side effects the chip has. */
+ void GraphFt800Sim::write_mem(uint32_t addr, const void* src, size_t len)
+ {
+     uint32_t flags = reg(REG_INT_FLAGS);
+     const uint8_t* in = static_cast<const uint8_t*>(src);
+
+     for (size_t i = 0U; i < len; ++i)
+     {
+         uint32_t a = addr + static_cast<uint32_t>(i);
+         // ROM (fonts, chip ID) between RAM_G and RAM_DL is read-only.
+         if (a < ram_g_size || a >= RAM_DL)
+         {
+             memory[a] = in[i];
+         }
+     }
+     set_reg(REG_INT_FLAGS, flags);
+
+     if (overlaps(addr, len, REG_CPURESET))
+     {
+         bool hold = (reg(REG_CPURESET) & 1U) != 0U;
+         if (in_reset && !hold)
+         {
+             visible_read = cmd_read = cmd_write = cmd_dl = 0U;
+             busy_until_ns = 0U;
+             faulted = false;
+             capturing = false;
+         }
+         in_reset = hold;
+     }
+     if (overlaps(addr, len, REG_CMD_READ) && !faulted)
+     {
+         visible_read = cmd_read = reg(REG_CMD_READ) & ring_mask & ~3U;
+     }
+     if (overlaps(addr, len, REG_CMD_DL))
+     {
+         cmd_dl = reg(REG_CMD_DL) & (ram_dl_size - 1U);
+     }
+     if (overlaps(addr, len, REG_DLSWAP) && reg(REG_DLSWAP) != 0U)
+     {
+         swap_lists();
+         set_reg(REG_DLSWAP, 0U);
+     }
+     if (overlaps(addr, len, REG_CMD_WRITE))
+     {
+         cmd_write = reg(REG_CMD_WRITE) & ring_mask & ~3U;
+         run_coprocessor();
+     }
+     refresh_registers();
+ }
+
+ uint32_t GraphFt800Sim::ring_used() const
+ {
+     return (cmd_write - cmd_read) & ring_mask;
+ }
+
+ /** Appends @p len bytes at REG_CMD_WRITE and kicks the co-processor, as the driver does. */
+ bool GraphFt800Sim::ring_write(const uint8_t* data, size_t len, int* error)
+ {
+     if (faulted || in_reset)
+     {
+         *error = EIO;
+         return false;
+     }
+     if ((len % 4U) != 0U || len > (ring_size - 4U - ring_used()))
+     {
+         *error = (len % 4U) != 0U ? EINVAL : EAGAIN;
+         return false;
+     }
+     for (size_t i = 0U; i < len; ++i)
+     {
+         memory[RAM_CMD + ((cmd_write + i) & ring_mask)] = data[i];
+     }
+     cmd_write = (cmd_write + static_cast<uint32_t>(len)) & ring_mask;
+     run_coprocessor();
+     refresh_registers();
+     return true;
+ }
+
+ bool GraphFt800Sim::ring_submit_words(const std::vector<uint32_t>& words, int* error)
+ {
+     std::vector<uint8_t> bytes(words.size() * sizeof(uint32_t));
+     for (size_t i = 0U; i < words.size(); ++i)
+     {
+         uint32_t raw = htole32(words[i]);
+         (void)memcpy(&bytes[i * sizeof(uint32_t)], &raw, sizeof(raw));
+     }
+     charge(3U, bytes.size() + 13U);
+     return ring_write(bytes.data(), bytes.size(), error);
+ }
+
+ uint32_t GraphFt800Sim::ring_word(uint32_t offset) const
+ {
+     uint32_t raw;
+     (void)memcpy(&raw, &memory[RAM_CMD + (offset & ring_mask)], sizeof(raw));
+     return le32toh(raw);
+ }
+
+ void GraphFt800Sim::set_ring_word(uint32_t offset, uint32_t value)
+ {
+     uint32_t raw = htole32(value);
+     (void)memcpy(&memory[RAM_CMD + (offset & ring_mask)], &raw, sizeof(raw));
+ }
+
+ void GraphFt800Sim::ring_copy(uint32_t offset, uint8_t* dst, uint32_t len) const
+ {
+     for (uint32_t i = 0U; i < len; ++i)
+     {
+         dst[i] = memory[RAM_CMD + ((offset + i) & ring_mask)];
+     }
+ }
+
+ /**
+  * Finds the NUL-terminated string at @p offset. @p bytes receives its
+  * padded size in the ring and @p length the character count.
+  */
+ bool GraphFt800Sim::ring_string(uint32_t offset, uint32_t available, uint32_t* bytes, uint32_t* length)
+ {
+     for (uint32_t i = 0U; i < available; ++i)
+     {
+         if (memory[RAM_CMD + ((offset + i) & ring_mask)] == 0U)
+         {
+             *length = i;
+             *bytes = (i + 4U) & ~3U;
+             return true;
+         }
+     }
+     return false;
+ }
+
+ /**
+  * Decodes the zlib stream at @p offset into RAM_G at @p dest. Like the
+  * co-processor, only the deflate data is used; the adler32 trailer is
+  * skipped but not verified.
+  */
+ GraphFt800Sim::exec_t GraphFt800Sim::inflate_from_ring(uint32_t offset, uint32_t available, uint32_t dest, uint32_t* bytes)
+ {
+ #ifdef GRAPH_HAVE_ZLIB
+     if (available < 2U)
+     {
+         return exec_t::WAIT;
+     }
+     std::vector<uint8_t> input(available);
+     ring_copy(offset, input.data(), available);
+     std::vector<uint8_t> output(ram_g_size);
+
+     z_stream stream{};
+     stream.next_in = input.data() + 2;
+     stream.avail_in = available - 2U;
+     stream.next_out = output.data();
+     stream.avail_out = (dest < ram_g_size) ? (ram_g_size - dest) : 0U;
+     if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+     {
+         return exec_t::FAULT;
+     }
+     int status = inflate(&stream, Z_FINISH);
+     uint32_t used = 2U + static_cast<uint32_t>(stream.total_in) + 4U;
+     uint32_t produced = static_cast<uint32_t>(stream.total_out);
+     (void)inflateEnd(&stream);
+
+     if (status != Z_STREAM_END)
+     {
+         // Out of input: the rest of the stream has not been written yet.
+         return (status == Z_BUF_ERROR && stream.avail_out != 0U) ? exec_t::WAIT : exec_t::FAULT;
+     }
+     if (used > available)
+     {
+         return exec_t::WAIT;
+     }
+     (void)memcpy(&memory[dest], output.data(), produced);
+     inflate_end = dest + produced;
+     *bytes = (used + 3U) & ~3U;
+     return exec_t::DONE;
+ #else
+     (void)offset;
+     (void)available;
+     (void)dest;
+     (void)bytes;
+     return exec_t::FAULT;
+ #endif
+ }
+
+ void GraphFt800Sim::emit_dl(uint32_t value)
+ {
+     if (cmd_dl >= ram_dl_size)
+     {
+         stats.dl_overflows++;
+         return;
+     }
+     set_reg(RAM_DL + cmd_dl, value);
+     cmd_dl += 4U;
+     stats.dl_words++;
+ }
+
+ /**
+  * Reserves display-list space for a widget the model does not draw.
+  * SAVE/RESTORE_CONTEXT pairs keep the list valid and state-neutral.
+  */
+ void GraphFt800Sim::emit_estimate(uint32_t words)
+ {
+     for (uint32_t i = 0U; i < (words + 1U) / 2U; ++i)
+     {
+         emit_dl(Graph_dl::save_context());
+         emit_dl(Graph_dl::restore_context());
+     }
+ }
+
+ void GraphFt800Sim::swap_lists()
+ {
+     shown_list.assign(cmd_dl / 4U, 0U);
+     for (uint32_t i = 0U; i < cmd_dl / 4U; ++i)
+     {
+         shown_list[i] = reg(RAM_DL + i * 4U);
+     }
+     stats.swaps++;
+     raise_interrupt(INT_SWAP);
+ }
+
+ void GraphFt800Sim::raise_interrupt(uint8_t flags)
+ {
+     set_reg(REG_INT_FLAGS, reg(REG_INT_FLAGS) | flags);
+ }
+
+ void GraphFt800Sim::fault()
+ {
+     faulted = true;
+     visible_read = ring_fault;
+     stats.faults++;
+ }
+
+ /** Executes everything between the read and write pointers that is complete. */
+ void GraphFt800Sim::run_coprocessor()
+ {
+     if (faulted || in_reset)
+     {
+         return;
+     }
+     uint64_t words_before = stats.command_words + stats.dl_words;
+
+     while (cmd_read != cmd_write)
+     {
+         uint32_t available = (cmd_write - cmd_read) & ring_mask;
+         uint32_t word = ring_word(cmd_read);
+         uint32_t consumed = 4U;
+
+         if ((word & 0xFFFFFF00U) == 0xFFFFFF00U)
+         {
+             exec_t result = execute(word, available, &consumed);
+             if (result == exec_t::WAIT)
+             {
+                 break;
+             }
+             if (result == exec_t::FAULT)
+             {
+                 fault();
+                 break;
+             }
+         }
+         else
+         {
+             emit_dl(word);
+         }
+
+         if (word == CMD_DLSTART)
+         {
+             frame_commands.clear();
+             capturing = true;
+         }
+         if (capturing)
+         {
+             for (uint32_t i = 0U; i < consumed; i += 4U)
+             {
+                 frame_commands.push_back(ring_word(cmd_read + i));
+             }
+         }
+         if (word == CMD_SWAP && capturing)
+         {
+             shown_commands.swap(frame_commands);
+             frame_commands.clear();
+             capturing = false;
+         }
+
+         cmd_read = (cmd_read + consumed) & ring_mask;
+         stats.command_words += consumed / 4U;
+     }
+
+     uint64_t cost = (stats.command_words + stats.dl_words - words_before) * spi.coprocessor_ns_per_word;
+     stats.modelled_ns += cost;
+     uint64_t now = now_ns();
+     busy_until_ns = spi.realtime ? (((busy_until_ns > now) ? busy_until_ns : now) + cost) : 0U;
+ }
+
+ /**
+  * Executes one co-processor command. Argument counts and payload rules
+  * follow the FT800 Programmer's Guide; widget display-list sizes are
+  * estimates.
+  */
+ GraphFt800Sim::exec_t GraphFt800Sim::execute(uint32_t opcode, uint32_t available, uint32_t* consumed)
+ {
+     uint32_t args = 0U;        // argument words after the opcode
+     uint32_t text_length = 0U;
+     bool has_string = false;
+
+     if (opcode == CMD_INFLATE)
+     {
+         args = 1U;              // followed by the zlib stream
+     }
+     else if (!GraphDlBudget::command_layout(opcode, &args, &has_string))
+     {
+         // Includes CMD_LOADIMAGE: JPEG decoding is not modelled.
+         return exec_t::FAULT;
+     }
+
+     uint32_t fixed = 4U + args * 4U;
+     if (available < fixed)
+     {
+         return exec_t::WAIT;
+     }
+     uint32_t a0 = (args > 0U) ? ring_word(cmd_read + 4U) : 0U;
+     uint32_t a1 = (args > 1U) ? ring_word(cmd_read + 8U) : 0U;
+     uint32_t a2 = (args > 2U) ? ring_word(cmd_read + 12U) : 0U;
+     uint32_t total = fixed;
+
+     if (has_string)
+     {
+         uint32_t bytes = 0U, length = 0U;
+         if (!ring_string(cmd_read + fixed, available - fixed, &bytes, &length))
+         {
+             return exec_t::WAIT;
+         }
+         total += bytes;
+         text_length = length;
+     }
+
+     switch (opcode)
+     {
+     case CMD_DLSTART:
+         cmd_dl = 0U;
+         break;
+
+     case CMD_SWAP:
+         swap_lists();
+         break;
+
+     case CMD_INTERRUPT:
+         raise_interrupt(INT_CMDFLAG);
+         break;
+
+     case CMD_CALIBRATE:
+         set_ring_word(cmd_read + 4U, 1U);
+         break;
+
+     case CMD_MEMWRITE:
+     {
+         uint32_t payload = (a1 + 3U) & ~3U;
+         if (available < fixed + payload)
+         {
+             return exec_t::WAIT;
+         }
+         if (a0 + a1 > memory_size)
+         {
+             return exec_t::FAULT;
+         }
+         std::vector<uint8_t> data(a1);
+         ring_copy(cmd_read + fixed, data.data(), a1);
+         (void)memcpy(&memory[a0], data.data(), a1);
+         total += payload;
+         break;
+     }
+
+     case CMD_INFLATE:
+     {
+         uint32_t bytes = 0U;
+         exec_t result = inflate_from_ring(cmd_read + fixed, available - fixed, a0, &bytes);
+         if (result != exec_t::DONE)
+         {
+             return result;
+         }
+         total += bytes;
+         break;
+     }
+
+     case CMD_MEMSET:
+     case CMD_MEMZERO:
+     {
+         uint32_t count = (opcode == CMD_MEMSET) ? a2 : a1;
+         if (a0 + count > memory_size)
+         {
+             return exec_t::FAULT;
+         }
+         (void)memset(&memory[a0], (opcode == CMD_MEMSET) ? static_cast<int>(a1 & 0xFFU) : 0, count);
+         break;
+     }
+
+     case CMD_MEMCPY:
+         if (a0 + a2 > memory_size || a1 + a2 > memory_size)
+         {
+             return exec_t::FAULT;
+         }
+         (void)memmove(&memory[a0], &memory[a1], a2);
+         break;
+
+     case CMD_MEMCRC:
+     {
+         if (a0 + a1 > memory_size)
+         {
+             return exec_t::FAULT;
+         }
+         uint32_t crc = 0xFFFFFFFFU;
+         for (uint32_t i = 0U; i < a1; ++i)
+         {
+             crc ^= memory[a0 + i];
+             for (int bit = 0; bit < 8; ++bit)
+             {
+                 crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+             }
+         }
+         set_ring_word(cmd_read + 12U, ~crc);
+         break;
+     }
+
+     case CMD_REGREAD:
+         set_ring_word(cmd_read + 8U, (a0 + 4U <= memory_size) ? reg(a0 & ~3U) : 0U);
+         break;
+
+     case CMD_APPEND:
+         if (a0 + a1 > memory_size)
+         {
+             return exec_t::FAULT;
+         }
+         for (uint32_t i = 0U; i + 4U <= a1; i += 4U)
+         {
+             emit_dl(reg(a0 + i));
+         }
+         break;
+
+     case CMD_GETPTR:
+         set_ring_word(cmd_read + 4U, inflate_end);
+         break;
+
+     case CMD_GETPROPS:
+         set_ring_word(cmd_read + 4U, inflate_end);
+         break;
+
+     default:
+         break;
+     }
+
+     emit_estimate(GraphDlBudget::widget_dl_words(opcode, text_length));
+     *consumed = total;
+     return exec_t::DONE;
+ }
+
+ int GraphFt800Sim::ioctl(unsigned long request, void* arg)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     int error = 0;
+
+     stats.calls++;
+     refresh_registers();
+
+     switch (request)
+     {
+     case FT800_IOCTL_SUBMIT_CMDS:
+     {
+         const struct ft800_uapi_cmdlist* list = static_cast<const struct ft800_uapi_cmdlist*>(arg);
+         if (list == nullptr || list->user_ptr == 0U)
+         {
+             error = EFAULT;
+             break;
+         }
+         charge(3U, static_cast<uint64_t>(list->len) + 13U);
+         (void)ring_write(reinterpret_cast<const uint8_t*>(static_cast<uintptr_t>(list->user_ptr)), list->len, &error);
+         break;
+     }
+
+     case FT800_IOCTL_PUSH_MMAP:
+     {
+         const struct ft800_uapi_mmap_push* push = static_cast<const struct ft800_uapi_mmap_push*>(arg);
+         if (push == nullptr || staging.empty() ||
+             static_cast<size_t>(push->addr) + push->len > staging.size() * sizeof(uint32_t))
+         {
+             error = EINVAL;
+             break;
+         }
+         charge(3U, static_cast<uint64_t>(push->len) + 13U);
+         (void)ring_write(reinterpret_cast<const uint8_t*>(staging.data()) + push->addr, push->len, &error);
+         break;
+     }
+
+     case FT800_IOCTL_CMD_WRITE:
+     {
+         // {offset, len, data[]} packed into the ft800_cmd[32] sized argument
+         const uint8_t* raw = static_cast<const uint8_t*>(arg);
+         uint32_t offset = 0U, len = 0U;
+         if (raw == nullptr)
+         {
+             error = EFAULT;
+             break;
+         }
+         (void)memcpy(&offset, raw, sizeof(offset));
+         (void)memcpy(&len, raw + 4, sizeof(len));
+         if (len > sizeof(struct ft800_cmd) * 32U - 8U || (offset & 3U) != 0U || (len & 3U) != 0U)
+         {
+             error = EINVAL;
+             break;
+         }
+         charge(2U, static_cast<uint64_t>(len) + 7U);
+         for (uint32_t i = 0U; i < len; ++i)
+         {
+             memory[RAM_CMD + ((offset + i) & ring_mask)] = raw[8U + i];
+         }
+         cmd_write = (offset + len) & ring_mask;
+         run_coprocessor();
+         refresh_registers();
+         break;
+     }
+
+     case FT800_IOCTL_MEMWRITE:
+     case FT800_IOCTL_MEMREAD:
+     {
+         struct ft800_mem_op* op = static_cast<struct ft800_mem_op*>(arg);
+         if (op == nullptr || op->len > sizeof(op->data) || static_cast<uint64_t>(op->addr) + op->len > memory_size)
+         {
+             error = EINVAL;
+             break;
+         }
+         if (request == FT800_IOCTL_MEMWRITE)
+         {
+             charge(1U, static_cast<uint64_t>(op->len) + write_header);
+             write_mem(op->addr, op->data, op->len);
+         }
+         else
+         {
+             charge(1U, static_cast<uint64_t>(op->len) + read_header);
+             read_mem(op->addr, op->data, op->len);
+         }
+         break;
+     }
+
+     case FT800_IOCTL_GET_STATUS:
+     {
+         struct ft800_status* status = static_cast<struct ft800_status*>(arg);
+         if (status == nullptr)
+         {
+             error = EFAULT;
+             break;
+         }
+         charge(2U, 8U + 2U * read_header + 1U);
+         status->cmd_read = htole16(static_cast<uint16_t>(visible_read));
+         status->cmd_write = htole16(static_cast<uint16_t>(cmd_write));
+         status->id = static_cast<__u8>(chip_id);
+         status->pad = 0U;
+         break;
+     }
+
+     case FT800_IOCTL_CLEAR_DL:
+     {
+         // The driver resets the ring and shows its own 20-byte blue screen.
+         charge(4U, 20U + 3U * 7U + write_header);
+         visible_read = cmd_read = cmd_write = cmd_dl = 0U;
+         busy_until_ns = 0U;
+         faulted = false;
+         capturing = false;
+         emit_dl(Graph_dl::clear_color_rgb(0, 0, 0x80));
+         emit_dl(Graph_dl::clear_color_a(0xFF));
+         emit_dl(Graph_dl::clear_tag(0));
+         emit_dl(Graph_dl::clear(true, true, true));
+         emit_dl(Graph_dl::display());
+         swap_lists();
+         cmd_dl = 0U;
+         refresh_registers();
+         break;
+     }
+
+     case FT800_IOCTL_RESET:
+     {
+         const struct ft800_uapi_reset* reset = static_cast<const struct ft800_uapi_reset*>(arg);
+         charge(4U, 4U * 7U);
+         reset_device();
+         if (reset != nullptr && reset->clear_display != 0U)
+         {
+             emit_dl(Graph_dl::clear_color_rgb(reset->r, reset->g, reset->b));
+             emit_dl(Graph_dl::clear(true, true, true));
+             emit_dl(Graph_dl::display());
+             swap_lists();
+             cmd_dl = 0U;
+         }
+         refresh_registers();
+         break;
+     }
+
+     case FT800_IOCTL_GET_TOUCH:
+     {
+         struct ft800_touch* touch_state = static_cast<struct ft800_touch*>(arg);
+         if (touch_state == nullptr)
+         {
+             error = EFAULT;
+             break;
+         }
+         charge(2U, 4U + 1U + 2U * read_header);
+         uint32_t xy = reg(REG_TOUCH_SCREEN_XY);
+         touch_state->x = htole16(static_cast<uint16_t>(xy >> 16));
+         touch_state->y = htole16(static_cast<uint16_t>(xy));
+         touch_state->tag = static_cast<__u8>(reg(REG_TOUCH_TAG));
+         touch_state->pad = 0U;
+         break;
+     }
+
+     case FT800_IOCTL_WR8:
+     case FT800_IOCTL_RD8:
+     {
+         struct ft800_uapi_rw8* rw = static_cast<struct ft800_uapi_rw8*>(arg);
+         if (rw == nullptr || rw->addr >= memory_size)
+         {
+             error = EINVAL;
+             break;
+         }
+         if (request == FT800_IOCTL_WR8)
+         {
+             charge(1U, 1U + write_header);
+             write_mem(rw->addr, &rw->value, 1U);
+         }
+         else
+         {
+             charge(1U, 1U + read_header);
+             read_mem(rw->addr, &rw->value, 1U);
+         }
+         break;
+     }
+
+     case FT800_IOCTL_WR16:
+     case FT800_IOCTL_RD16:
+     {
+         struct ft800_uapi_rw16* rw = static_cast<struct ft800_uapi_rw16*>(arg);
+         if (rw == nullptr || rw->addr + 2U > memory_size)
+         {
+             error = EINVAL;
+             break;
+         }
+         if (request == FT800_IOCTL_WR16)
+         {
+             uint16_t raw = htole16(rw->value);
+             charge(1U, 2U + write_header);
+             write_mem(rw->addr, &raw, 2U);
+         }
+         else
+         {
+             uint16_t raw = 0U;
+             charge(1U, 2U + read_header);
+             read_mem(rw->addr, &raw, 2U);
+             rw->value = le16toh(raw);
+         }
+         break;
+     }
+
+     case FT800_IOCTL_EXEC_CMDS:
+     {
+         // The driver encodes each descriptor into RAM_CMD and writes the lot at once.
+         const struct ft800_uapi_exec_cmds* batch = static_cast<const struct ft800_uapi_exec_cmds*>(arg);
+         if (batch == nullptr || batch->user_ptr == 0U)
+         {
+             error = EFAULT;
+             break;
+         }
+         const struct ft800_cmd* cmds = reinterpret_cast<const struct ft800_cmd*>(static_cast<uintptr_t>(batch->user_ptr));
+         GraphCmdEncoder encoder;
+         for (uint32_t i = 0U; i < batch->count && error == 0; ++i)
+         {
+             if (!GraphCmdBatch::expand(cmds[i], encoder))
+             {
+                 error = EINVAL;
+             }
+         }
+         if (error != 0)
+         {
+             break;
+         }
+         if (encoder.size() * sizeof(uint32_t) > ring_size - 4U)
+         {
+             error = E2BIG;
+             break;
+         }
+         std::vector<uint32_t> words(encoder.data(), encoder.data() + encoder.size());
+         (void)ring_submit_words(words, &error);
+         break;
+     }
+
+     default:
+     {
+         bool handled = false;
+         error = legacy_ioctl(request, arg, &handled);
+         if (!handled)
+         {
+             error = ENOTTY;
+         }
+         break;
+     }
+     }
+
+     if (error != 0)
+     {
+         errno = error;
+         return -1;
+     }
+     return 0;
+ }
+
+ /** The 'f' interface: one immediate-mode command per call, fed through the ring. */
+ int GraphFt800Sim::legacy_ioctl(unsigned long request, void* arg, bool* handled)
+ {
+     GraphCmdEncoder encoder;
+     int error = 0;
+     *handled = true;
+
+     switch (request)
+     {
+     case FT800_IOC_INITIALISE:
+         charge(8U, 8U * 7U);
+         return 0;
+
+     case FT800_IOC_CMD_DLSTART:   encoder.cmd_dlstart(); break;
+     case FT800_IOC_CMD_SWAP:      encoder.cmd_swap(); break;
+     case FT800_IOC_CMD_CALIBRATE: encoder.cmd_calibrate(); break;
+     case FT800_IOC_DISPLAY:       encoder.display(); break;
+     case FT800_IOC_END:           encoder.end(); break;
+
+     case FT800_IOC_CMD_BUTTON:
+     {
+         const struct ft800_cmd_button* a = static_cast<const struct ft800_cmd_button*>(arg);
+         char text[sizeof(a->text) + 1U] = { 0 };
+         (void)memcpy(text, a->text, sizeof(a->text));
+         encoder.cmd_button(static_cast<int16_t>(a->x), static_cast<int16_t>(a->y), static_cast<int16_t>(a->w),
+                            static_cast<int16_t>(a->h), static_cast<int16_t>(a->font), a->options, text);
+         break;
+     }
+
+     case FT800_IOC_CMD_TEXT:
+     {
+         const struct ft800_cmd_text* a = static_cast<const struct ft800_cmd_text*>(arg);
+         char text[sizeof(a->text) + 1U] = { 0 };
+         (void)memcpy(text, a->text, sizeof(a->text));
+         encoder.cmd_text(static_cast<int16_t>(a->x), static_cast<int16_t>(a->y), static_cast<int16_t>(a->font),
+                          a->options, text);
+         break;
+     }
+
+     case FT800_IOC_CMD_SPINNER:
+     {
+         const struct ft800_cmd_spinner* a = static_cast<const struct ft800_cmd_spinner*>(arg);
+         encoder.cmd_spinner(static_cast<int16_t>(a->x), static_cast<int16_t>(a->y), a->style, a->scale);
+         break;
+     }
+
+     case FT800_IOC_BEGIN_BITMAP:
+         encoder.begin_bitmap(*static_cast<const uint8_t*>(arg));
+         break;
+
+     case FT800_IOC_BITMAP_LAYOUT:
+     {
+         const struct ft800_bitmap_layout* a = static_cast<const struct ft800_bitmap_layout*>(arg);
+         encoder.bitmap_layout(a->format, a->linestride, a->height);
+         break;
+     }
+
+     case FT800_IOC_BITMAP_SIZE:
+     {
+         const struct ft800_bitmap_size* a = static_cast<const struct ft800_bitmap_size*>(arg);
+         encoder.bitmap_size(a->filter, a->wrapx, a->wrapy, a->width, a->height);
+         break;
+     }
+
+     case FT800_IOC_CLEAR:
+     {
+         const struct ft800_clear_args* a = static_cast<const struct ft800_clear_args*>(arg);
+         encoder.clear(a->c, a->s, a->t);
+         break;
+     }
+
+     case FT800_IOC_CLEAR_COLOR_RGB:
+     {
+         const struct ft800_rgb* a = static_cast<const struct ft800_rgb*>(arg);
+         encoder.clear_color_rgb(a->r, a->g, a->b);
+         break;
+     }
+
+     case FT800_IOC_SET_TAG:
+         encoder.tag(*static_cast<const uint8_t*>(arg));
+         break;
+
+     case FT800_IOC_GET_TOUCH_RAW:
+     case FT800_IOC_GET_TOUCH_SCREEN:
+     {
+         struct ft800_touch_xy* xy = static_cast<struct ft800_touch_xy*>(arg);
+         uint32_t value = reg((request == FT800_IOC_GET_TOUCH_RAW) ? REG_TOUCH_RAW_XY : REG_TOUCH_SCREEN_XY);
+         charge(1U, 4U + read_header);
+         xy->x = static_cast<uint16_t>(value >> 16);
+         xy->y = static_cast<uint16_t>(value);
+         return 0;
+     }
+
+     case FT800_IOC_GET_TOUCH_TAG:
+         charge(1U, 1U + read_header);
+         *static_cast<uint8_t*>(arg) = static_cast<uint8_t>(reg(REG_TOUCH_TAG));
+         return 0;
+
+     case FT800_IOC_FIFO_EMPTY:
+         charge(2U, 4U + 2U * read_header);
+         *static_cast<int*>(arg) = (!faulted && visible_read == cmd_write) ? 1 : 0;
+         return 0;
+
+     case FT800_IOC_UPDATE_FIFO_PTR:
+     {
+         uint32_t ptr = htole32(*static_cast<const uint32_t*>(arg));
+         charge(1U, 4U + write_header);
+         write_mem(REG_CMD_WRITE, &ptr, sizeof(ptr));
+         return 0;
+     }
+
+     case FT800_IOC_LOAD_BITMAP:
+     {
+         const struct ft800_load_bitmap* a = static_cast<const struct ft800_load_bitmap*>(arg);
+         if (a->src == nullptr || static_cast<uint64_t>(a->dst_addr) + a->size > ram_g_size)
+         {
+             return EINVAL;
+         }
+         charge(1U, a->size + write_header);
+         write_mem(a->dst_addr, a->src, a->size);
+         return 0;
+     }
+
+     case FT800_IOC_SET_CALIBRATION:
+     {
+         const struct ft800_cal_data* cal = static_cast<const struct ft800_cal_data*>(arg);
+         charge(1U, sizeof(cal->transform) + write_header);
+         for (uint32_t i = 0U; i < 6U; ++i)
+         {
+             set_reg(REG_TOUCH_TRANSFORM_A + i * 4U, static_cast<uint32_t>(cal->transform[i]));
+         }
+         return 0;
+     }
+
+     case FT800_IOC_GET_CAL_STATUS:
+         *static_cast<int*>(arg) = 1;
+         return 0;
+
+     default:
+         *handled = false;
+         return 0;
+     }
+
+     std::vector<uint32_t> words(encoder.data(), encoder.data() + encoder.size());
+     (void)ring_submit_words(words, &error);
+     return error;
+ }
+
+ void* GraphFt800Sim::mmap(size_t bytes)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     if (bytes == 0U || !staging.empty())
+     {
+         errno = EINVAL;
+         return nullptr;
+     }
+     staging.assign((bytes + 3U) / 4U, 0U);
+     return staging.data();
+ }
+
+ void GraphFt800Sim::munmap(void* area, size_t bytes)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     (void)bytes;
+     if (area == staging.data())
+     {
+         staging.clear();
+         staging.shrink_to_fit();
+     }
+ }
+
+ /** Waits for an enabled, unmasked interrupt flag, like the driver's poll(). */
+ int GraphFt800Sim::poll(short events, int timeout_ms, short* revents)
+ {
+     std::unique_lock<std::mutex> guard(lock);
+     uint64_t deadline = now_ns() + static_cast<uint64_t>((timeout_ms < 0) ? 1000 : timeout_ms) * 1000000ULL;
+
+     stats.calls++;
+     charge(0U, 0U);
+     for (;;)
+     {
+         refresh_registers();
+         if ((reg(REG_INT_EN) & 1U) != 0U && (reg(REG_INT_FLAGS) & reg(REG_INT_MASK)) != 0U)
+         {
+             if (revents != nullptr)
+             {
+                 *revents = static_cast<short>(events & (POLLIN | POLLPRI));
+             }
+             return 1;
+         }
+         uint64_t now = now_ns();
+         if (now >= deadline)
+         {
+             if (revents != nullptr)
+             {
+                 *revents = 0;
+             }
+             return 0;
+         }
+         uint64_t step = deadline - now;
+         if (busy_until_ns > now && (busy_until_ns - now) < step)
+         {
+             step = busy_until_ns - now;
+         }
+         if (step > 1000000ULL)
+         {
+             step = 1000000ULL;
+         }
+         guard.unlock();
+         sleep_for_ns(step);
+         guard.lock();
+     }
+ }
+
+ /** Burst read of device memory, as the driver's read()/pread() file operation. */
+ ssize_t GraphFt800Sim::pread(void* buffer, size_t len, off_t addr)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     if (buffer == nullptr || addr < 0 || static_cast<uint64_t>(addr) + len > memory_size)
+     {
+         errno = EINVAL;
+         return -1;
+     }
+     stats.calls++;
+     refresh_registers();
+     charge(1U, len + read_header);
+     read_mem(static_cast<uint32_t>(addr), buffer, len);
+     return static_cast<ssize_t>(len);
+ }
+
+ /** Presses the panel at (@p x, @p y) over a widget tagged @p tag. */
+ void GraphFt800Sim::touch(uint16_t x, uint16_t y, uint8_t tag)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     uint32_t xy = (static_cast<uint32_t>(x) << 16) | y;
+     set_reg(REG_TOUCH_RAW_XY, xy);
+     set_reg(REG_TOUCH_RZ, 1000U);
+     set_reg(REG_TOUCH_SCREEN_XY, xy);
+     set_reg(REG_TOUCH_TAG_XY, xy);
+     set_reg(REG_TOUCH_TAG, tag);
+     set_reg(REG_TAG_X, x);
+     set_reg(REG_TAG_Y, y);
+     set_reg(REG_TAG, tag);
+     raise_interrupt(static_cast<uint8_t>(INT_TOUCH | INT_TAG));
+ }
+
+ /** Lifts the finger. */
+ void GraphFt800Sim::release()
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     set_reg(REG_TOUCH_RAW_XY, 0xFFFFFFFFU);
+     set_reg(REG_TOUCH_RZ, 32767U);
+     set_reg(REG_TOUCH_SCREEN_XY, untouched_xy);
+     set_reg(REG_TOUCH_TAG_XY, untouched_xy);
+     set_reg(REG_TOUCH_TAG, 0U);
+     set_reg(REG_TAG, 0U);
+     raise_interrupt(static_cast<uint8_t>(INT_TOUCH | INT_TAG));
+ }
+
+ /** Puts the co-processor into the fault state, as an illegal command would. */
+ void GraphFt800Sim::inject_fault()
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     fault();
+     refresh_registers();
+ }
+
+ /** Reads model memory without charging the bus (for tools and checks). */
+ void GraphFt800Sim::peek(uint32_t addr, void* dst, size_t len)
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     if (dst != nullptr && static_cast<uint64_t>(addr) + len <= memory_size)
+     {
+         refresh_registers();
+         (void)memcpy(dst, &memory[addr], len);
+     }
+ }
+
+ /** RAM_DL as it was at the last swap. */
+ std::vector<uint32_t> GraphFt800Sim::displayed_list()
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     return shown_list;
+ }
+
+ /** Co-processor words from the last CMD_DLSTART up to its CMD_SWAP. */
+ std::vector<uint32_t> GraphFt800Sim::displayed_commands()
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     return shown_commands;
+ }
+
+ GraphFt800Sim::stats_t GraphFt800Sim::get_stats()
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     return stats;
+ }
+
+ void GraphFt800Sim::reset_stats()
+ {
+     std::lock_guard<std::mutex> guard(lock);
+     stats = stats_t();
+ }
@@ -0,0 +1,153 @@
+/**
+ * @file graph_ft800_sim.h
+ * @brief Software FT800 model answering the driver's ioctl surface.
+ */
+
+ #ifndef GRAPH_FT800_SIM_H
+ #define GRAPH_FT800_SIM_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <mutex>
+ #include <vector>
+ #include "graph_transport.h"
+
+ /**
+  * Stand-in for /dev/ft800 so the graphics library, the examples and the
+  * benchmarks run on any Linux host:
+  *
+  *     GraphFt800Sim sim;
+  *     GraphFt800 ft800(sim);
+  *
+  * The model keeps RAM_G, RAM_DL, RAM_PAL, the register file and the 4 KB
+  * RAM_CMD ring in one flat address space. Advancing REG_CMD_WRITE runs the
+  * co-processor: display-list words go to RAM_DL at REG_CMD_DL, every
+  * co-processor command is parsed to its real length (strings, MEMWRITE
+  * and INFLATE payloads included), widgets reserve an estimated number of
+  * display-list words, and an unknown opcode faults the ring (REG_CMD_READ
+  * = 0xFFF) until REG_CPURESET is toggled. REG_FRAMES, REG_CLOCK, the
+  * interrupt flags and the touch registers behave as on the chip.
+  *
+  * Both ioctl sets are served: the 'F' driver API in ft800_uapi.h and the
+  * legacy 'f' calls in graph_ft800_ioctl.h. EXEC_CMDS descriptors are
+  * expanded with GraphCmdBatch::expand(), as the driver encodes them.
+  *
+  * Every call is charged against an SPI cost model (syscall, chip-select,
+  * address header and payload at spi_hz, plus co-processor time per word).
+  * With realtime set the model sleeps for that time and REG_CMD_READ only
+  * catches up once the modelled execution time has passed, so throughput
+  * figures and wait loops behave like the BeagleBone rather than like a
+  * memcpy.
+  */
+ class GraphFt800Sim : public GraphTransport
+ {
+ public:
+     struct spi_model_t
+     {
+         uint32_t spi_hz;                   //!< SPI clock
+         uint32_t syscall_ns;               //!< Fixed cost per ioctl / pread / poll
+         uint32_t transfer_ns;              //!< Chip-select and setup per SPI transfer
+         uint32_t coprocessor_ns_per_word;  //!< Co-processor time per consumed or emitted word
+         uint32_t frame_period_ns;          //!< REG_FRAMES period
+         bool realtime;                     //!< Sleep for the modelled time
+     };
+
+     struct stats_t
+     {
+         uint64_t calls;             //!< ioctl, pread and poll calls
+         uint64_t spi_transfers;
+         uint64_t spi_bytes;         //!< Including address and dummy bytes
+         uint64_t modelled_ns;       //!< Total modelled bus + co-processor time
+         uint64_t command_words;     //!< Words consumed from RAM_CMD
+         uint64_t dl_words;          //!< Words written to RAM_DL by the co-processor
+         uint32_t swaps;
+         uint32_t faults;
+         uint32_t dl_overflows;
+     };
+
+     static const spi_model_t default_spi_model;
+     static const uint32_t memory_size = 0x109000U;  // up to the end of RAM_CMD
+
+     GraphFt800Sim();
+     ~GraphFt800Sim();
+
+     void set_spi_model(const spi_model_t& model);
+     const spi_model_t& get_spi_model() const { return spi; }
+
+     // GraphTransport
+     bool is_open() const override { return true; }
+     int ioctl(unsigned long request, void* arg) override;
+     void* mmap(size_t bytes) override;
+     void munmap(void* area, size_t bytes) override;
+     int poll(short events, int timeout_ms, short* revents) override;
+     ssize_t pread(void* buffer, size_t len, off_t addr) override;
+
+     // Test and tooling hooks
+     void touch(uint16_t x, uint16_t y, uint8_t tag);
+     void release();
+     void inject_fault();
+     void peek(uint32_t addr, void* dst, size_t len);
+     std::vector<uint32_t> displayed_list();
+     std::vector<uint32_t> displayed_commands();
+
+     stats_t get_stats();
+     void reset_stats();
+
+ private:
+     enum class exec_t : uint8_t
+     {
+         DONE = 0,
+         WAIT,     //!< Command not completely in the ring yet
+         FAULT
+     };
+
+     static uint64_t now_ns();
+
+     void charge(uint32_t transfers, uint64_t bytes);
+     void reset_device();
+     void load_font_rom();
+     void refresh_registers();
+     uint32_t reg(uint32_t addr) const;
+     void set_reg(uint32_t addr, uint32_t value);
+     void read_mem(uint32_t addr, void* dst, size_t len);
+     void write_mem(uint32_t addr, const void* src, size_t len);
+     bool ring_write(const uint8_t* data, size_t len, int* error);
+     bool ring_submit_words(const std::vector<uint32_t>& words, int* error);
+     uint32_t ring_used() const;
+
+     void run_coprocessor();
+     exec_t execute(uint32_t opcode, uint32_t available, uint32_t* consumed);
+     uint32_t ring_word(uint32_t offset) const;
+     void set_ring_word(uint32_t offset, uint32_t value);
+     bool ring_string(uint32_t offset, uint32_t available, uint32_t* bytes, uint32_t* length);
+     void ring_copy(uint32_t offset, uint8_t* dst, uint32_t len) const;
+     exec_t inflate_from_ring(uint32_t offset, uint32_t available, uint32_t dest, uint32_t* bytes);
+     void emit_dl(uint32_t value);
+     void emit_estimate(uint32_t words);
+     void swap_lists();
+     void raise_interrupt(uint8_t flags);
+     void fault();
+
+     int legacy_ioctl(unsigned long request, void* arg, bool* handled);
+
+     std::mutex lock;
+     spi_model_t spi;
+     std::vector<uint8_t> memory;
+     std::vector<uint32_t> staging;
+     std::vector<uint32_t> shown_list;
+     std::vector<uint32_t> frame_commands;
+     std::vector<uint32_t> shown_commands;
+     uint64_t start_ns;
+     uint64_t busy_until_ns;
+     uint32_t visible_read;      //!< REG_CMD_READ as the host sees it
+     uint32_t cmd_read;          //!< Co-processor's actual position
+     uint32_t cmd_write;
+     uint32_t cmd_dl;
+     uint32_t inflate_end;       //!< CMD_GETPTR result
+     bool faulted;
+     bool capturing;
+     bool in_reset;
+     stats_t stats;
+ };
+
+ #endif // GRAPH_FT800_SIM_H
@@ -6,8 +6,8 @@
  #ifndef MEMORY_ICONS_H
  #define MEMORY_ICONS_H
  
- #include "device_definitions.h"
- #include "ft800Formats.h"
+ #include "graph_device_definitions.h"
+ #include "graph_ft800Formats.h"
  #include <cstdint>
  
  namespace Memory_icons
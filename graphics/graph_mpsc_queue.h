@@ -0,0 +1,100 @@
+/**
+ * @file graph_mpsc_queue.h
+ * @brief Bounded lock-free multi-producer, single-consumer queue.
+ */
+
+ #ifndef GRAPH_MPSC_QUEUE_H
+ #define GRAPH_MPSC_QUEUE_H
+
+ #include <atomic>
+ #include <cstdint>
+ #include <cstddef>
+
+ /**
+  * Fixed-capacity ring of @p Capacity slots (a power of two). Each slot
+  * carries a sequence number that tells producers and the consumer whose
+  * turn it is, so push() costs one CAS on the tail and pop() needs no
+  * atomic read-modify-write at all. Neither call blocks or allocates;
+  * push() returns false when the ring is full.
+  */
+ template <typename T, size_t Capacity>
+ class GraphMpscQueue
+ {
+     static_assert(Capacity >= 2U && (Capacity & (Capacity - 1U)) == 0U, "Capacity must be a power of two");
+
+ public:
+     GraphMpscQueue()
+         : head(0U), tail(0U)
+     {
+         for (size_t i = 0U; i < Capacity; ++i)
+         {
+             slots[i].sequence.store(i, std::memory_order_relaxed);
+         }
+     }
+
+     /** Enqueues a copy of @p item. Safe from any number of threads. */
+     bool push(const T& item)
+     {
+         size_t pos = tail.load(std::memory_order_relaxed);
+         for (;;)
+         {
+             slot_t& slot = slots[pos & (Capacity - 1U)];
+             size_t seq = slot.sequence.load(std::memory_order_acquire);
+             intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+             if (diff == 0)
+             {
+                 if (tail.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed))
+                 {
+                     slot.item = item;
+                     slot.sequence.store(pos + 1U, std::memory_order_release);
+                     return true;
+                 }
+             }
+             else if (diff < 0)
+             {
+                 return false;
+             }
+             else
+             {
+                 pos = tail.load(std::memory_order_relaxed);
+             }
+         }
+     }
+
+     /** Dequeues into @p item. Only the consumer thread may call this. */
+     bool pop(T& item)
+     {
+         slot_t& slot = slots[head & (Capacity - 1U)];
+         size_t seq = slot.sequence.load(std::memory_order_acquire);
+         if (seq != head + 1U)
+         {
+             return false;
+         }
+         item = slot.item;
+         slot.sequence.store(head + Capacity, std::memory_order_release);
+         head++;
+         return true;
+     }
+
+     /** True if nothing was queued at the time of the call (consumer side). */
+     bool empty() const
+     {
+         return slots[head & (Capacity - 1U)].sequence.load(std::memory_order_acquire) != head + 1U;
+     }
+
+     static constexpr size_t capacity() { return Capacity; }
+
+ private:
+     struct slot_t
+     {
+         std::atomic<size_t> sequence;
+         T item;
+     };
+
+     // Consumer and producer indices on separate cache lines.
+     alignas(64) size_t head;
+     alignas(64) std::atomic<size_t> tail;
+     alignas(64) slot_t slots[Capacity];
+ };
+
+ #endif // GRAPH_MPSC_QUEUE_H
@@ -0,0 +1,113 @@
+/**
+ * @file graph_ram_g.cpp
+ * @brief First-fit allocator for the FT800 RAM_G.
+ */
+
+ #include "graph_ram_g.h"
+
+ GraphRamG::GraphRamG(uint32_t base, uint32_t size)
+     : base(base), size(size & ~(alignment - 1U))
+ {
+     clear();
+ }
+
+ GraphRamG::~GraphRamG() {}
+
+ /** Forgets every allocation. */
+ void GraphRamG::clear()
+ {
+     used_list.clear();
+     free_list.clear();
+     if (size > 0U)
+     {
+         free_list[base] = size;
+     }
+ }
+
+ /** Returns the offset of a new block, or invalid_offset if nothing fits. */
+ uint32_t GraphRamG::allocate(uint32_t bytes)
+ {
+     if (bytes == 0U || bytes > size)
+     {
+         return invalid_offset;
+     }
+     uint32_t rounded = (bytes + alignment - 1U) & ~(alignment - 1U);
+
+     for (std::map<uint32_t, uint32_t>::iterator it = free_list.begin(); it != free_list.end(); ++it)
+     {
+         if (it->second >= rounded)
+         {
+             uint32_t offset = it->first;
+             uint32_t remaining = it->second - rounded;
+             free_list.erase(it);
+             if (remaining > 0U)
+             {
+                 free_list[offset + rounded] = remaining;
+             }
+             used_list[offset] = rounded;
+             return offset;
+         }
+     }
+     return invalid_offset;
+ }
+
+ /** Returns a block to the free list, merging it with free neighbours. */
+ bool GraphRamG::release(uint32_t offset)
+ {
+     std::map<uint32_t, uint32_t>::iterator used = used_list.find(offset);
+     if (used == used_list.end())
+     {
+         return false;
+     }
+     uint32_t length = used->second;
+     used_list.erase(used);
+
+     std::map<uint32_t, uint32_t>::iterator next = free_list.lower_bound(offset);
+     if (next != free_list.end() && (offset + length) == next->first)
+     {
+         length += next->second;
+         next = free_list.erase(next);
+     }
+     if (next != free_list.begin())
+     {
+         std::map<uint32_t, uint32_t>::iterator prev = next;
+         --prev;
+         if ((prev->first + prev->second) == offset)
+         {
+             prev->second += length;
+             return true;
+         }
+     }
+     free_list[offset] = length;
+     return true;
+ }
+
+ /** Size of a live allocation (after alignment), or 0. */
+ uint32_t GraphRamG::allocation_size(uint32_t offset) const
+ {
+     std::map<uint32_t, uint32_t>::const_iterator it = used_list.find(offset);
+     return (it != used_list.end()) ? it->second : 0U;
+ }
+
+ /** Occupancy and fragmentation snapshot. */
+ GraphRamG::stats_t GraphRamG::get_stats() const
+ {
+     stats_t stats = { size, 0U, 0U, 0U, static_cast<uint32_t>(used_list.size()),
+                       static_cast<uint32_t>(free_list.size()), 0U };
+
+     for (const auto& block : free_list)
+     {
+         stats.free_bytes += block.second;
+         if (block.second > stats.largest_free_block)
+         {
+             stats.largest_free_block = block.second;
+         }
+     }
+     stats.used_bytes = size - stats.free_bytes;
+     if (stats.free_bytes > 0U)
+     {
+         stats.fragmentation_percent =
+             static_cast<uint8_t>(100U - (static_cast<uint64_t>(stats.largest_free_block) * 100U) / stats.free_bytes);
+     }
+     return stats;
+ }
@@ -0,0 +1,53 @@
+/**
+ * @file graph_ram_g.h
+ * @brief First-fit allocator for the FT800 256 KB RAM_G.
+ */
+
+ #ifndef GRAPH_RAM_G_H
+ #define GRAPH_RAM_G_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <map>
+
+ /**
+  * Hands out RAM_G offsets for bitmaps and other assets. Only bookkeeping
+  * lives here; nothing is written to the device. Free blocks are kept
+  * sorted by offset and coalesced on release.
+  */
+ class GraphRamG
+ {
+ public:
+     static const uint32_t ram_g_size = 256U * 1024U;
+     static const uint32_t alignment = 4U;
+     static const uint32_t invalid_offset = 0xFFFFFFFFU;
+
+     struct stats_t
+     {
+         uint32_t total_bytes;
+         uint32_t used_bytes;
+         uint32_t free_bytes;
+         uint32_t largest_free_block;
+         uint32_t allocations;          //!< Live allocations
+         uint32_t free_blocks;          //!< Separate free extents
+         uint8_t fragmentation_percent; //!< 100 * (1 - largest_free / free)
+     };
+
+     explicit GraphRamG(uint32_t base = 0U, uint32_t size = ram_g_size);
+     ~GraphRamG();
+
+     uint32_t allocate(uint32_t bytes);
+     bool release(uint32_t offset);
+     void clear();
+
+     uint32_t allocation_size(uint32_t offset) const;
+     stats_t get_stats() const;
+
+ private:
+     uint32_t base;
+     uint32_t size;
+     std::map<uint32_t, uint32_t> free_list;   //!< offset -> length
+     std::map<uint32_t, uint32_t> used_list;   //!< offset -> length
+ };
+
+ #endif // GRAPH_RAM_G_H
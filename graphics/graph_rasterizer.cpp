@@ -0,0 +1,653 @@
+/**
+ * @file graph_rasterizer.cpp
+ * @brief Reference software renderer for FT800 display lists.
+ */
+
+ #include <cstdint>
+ #include <cstdio>
+ #include <cstring>
+ #ifdef GRAPH_HAVE_ZLIB
+ # include <zlib.h>
+ #endif
+ #include "graph_rasterizer.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_ft800Formats.h"
+
+ // Pixel centres in 1/16 pixel units.
+ static const int32_t subpixel = 16;
+ static const int32_t half_pixel = 8;
+
+ static uint32_t expand5(uint32_t v) { return (v << 3) | (v >> 2); }
+ static uint32_t expand6(uint32_t v) { return (v << 2) | (v >> 4); }
+
+ static int32_t sign_extend15(uint32_t v)
+ {
+     return ((v & 0x4000U) != 0U) ? static_cast<int32_t>(v | 0xFFFF8000U) : static_cast<int32_t>(v);
+ }
+
+ static uint32_t bits_per_pixel(uint8_t format)
+ {
+     switch (format)
+     {
+     case FT800_BITMAP_FORMAT_ARGB1555:
+     case FT800_BITMAP_FORMAT_ARGB4:
+     case FT800_BITMAP_FORMAT_RGB565:    return 16U;
+     case FT800_BITMAP_FORMAT_RGB332:
+     case FT800_BITMAP_FORMAT_L8:        return 8U;
+     case FT800_BITMAP_FORMAT_L4:        return 4U;
+     default:                            return 0U;
+     }
+ }
+
+ GraphRasterizer::GraphRasterizer(uint16_t width, uint16_t height)
+     : width(width), height(height), framebuffer(static_cast<size_t>(width) * height, 0U),
+       ram_g(nullptr), ram_g_size(0U), handles(), context(), saved(), saved_depth(0U),
+       primitive(0U), have_previous(false), previous(), stats()
+ {
+ }
+
+ /** Memory that BITMAP_SOURCE addresses refer to; not copied. */
+ void GraphRasterizer::set_ram_g(const uint8_t* data, size_t size)
+ {
+     ram_g = data;
+     ram_g_size = (data != nullptr) ? size : 0U;
+ }
+
+ void GraphRasterizer::reset_state()
+ {
+     (void)memset(handles, 0, sizeof(handles));
+     context = context_t();
+     context.color = 0xFFFFFFU;
+     context.alpha = 0xFFU;
+     context.point_size = 16U;
+     context.line_width = 16U;
+     saved_depth = 0U;
+     primitive = 0U;
+     have_previous = false;
+     stats = stats_t();
+ }
+
+ /** Renders one display list from power-on state; the framebuffer keeps the result. */
+ GraphRasterizer::stats_t GraphRasterizer::render(const uint32_t* words, size_t count)
+ {
+     reset_state();
+     for (size_t i = 0U; words != nullptr && i < count; ++i)
+     {
+         stats.dl_words++;
+         if ((words[i] >> 24) == DL_DISPLAY)
+         {
+             stats.terminated = true;
+             break;
+         }
+         execute(words[i]);
+     }
+     stats.dl_bytes = stats.dl_words * 4U;
+     stats.over_budget = stats.dl_bytes > dl_budget_bytes;
+     return stats;
+ }
+
+ /** Applies one display-list word to the state machine. */
+ void GraphRasterizer::execute(uint32_t word)
+ {
+     if ((word & 0x80000000U) != 0U)
+     {
+         vertex_t v;
+         v.x = static_cast<int32_t>((word >> 21) & 0x1FFU) * subpixel;
+         v.y = static_cast<int32_t>((word >> 12) & 0x1FFU) * subpixel;
+         v.handle = static_cast<uint8_t>((word >> 7) & 0x1FU);
+         v.cell = static_cast<uint8_t>(word & 0x7FU);
+         vertex(v);
+         return;
+     }
+     if ((word & 0xC0000000U) == 0x40000000U)
+     {
+         vertex_t v;
+         v.x = sign_extend15((word >> 15) & 0x7FFFU);
+         v.y = sign_extend15(word & 0x7FFFU);
+         v.handle = context.handle;
+         v.cell = context.cell;
+         vertex(v);
+         return;
+     }
+
+     uint32_t operand = word & 0x00FFFFFFU;
+     handle_t& h = handles[context.handle];
+
+     switch (word >> 24)
+     {
+     case DL_CLEAR_COLOR_RGB:
+         context.clear_color = operand;
+         break;
+
+     case DL_COLOR_RGB:
+         context.color = operand;
+         break;
+
+     case DL_COLOR_A:
+         context.alpha = static_cast<uint8_t>(operand);
+         break;
+
+     case DL_POINT_SIZE:
+         context.point_size = static_cast<uint16_t>(operand & 0x1FFFU);
+         break;
+
+     case DL_LINE_WIDTH:
+         context.line_width = static_cast<uint16_t>(operand & 0x0FFFU);
+         break;
+
+     case DL_BITMAP_HANDLE:
+         context.handle = static_cast<uint8_t>(operand & 0x1FU);
+         break;
+
+     case DL_CELL:
+         context.cell = static_cast<uint8_t>(operand & 0x7FU);
+         break;
+
+     case DL_BITMAP_SOURCE:
+         h.source = operand & 0xFFFFFU;
+         break;
+
+     case DL_BITMAP_LAYOUT:
+         h.format = static_cast<uint8_t>((operand >> 19) & 0x1FU);
+         h.linestride = static_cast<uint16_t>((operand >> 9) & 0x3FFU);
+         h.layout_height = static_cast<uint16_t>(operand & 0x1FFU);
+         break;
+
+     case DL_BITMAP_SIZE:
+         h.wrapx = static_cast<uint8_t>((operand >> 19) & 1U);
+         h.wrapy = static_cast<uint8_t>((operand >> 18) & 1U);
+         h.width = static_cast<uint16_t>((operand >> 9) & 0x1FFU);
+         h.height = static_cast<uint16_t>(operand & 0x1FFU);
+         break;
+
+     case DL_BEGIN:
+         primitive = static_cast<uint8_t>(operand & 0x0FU);
+         have_previous = false;
+         break;
+
+     case DL_END:
+         primitive = 0U;
+         have_previous = false;
+         break;
+
+     case DL_SAVE_CONTEXT:
+         if (saved_depth < max_saved_contexts)
+         {
+             saved[saved_depth++] = context;
+         }
+         break;
+
+     case DL_RESTORE_CONTEXT:
+         if (saved_depth > 0U)
+         {
+             context = saved[--saved_depth];
+         }
+         break;
+
+     case DL_CLEAR:
+         if ((operand & 4U) != 0U)
+         {
+             for (uint32_t& pixel : framebuffer)
+             {
+                 pixel = context.clear_color;
+             }
+             stats.pixels_cleared += framebuffer.size();
+         }
+         break;
+
+     case DL_CLEAR_COLOR_A:
+     case DL_CLEAR_TAG:
+     case DL_TAG:
+     case DL_TAG_MASK:
+         break;   // no colour output
+
+     default:
+         stats.unsupported_words++;
+         break;
+     }
+ }
+
+ void GraphRasterizer::vertex(const vertex_t& v)
+ {
+     stats.vertices++;
+
+     switch (primitive)
+     {
+     case PRIM_POINTS:
+         fill_point(v);
+         break;
+
+     case PRIM_BITMAPS:
+         fill_bitmap(v);
+         break;
+
+     case PRIM_LINES:
+     case PRIM_RECTS:
+         if (!have_previous)
+         {
+             previous = v;
+             have_previous = true;
+             return;
+         }
+         if (primitive == PRIM_LINES)
+         {
+             fill_line(previous, v);
+         }
+         else
+         {
+             fill_rect(previous, v);
+         }
+         have_previous = false;
+         break;
+
+     case PRIM_LINE_STRIP:
+         if (have_previous)
+         {
+             fill_line(previous, v);
+         }
+         previous = v;
+         have_previous = true;
+         break;
+
+     default:
+         stats.unsupported_words++;
+         break;
+     }
+ }
+
+ /** SRC_ALPHA / ONE_MINUS_SRC_ALPHA into the framebuffer. */
+ void GraphRasterizer::blend(int32_t px, int32_t py, uint32_t rgb, uint32_t alpha)
+ {
+     if (px < 0 || py < 0 || px >= width || py >= height || alpha == 0U)
+     {
+         return;
+     }
+     uint32_t& dst = framebuffer[static_cast<size_t>(py) * width + static_cast<size_t>(px)];
+     uint32_t out = 0U;
+     for (uint32_t shift = 0U; shift <= 16U; shift += 8U)
+     {
+         uint32_t s = (rgb >> shift) & 0xFFU;
+         uint32_t d = (dst >> shift) & 0xFFU;
+         out |= (((s * alpha) + (d * (255U - alpha)) + 127U) / 255U) << shift;
+     }
+     dst = out;
+     stats.pixels_filled++;
+ }
+
+ void GraphRasterizer::fill_point(const vertex_t& v)
+ {
+     int64_t r = context.point_size;
+     int32_t x0 = static_cast<int32_t>((v.x - r) / subpixel) - 1;
+     int32_t x1 = static_cast<int32_t>((v.x + r) / subpixel) + 1;
+     int32_t y0 = static_cast<int32_t>((v.y - r) / subpixel) - 1;
+     int32_t y1 = static_cast<int32_t>((v.y + r) / subpixel) + 1;
+
+     stats.primitives++;
+     for (int32_t py = y0; py <= y1; ++py)
+     {
+         for (int32_t px = x0; px <= x1; ++px)
+         {
+             int64_t dx = static_cast<int64_t>(px) * subpixel + half_pixel - v.x;
+             int64_t dy = static_cast<int64_t>(py) * subpixel + half_pixel - v.y;
+             if (dx * dx + dy * dy < r * r)
+             {
+                 blend(px, py, context.color, context.alpha);
+             }
+         }
+     }
+ }
+
+ /** Capsule of LINE_WIDTH around the segment (round caps, as on the chip). */
+ void GraphRasterizer::fill_line(const vertex_t& a, const vertex_t& b)
+ {
+     int64_t half = (context.line_width < subpixel) ? half_pixel : context.line_width / 2;
+     int64_t ex = static_cast<int64_t>(b.x) - a.x;
+     int64_t ey = static_cast<int64_t>(b.y) - a.y;
+     int64_t length2 = ex * ex + ey * ey;
+     int32_t x0 = static_cast<int32_t>(((a.x < b.x ? a.x : b.x) - half) / subpixel) - 1;
+     int32_t x1 = static_cast<int32_t>(((a.x > b.x ? a.x : b.x) + half) / subpixel) + 1;
+     int32_t y0 = static_cast<int32_t>(((a.y < b.y ? a.y : b.y) - half) / subpixel) - 1;
+     int32_t y1 = static_cast<int32_t>(((a.y > b.y ? a.y : b.y) + half) / subpixel) + 1;
+
+     stats.primitives++;
+     for (int32_t py = y0; py <= y1; ++py)
+     {
+         for (int32_t px = x0; px <= x1; ++px)
+         {
+             double cx = static_cast<double>(px) * subpixel + half_pixel - a.x;
+             double cy = static_cast<double>(py) * subpixel + half_pixel - a.y;
+             double t = (length2 > 0) ? (cx * ex + cy * ey) / static_cast<double>(length2) : 0.0;
+             t = (t < 0.0) ? 0.0 : ((t > 1.0) ? 1.0 : t);
+             double dx = cx - t * ex;
+             double dy = cy - t * ey;
+             if (dx * dx + dy * dy < static_cast<double>(half * half))
+             {
+                 blend(px, py, context.color, context.alpha);
+             }
+         }
+     }
+ }
+
+ /** Rectangle between the two corners, rounded by half the LINE_WIDTH. */
+ void GraphRasterizer::fill_rect(const vertex_t& a, const vertex_t& b)
+ {
+     int64_t half = (context.line_width < subpixel) ? half_pixel : context.line_width / 2;
+     int64_t left = (a.x < b.x) ? a.x : b.x;
+     int64_t right = (a.x > b.x) ? a.x : b.x;
+     int64_t top = (a.y < b.y) ? a.y : b.y;
+     int64_t bottom = (a.y > b.y) ? a.y : b.y;
+
+     stats.primitives++;
+     for (int64_t py = (top - half) / subpixel - 1; py <= (bottom + half) / subpixel + 1; ++py)
+     {
+         for (int64_t px = (left - half) / subpixel - 1; px <= (right + half) / subpixel + 1; ++px)
+         {
+             int64_t cx = px * subpixel + half_pixel;
+             int64_t cy = py * subpixel + half_pixel;
+             int64_t dx = (cx < left) ? left - cx : ((cx > right) ? cx - right : 0);
+             int64_t dy = (cy < top) ? top - cy : ((cy > bottom) ? cy - bottom : 0);
+             if (dx * dx + dy * dy < half * half)
+             {
+                 blend(static_cast<int32_t>(px), static_cast<int32_t>(py), context.color, context.alpha);
+             }
+         }
+     }
+ }
+
+ void GraphRasterizer::fill_bitmap(const vertex_t& v)
+ {
+     if (v.handle >= 16U)
+     {
+         stats.unsupported_words++;   // ROM font glyphs are not modelled
+         return;
+     }
+     const handle_t& h = handles[v.handle];
+     int32_t ox = (v.x >= 0) ? v.x / subpixel : -((-v.x + subpixel - 1) / subpixel);
+     int32_t oy = (v.y >= 0) ? v.y / subpixel : -((-v.y + subpixel - 1) / subpixel);
+     // A size field of 0 means 512 pixels.
+     int32_t w = (h.width == 0U) ? 512 : h.width;
+     int32_t ht = (h.height == 0U) ? 512 : h.height;
+
+     if (bits_per_pixel(h.format) == 0U)
+     {
+         stats.unsupported_words++;
+         return;
+     }
+     stats.primitives++;
+     for (int32_t y = 0; y < ht; ++y)
+     {
+         for (int32_t x = 0; x < w; ++x)
+         {
+             uint32_t rgb = 0U, alpha = 0U;
+             if (!sample(h, v.cell, x, y, &rgb, &alpha))
+             {
+                 continue;
+             }
+             uint32_t modulated = 0U;
+             for (uint32_t shift = 0U; shift <= 16U; shift += 8U)
+             {
+                 modulated |= ((((rgb >> shift) & 0xFFU) * ((context.color >> shift) & 0xFFU) + 127U) / 255U) << shift;
+             }
+             blend(ox + x, oy + y, modulated, (alpha * context.alpha + 127U) / 255U);
+         }
+     }
+ }
+
+ /** Fetches texel (@p x, @p y) of @p cell; false when outside a BORDER-wrapped layout. */
+ bool GraphRasterizer::sample(const handle_t& h, uint32_t cell, int32_t x, int32_t y, uint32_t* rgb, uint32_t* alpha) const
+ {
+     uint32_t bpp = bits_per_pixel(h.format);
+     int32_t layout_w = static_cast<int32_t>((static_cast<uint32_t>(h.linestride) * 8U) / bpp);
+     int32_t layout_h = h.layout_height;
+
+     if (layout_w <= 0 || layout_h <= 0)
+     {
+         return false;
+     }
+     if (x >= layout_w)
+     {
+         if (h.wrapx == 0U)
+         {
+             return false;
+         }
+         x %= layout_w;
+     }
+     if (y >= layout_h)
+     {
+         if (h.wrapy == 0U)
+         {
+             return false;
+         }
+         y %= layout_h;
+     }
+
+     size_t offset = h.source + static_cast<size_t>(cell) * h.linestride * static_cast<uint32_t>(layout_h) +
+                     static_cast<size_t>(y) * h.linestride + (static_cast<size_t>(x) * bpp) / 8U;
+     if (ram_g == nullptr || offset + (bpp + 7U) / 8U > ram_g_size)
+     {
+         return false;
+     }
+     uint32_t v = (bpp == 16U) ? (static_cast<uint32_t>(ram_g[offset]) | (static_cast<uint32_t>(ram_g[offset + 1U]) << 8))
+                               : ram_g[offset];
+
+     switch (h.format)
+     {
+     case FT800_BITMAP_FORMAT_ARGB1555:
+         *alpha = ((v & 0x8000U) != 0U) ? 255U : 0U;
+         *rgb = (expand5((v >> 10) & 0x1FU) << 16) | (expand5((v >> 5) & 0x1FU) << 8) | expand5(v & 0x1FU);
+         break;
+
+     case FT800_BITMAP_FORMAT_ARGB4:
+         *alpha = ((v >> 12) & 0xFU) * 17U;
+         *rgb = ((((v >> 8) & 0xFU) * 17U) << 16) | ((((v >> 4) & 0xFU) * 17U) << 8) | ((v & 0xFU) * 17U);
+         break;
+
+     case FT800_BITMAP_FORMAT_RGB565:
+         *alpha = 255U;
+         *rgb = (expand5((v >> 11) & 0x1FU) << 16) | (expand6((v >> 5) & 0x3FU) << 8) | expand5(v & 0x1FU);
+         break;
+
+     case FT800_BITMAP_FORMAT_RGB332:
+         *alpha = 255U;
+         *rgb = ((((v >> 5) & 7U) * 255U / 7U) << 16) | ((((v >> 2) & 7U) * 255U / 7U) << 8) | ((v & 3U) * 85U);
+         break;
+
+     case FT800_BITMAP_FORMAT_L8:
+         // Luminance formats drive alpha; colour comes from COLOR_RGB.
+         *alpha = v;
+         *rgb = 0xFFFFFFU;
+         break;
+
+     case FT800_BITMAP_FORMAT_L4:
+         *alpha = (((x & 1) == 0) ? (v >> 4) : v) & 0xFU;
+         *alpha *= 17U;
+         *rgb = 0xFFFFFFU;
+         break;
+
+     default:
+         return false;
+     }
+     return true;
+ }
+
+ /** Binary PPM (P6). */
+ bool GraphRasterizer::write_ppm(const char* path) const
+ {
+     FILE* file = fopen(path, "wb");
+     if (file == nullptr)
+     {
+         return false;
+     }
+     bool ok = fprintf(file, "P6\n%u %u\n255\n", width, height) > 0;
+     std::vector<uint8_t> row(static_cast<size_t>(width) * 3U);
+     for (uint32_t y = 0U; ok && y < height; ++y)
+     {
+         for (uint32_t x = 0U; x < width; ++x)
+         {
+             uint32_t pixel = framebuffer[static_cast<size_t>(y) * width + x];
+             row[x * 3U] = static_cast<uint8_t>(pixel >> 16);
+             row[x * 3U + 1U] = static_cast<uint8_t>(pixel >> 8);
+             row[x * 3U + 2U] = static_cast<uint8_t>(pixel);
+         }
+         ok = fwrite(row.data(), 1U, row.size(), file) == row.size();
+     }
+     return (fclose(file) == 0) && ok;
+ }
+
+ #ifdef GRAPH_HAVE_ZLIB
+ static bool write_png_chunk(FILE* file, const char* type, const uint8_t* data, uint32_t len)
+ {
+     uint8_t header[8] = { static_cast<uint8_t>(len >> 24), static_cast<uint8_t>(len >> 16),
+                           static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len),
+                           static_cast<uint8_t>(type[0]), static_cast<uint8_t>(type[1]),
+                           static_cast<uint8_t>(type[2]), static_cast<uint8_t>(type[3]) };
+     uLong crc = crc32(0L, header + 4, 4U);
+     if (len > 0U)
+     {
+         crc = crc32(crc, data, len);
+     }
+     uint8_t trailer[4] = { static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                            static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc) };
+     return fwrite(header, 1U, sizeof(header), file) == sizeof(header) &&
+            (len == 0U || fwrite(data, 1U, len, file) == len) &&
+            fwrite(trailer, 1U, sizeof(trailer), file) == sizeof(trailer);
+ }
+ #endif
+
+ /** 8-bit RGB PNG; needs zlib (GRAPH_HAVE_ZLIB), otherwise returns false. */
+ bool GraphRasterizer::write_png(const char* path) const
+ {
+ #ifdef GRAPH_HAVE_ZLIB
+     static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+     // Each scanline is prefixed with filter type 0 (None).
+     std::vector<uint8_t> raw(static_cast<size_t>(height) * (1U + static_cast<size_t>(width) * 3U));
+     size_t pos = 0U;
+     for (uint32_t y = 0U; y < height; ++y)
+     {
+         raw[pos++] = 0U;
+         for (uint32_t x = 0U; x < width; ++x)
+         {
+             uint32_t pixel = framebuffer[static_cast<size_t>(y) * width + x];
+             raw[pos++] = static_cast<uint8_t>(pixel >> 16);
+             raw[pos++] = static_cast<uint8_t>(pixel >> 8);
+             raw[pos++] = static_cast<uint8_t>(pixel);
+         }
+     }
+     uLongf packed_len = compressBound(raw.size());
+     std::vector<uint8_t> packed(packed_len);
+     if (compress2(packed.data(), &packed_len, raw.data(), raw.size(), Z_BEST_COMPRESSION) != Z_OK)
+     {
+         return false;
+     }
+
+     const uint8_t ihdr[13] = { 0, 0, static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+                                0, 0, static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+                                8, 2, 0, 0, 0 };   // 8-bit truecolour, no interlace
+     FILE* file = fopen(path, "wb");
+     if (file == nullptr)
+     {
+         return false;
+     }
+     bool ok = fwrite(signature, 1U, sizeof(signature), file) == sizeof(signature) &&
+               write_png_chunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+               write_png_chunk(file, "IDAT", packed.data(), static_cast<uint32_t>(packed_len)) &&
+               write_png_chunk(file, "IEND", nullptr, 0U);
+     return (fclose(file) == 0) && ok;
+ #else
+     (void)path;
+     return false;
+ #endif
+ }
+
+ static bool read_ppm_number(FILE* file, uint32_t* value)
+ {
+     int c = fgetc(file);
+     while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+     {
+         if (c == '#')
+         {
+             while (c != '\n' && c != EOF)
+             {
+                 c = fgetc(file);
+             }
+         }
+         c = fgetc(file);
+     }
+     if (c < '0' || c > '9')
+     {
+         return false;
+     }
+     *value = 0U;
+     while (c >= '0' && c <= '9')
+     {
+         *value = *value * 10U + static_cast<uint32_t>(c - '0');
+         c = fgetc(file);
+     }
+     return true;   // the single whitespace after the number is consumed
+ }
+
+ /** Loads a binary PPM (P6, maxval 255) such as write_ppm() produces. */
+ bool GraphRasterizer::read_ppm(const char* path, uint16_t* out_width, uint16_t* out_height, std::vector<uint32_t>* out_pixels)
+ {
+     FILE* file = fopen(path, "rb");
+     if (file == nullptr)
+     {
+         return false;
+     }
+     uint32_t w = 0U, h = 0U, maxval = 0U;
+     bool ok = fgetc(file) == 'P' && fgetc(file) == '6' &&
+               read_ppm_number(file, &w) && read_ppm_number(file, &h) && read_ppm_number(file, &maxval) &&
+               maxval == 255U && w > 0U && h > 0U && w <= 0xFFFFU && h <= 0xFFFFU;
+     if (ok)
+     {
+         std::vector<uint8_t> data(static_cast<size_t>(w) * h * 3U);
+         ok = fread(data.data(), 1U, data.size(), file) == data.size();
+         if (ok)
+         {
+             out_pixels->resize(static_cast<size_t>(w) * h);
+             for (size_t i = 0U; i < out_pixels->size(); ++i)
+             {
+                 (*out_pixels)[i] = (static_cast<uint32_t>(data[i * 3U]) << 16) |
+                                    (static_cast<uint32_t>(data[i * 3U + 1U]) << 8) | data[i * 3U + 2U];
+             }
+             *out_width = static_cast<uint16_t>(w);
+             *out_height = static_cast<uint16_t>(h);
+         }
+     }
+     (void)fclose(file);
+     return ok;
+ }
+
+ /**
+  * Counts pixels whose channels differ from the golden image by more than
+  * @p tolerance. Returns false if the golden image is missing or another size.
+  */
+ bool GraphRasterizer::compare_ppm(const char* golden_path, uint8_t tolerance, uint32_t* mismatched) const
+ {
+     uint16_t golden_w = 0U, golden_h = 0U;
+     std::vector<uint32_t> golden;
+     if (!read_ppm(golden_path, &golden_w, &golden_h, &golden) || golden_w != width || golden_h != height)
+     {
+         return false;
+     }
+     uint32_t count = 0U;
+     for (size_t i = 0U; i < golden.size(); ++i)
+     {
+         for (uint32_t shift = 0U; shift <= 16U; shift += 8U)
+         {
+             int32_t a = static_cast<int32_t>((framebuffer[i] >> shift) & 0xFFU);
+             int32_t b = static_cast<int32_t>((golden[i] >> shift) & 0xFFU);
+             if (((a > b) ? a - b : b - a) > tolerance)
+             {
+                 count++;
+                 break;
+             }
+         }
+     }
+     if (mismatched != nullptr)
+     {
+         *mismatched = count;
+     }
+     return true;
+ }
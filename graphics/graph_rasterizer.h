@@ -0,0 +1,137 @@
+/**
+ * @file graph_rasterizer.h
+ * @brief Reference software renderer for FT800 display lists.
+ */
+
+ #ifndef GRAPH_RASTERIZER_H
+ #define GRAPH_RASTERIZER_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <vector>
+
+ /**
+  * Executes display-list words into an RGB framebuffer so screens can be
+  * inspected, diffed against golden images and costed without the panel.
+  *
+  *     GraphFt800Sim sim;
+  *     ...render a frame through GraphFt800(sim)...
+  *     std::vector<uint8_t> ram_g(256 * 1024);
+  *     sim.peek(0, ram_g.data(), ram_g.size());
+  *
+  *     GraphRasterizer raster;
+  *     raster.set_ram_g(ram_g.data(), ram_g.size());
+  *     std::vector<uint32_t> dl = sim.displayed_list();
+  *     GraphRasterizer::stats_t stats = raster.render(dl.data(), dl.size());
+  *     raster.write_png("screen.png");
+  *
+  * Supported: CLEAR / CLEAR_COLOR_RGB / CLEAR_COLOR_A, COLOR_RGB / COLOR_A,
+  * POINT_SIZE, LINE_WIDTH, SAVE/RESTORE_CONTEXT, the BITMAP_* state and
+  * BEGIN(POINTS, LINES, LINE_STRIP, RECTS, BITMAPS) with VERTEX2F and
+  * VERTEX2II. Bitmaps are sampled nearest-neighbour from RAM_G in ARGB1555,
+  * ARGB4, RGB565, RGB332, L8 and L4. Blending is always the power-on
+  * SRC_ALPHA / ONE_MINUS_SRC_ALPHA. Words outside that set, ROM font handles
+  * and co-processor widget output are counted in unsupported_words and
+  * skipped, so a widget screen renders as its primitives only.
+  *
+  * Lines and rectangle corners use LINE_WIDTH as the full stroke width and
+  * points use POINT_SIZE as the radius; edges are not anti-aliased, so
+  * golden compares should allow a small per-channel tolerance.
+  */
+ class GraphRasterizer
+ {
+ public:
+     static const uint16_t default_width = 480U;
+     static const uint16_t default_height = 272U;
+     static const uint32_t dl_budget_bytes = 8U * 1024U;   // RAM_DL
+
+     struct stats_t
+     {
+         uint32_t dl_words;           //!< Up to and including DISPLAY
+         uint32_t dl_bytes;
+         bool over_budget;            //!< dl_bytes exceeds RAM_DL
+         bool terminated;             //!< DISPLAY was reached
+         uint32_t primitives;         //!< Points, lines, rectangles and bitmaps drawn
+         uint32_t vertices;
+         uint64_t pixels_cleared;
+         uint64_t pixels_filled;      //!< Pixels written by primitives (fill cost)
+         uint32_t unsupported_words;
+     };
+
+     GraphRasterizer(uint16_t width = default_width, uint16_t height = default_height);
+
+     void set_ram_g(const uint8_t* data, size_t size);
+     stats_t render(const uint32_t* words, size_t count);
+
+     uint16_t get_width() const { return width; }
+     uint16_t get_height() const { return height; }
+     const std::vector<uint32_t>& pixels() const { return framebuffer; }   //!< 0x00RRGGBB, row-major
+
+     bool write_ppm(const char* path) const;
+     bool write_png(const char* path) const;
+     bool compare_ppm(const char* golden_path, uint8_t tolerance, uint32_t* mismatched) const;
+
+     static bool read_ppm(const char* path, uint16_t* out_width, uint16_t* out_height, std::vector<uint32_t>* out_pixels);
+
+ private:
+     struct handle_t
+     {
+         uint32_t source;
+         uint8_t format;
+         uint16_t linestride;
+         uint16_t layout_height;
+         uint8_t wrapx;
+         uint8_t wrapy;
+         uint16_t width;
+         uint16_t height;
+     };
+
+     struct context_t
+     {
+         uint32_t color;          // 0x00RRGGBB
+         uint8_t alpha;
+         uint32_t clear_color;
+         uint16_t point_size;     // 1/16 pixel radius
+         uint16_t line_width;     // 1/16 pixel
+         uint8_t handle;
+         uint8_t cell;
+     };
+
+     struct vertex_t
+     {
+         int32_t x;               // 1/16 pixel
+         int32_t y;
+         uint8_t handle;
+         uint8_t cell;
+     };
+
+     static const uint32_t max_handles = 32U;
+     static const uint32_t max_saved_contexts = 4U;
+
+     void reset_state();
+     void execute(uint32_t word);
+     void vertex(const vertex_t& v);
+     void blend(int32_t px, int32_t py, uint32_t rgb, uint32_t alpha);
+     void fill_point(const vertex_t& v);
+     void fill_line(const vertex_t& a, const vertex_t& b);
+     void fill_rect(const vertex_t& a, const vertex_t& b);
+     void fill_bitmap(const vertex_t& v);
+     bool sample(const handle_t& h, uint32_t cell, int32_t x, int32_t y, uint32_t* rgb, uint32_t* alpha) const;
+
+     uint16_t width;
+     uint16_t height;
+     std::vector<uint32_t> framebuffer;
+     const uint8_t* ram_g;
+     size_t ram_g_size;
+
+     handle_t handles[max_handles];
+     context_t context;
+     context_t saved[max_saved_contexts];
+     uint32_t saved_depth;
+     uint8_t primitive;
+     bool have_previous;
+     vertex_t previous;
+     stats_t stats;
+ };
+
+ #endif // GRAPH_RASTERIZER_H
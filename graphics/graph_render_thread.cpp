@@ -0,0 +1,333 @@
+/**
+ * @file graph_render_thread.cpp
+ * @brief Render thread that owns the FT800 and applies queued UI updates.
+ */
+
+ #include <cstdint>
+ #include <cstring>
+ #include <ctime>
+ #include "graph_render_thread.h"
+
+ GraphRenderThread::GraphRenderThread(GraphFt800& ft800, GraphScene& scene)
+     : scene(scene), buffer(ft800), frame_period_us(default_frame_period_us), pacer(nullptr),
+       thread_id(0), thread_running(false), stop_requested(false),
+       posted_count(0U), dropped_count(0U), applied_count(0U), frame_count(0U), failure_count(0U)
+ {
+     // A scene left alone re-encodes the same frame; don't send it again.
+     buffer.set_skip_unchanged(true);
+     // Put the last good frame back after a co-processor fault.
+     buffer.set_fault_recovery(true);
+ }
+
+ GraphRenderThread::~GraphRenderThread()
+ {
+     stop();
+ }
+
+ /** Starts the render thread; from here on it owns the device and the scene. */
+ bool GraphRenderThread::start()
+ {
+     if (thread_running.load(std::memory_order_acquire))
+     {
+         return true;
+     }
+     stop_requested.store(false, std::memory_order_release);
+     thread_running.store(true, std::memory_order_release);
+
+     if (pthread_create(&thread_id, nullptr, entry_routine, this) != 0)
+     {
+         thread_running.store(false, std::memory_order_release);
+         return false;
+     }
+     return true;
+ }
+
+ /** Stops the render thread after its current frame and joins it. */
+ void GraphRenderThread::stop()
+ {
+     if (thread_running.load(std::memory_order_acquire))
+     {
+         stop_requested.store(true, std::memory_order_release);
+         (void)pthread_join(thread_id, nullptr);
+         thread_running.store(false, std::memory_order_release);
+     }
+ }
+
+ /** Queues one update. Lock-free; fails only when the queue is full. */
+ bool GraphRenderThread::post(const update_t& update)
+ {
+     if (!queue.push(update))
+     {
+         dropped_count.fetch_add(1U, std::memory_order_relaxed);
+         return false;
+     }
+     posted_count.fetch_add(1U, std::memory_order_relaxed);
+     return true;
+ }
+
+ /** Replaces the label of a button or text widget (truncated to max_text_length - 1). */
+ bool GraphRenderThread::post_text(GraphWidget* target, const char* text)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_TEXT;
+     update.target = target;
+     if (text != nullptr)
+     {
+         (void)strncpy(update.text, text, max_text_length - 1U);
+     }
+     return post(update);
+ }
+
+ /** Sets the colour of a text widget. */
+ bool GraphRenderThread::post_color(GraphWidget* target, uint8_t r, uint8_t g, uint8_t b)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_COLOR;
+     update.target = target;
+     update.value = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+     return post(update);
+ }
+
+ /** Sets the co-processor options of a button. */
+ bool GraphRenderThread::post_options(GraphWidget* target, uint16_t options)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_OPTIONS;
+     update.target = target;
+     update.value = options;
+     return post(update);
+ }
+
+ /** Moves a button or bitmap. */
+ bool GraphRenderThread::post_position(GraphWidget* target, int16_t x, int16_t y)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_POSITION;
+     update.target = target;
+     update.x = x;
+     update.y = y;
+     return post(update);
+ }
+
+ /** Shows or hides a widget. */
+ bool GraphRenderThread::post_visible(GraphWidget* target, bool visible)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_VISIBLE;
+     update.target = target;
+     update.value = visible ? 1U : 0U;
+     return post(update);
+ }
+
+ /** Switches a bitmap widget to another image; @p info must outlive the update. */
+ bool GraphRenderThread::post_bitmap(GraphWidget* target, const Device_definitions::bitmap_info_t& info)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_BITMAP;
+     update.target = target;
+     update.bitmap = &info;
+     return post(update);
+ }
+
+ /** Sets the scene clear colour. */
+ bool GraphRenderThread::post_background(uint8_t r, uint8_t g, uint8_t b)
+ {
+     update_t update{};
+     update.kind = update_kind_t::SET_BACKGROUND;
+     update.value = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+     return post(update);
+ }
+
+ /** Runs @p apply on the render thread, for changes the typed updates do not cover. */
+ bool GraphRenderThread::post_call(void (*apply)(GraphWidget* target, uint32_t value), GraphWidget* target, uint32_t value)
+ {
+     update_t update{};
+     update.kind = update_kind_t::CALL;
+     update.target = target;
+     update.value = value;
+     update.apply = apply;
+     return post(update);
+ }
+
+ /** Returns a snapshot of the counters. */
+ GraphRenderThread::stats_t GraphRenderThread::get_stats() const
+ {
+     stats_t stats;
+     stats.updates_posted = posted_count.load(std::memory_order_relaxed);
+     stats.updates_dropped = dropped_count.load(std::memory_order_relaxed);
+     stats.updates_applied = applied_count.load(std::memory_order_relaxed);
+     stats.frames_rendered = frame_count.load(std::memory_order_relaxed);
+     stats.render_failures = failure_count.load(std::memory_order_relaxed);
+     return stats;
+ }
+
+ void* GraphRenderThread::entry_routine(void* arg)
+ {
+     if (arg != nullptr)
+     {
+         static_cast<GraphRenderThread*>(arg)->main_loop();
+     }
+     return nullptr;
+ }
+
+ /** Once per frame period: drain the queue and, if anything changed, render. */
+ void GraphRenderThread::main_loop()
+ {
+     struct timespec next;
+     (void)clock_gettime(CLOCK_MONOTONIC, &next);
+
+     // Draw the initial scene before waiting for updates.
+     bool pending = true;
+     // A frame that failed is retried after retry_backoff frames, doubling
+     // up to max_retry_backoff_frames, so a frame that keeps failing can't spin.
+     uint32_t retry_backoff = 0U;
+     uint32_t retry_wait = 0U;
+
+     while (!stop_requested.load(std::memory_order_acquire))
+     {
+         bool paced = (pacer != nullptr) && pacer->wait_for_slot();
+         if (paced)
+         {
+             (void)clock_gettime(CLOCK_MONOTONIC, &next);
+         }
+         else
+         {
+             next.tv_nsec += static_cast<long>(frame_period_us) * 1000L;
+             while (next.tv_nsec >= 1000000000L)
+             {
+                 next.tv_nsec -= 1000000000L;
+                 next.tv_sec++;
+             }
+             (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+         }
+
+         if (drain_updates() > 0U)
+         {
+             // New content is worth trying at once.
+             pending = true;
+             retry_wait = 0U;
+         }
+         if (pending && retry_wait > 0U)
+         {
+             retry_wait--;
+         }
+         else if (pending)
+         {
+             uint32_t recoveries = buffer.fault_recoveries();
+             bool rendered = scene.render(buffer);
+             if (paced)
+             {
+                 (void)pacer->frame_done();
+             }
+             if (rendered)
+             {
+                 frame_count.fetch_add(1U, std::memory_order_relaxed);
+                 retry_backoff = 0U;
+                 // After a co-processor reset the last good frame is on screen; draw the scene again.
+                 pending = (buffer.fault_recoveries() != recoveries);
+             }
+             else
+             {
+                 // The screen still shows an older frame: keep the scene pending.
+                 failure_count.fetch_add(1U, std::memory_order_relaxed);
+                 retry_backoff = (retry_backoff == 0U) ? 1U : retry_backoff * 2U;
+                 retry_backoff = (retry_backoff > max_retry_backoff_frames) ? max_retry_backoff_frames : retry_backoff;
+                 retry_wait = retry_backoff;
+             }
+         }
+     }
+ }
+
+ /** Applies everything queued so far; returns the number of updates. */
+ uint32_t GraphRenderThread::drain_updates()
+ {
+     uint32_t drained = 0U;
+     update_t update;
+
+     // Bounded so a flood of producers cannot starve the frame.
+     while (drained < queue_length && queue.pop(update))
+     {
+         apply(update);
+         drained++;
+     }
+     if (drained > 0U)
+     {
+         applied_count.fetch_add(drained, std::memory_order_relaxed);
+     }
+     return drained;
+ }
+
+ /** Applies one update to the scene (render thread only). */
+ void GraphRenderThread::apply(const update_t& update)
+ {
+     GraphWidget* target = update.target;
+
+     switch (update.kind)
+     {
+     case update_kind_t::SET_TEXT:
+         if (GraphButton* button = dynamic_cast<GraphButton*>(target))
+         {
+             button->set_text(update.text);
+         }
+         else if (GraphText* label = dynamic_cast<GraphText*>(target))
+         {
+             label->set_text(update.text);
+         }
+         break;
+
+     case update_kind_t::SET_COLOR:
+         if (GraphText* label = dynamic_cast<GraphText*>(target))
+         {
+             label->set_color(static_cast<uint8_t>(update.value >> 16), static_cast<uint8_t>(update.value >> 8),
+                              static_cast<uint8_t>(update.value));
+         }
+         break;
+
+     case update_kind_t::SET_OPTIONS:
+         if (GraphButton* button = dynamic_cast<GraphButton*>(target))
+         {
+             button->set_options(static_cast<uint16_t>(update.value));
+         }
+         break;
+
+     case update_kind_t::SET_POSITION:
+         if (GraphButton* button = dynamic_cast<GraphButton*>(target))
+         {
+             button->set_position(update.x, update.y);
+         }
+         else if (GraphBitmap* bitmap = dynamic_cast<GraphBitmap*>(target))
+         {
+             bitmap->set_position(static_cast<uint16_t>(update.x), static_cast<uint16_t>(update.y));
+         }
+         break;
+
+     case update_kind_t::SET_VISIBLE:
+         if (target != nullptr)
+         {
+             target->set_visible(update.value != 0U);
+         }
+         break;
+
+     case update_kind_t::SET_BITMAP:
+         if (GraphBitmap* bitmap = dynamic_cast<GraphBitmap*>(target))
+         {
+             if (update.bitmap != nullptr)
+             {
+                 bitmap->set_bitmap(*update.bitmap);
+             }
+         }
+         break;
+
+     case update_kind_t::SET_BACKGROUND:
+         scene.set_background(static_cast<uint8_t>(update.value >> 16), static_cast<uint8_t>(update.value >> 8),
+                              static_cast<uint8_t>(update.value));
+         break;
+
+     case update_kind_t::CALL:
+         if (update.apply != nullptr)
+         {
+             update.apply(target, update.value);
+         }
+         break;
+     }
+ }
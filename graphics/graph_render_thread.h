@@ -0,0 +1,128 @@
+/**
+ * @file graph_render_thread.h
+ * @brief Render thread that owns the FT800 and applies queued UI updates.
+ */
+
+ #ifndef GRAPH_RENDER_THREAD_H
+ #define GRAPH_RENDER_THREAD_H
+
+ #include <atomic>
+ #include <cstdint>
+ #include <pthread.h>
+ #include "graph_cmd_buffer.h"
+ #include "graph_device_definitions.h"
+ #include "graph_frame_pacer.h"
+ #include "graph_ft800.h"
+ #include "graph_mpsc_queue.h"
+ #include "graph_scene.h"
+
+ /**
+  * Serialises all display access on one thread. Once start() returns, only
+  * the render thread draws through the GraphFt800 or touches the command
+  * buffer and the scene; every other thread (application logic, Battery,
+  * ...) describes changes as update_t messages through post_*(), which are
+  * lock-free and never wait on SPI. The one exception is input:
+  * GraphTouchInput reads the touch registers and interrupt flags from its
+  * own thread, which GraphFt800 allows for reads and interrupts.
+  *
+  * Each frame period the thread drains the queue, applies every pending
+  * update to the scene and renders once, so a burst of updates costs one
+  * frame. Nothing is sent while the queue stays empty, unless the last
+  * render failed: the scene is then retried with a growing backoff of up
+  * to max_retry_backoff_frames, or at once when a new update arrives. With a
+  * GraphFramePacer attached the period and phase follow the panel's vsync;
+  * otherwise a fixed frame_period_us timer is used.
+  *
+  *     GraphRenderThread renderer(ft800, scene);
+  *     renderer.start();
+  *     renderer.post_text(&charge_label, "87%");     // from any thread
+  */
+ class GraphRenderThread
+ {
+ public:
+     static const uint32_t default_frame_period_us = 16667U;  // 60 Hz
+     static const size_t queue_length = 256U;
+     static const size_t max_text_length = 48U;
+     static const uint32_t max_retry_backoff_frames = 64U;   //!< Longest wait before re-rendering a failed frame
+
+     enum class update_kind_t : uint8_t
+     {
+         SET_TEXT = 0,      //!< GraphButton / GraphText
+         SET_COLOR,         //!< GraphText
+         SET_OPTIONS,       //!< GraphButton
+         SET_POSITION,      //!< GraphButton / GraphBitmap
+         SET_VISIBLE,       //!< Any widget
+         SET_BITMAP,        //!< GraphBitmap
+         SET_BACKGROUND,    //!< Scene clear colour, target unused
+         CALL               //!< Runs apply(target, value) on the render thread
+     };
+
+     struct update_t
+     {
+         update_kind_t kind;
+         GraphWidget* target;
+         int16_t x;
+         int16_t y;
+         uint32_t value;
+         const Device_definitions::bitmap_info_t* bitmap;
+         void (*apply)(GraphWidget* target, uint32_t value);
+         char text[max_text_length];
+     };
+
+     struct stats_t
+     {
+         uint32_t updates_posted;
+         uint32_t updates_dropped;   //!< Queue full
+         uint32_t updates_applied;
+         uint32_t frames_rendered;
+         uint32_t render_failures;   //!< Failed renders, retries included
+     };
+
+     GraphRenderThread(GraphFt800& ft800, GraphScene& scene);
+     ~GraphRenderThread();
+
+     /** Configure before start(); owned by the render thread afterwards. */
+     GraphCmdBuffer& get_buffer() { return buffer; }
+     void set_frame_period_us(uint32_t period_us) { frame_period_us = period_us; }
+     void attach_pacer(GraphFramePacer* frame_pacer) { pacer = frame_pacer; }
+
+     bool start();
+     void stop();
+     bool is_running() const { return thread_running.load(std::memory_order_acquire); }
+
+     bool post(const update_t& update);
+     bool post_text(GraphWidget* target, const char* text);
+     bool post_color(GraphWidget* target, uint8_t r, uint8_t g, uint8_t b);
+     bool post_options(GraphWidget* target, uint16_t options);
+     bool post_position(GraphWidget* target, int16_t x, int16_t y);
+     bool post_visible(GraphWidget* target, bool visible);
+     bool post_bitmap(GraphWidget* target, const Device_definitions::bitmap_info_t& info);
+     bool post_background(uint8_t r, uint8_t g, uint8_t b);
+     bool post_call(void (*apply)(GraphWidget* target, uint32_t value), GraphWidget* target, uint32_t value);
+
+     stats_t get_stats() const;
+
+ private:
+     static void* entry_routine(void* arg);
+     void main_loop();
+     uint32_t drain_updates();
+     void apply(const update_t& update);
+
+     GraphScene& scene;
+     GraphCmdBuffer buffer;
+     GraphMpscQueue<update_t, queue_length> queue;
+     uint32_t frame_period_us;
+     GraphFramePacer* pacer;
+
+     pthread_t thread_id;
+     std::atomic<bool> thread_running;
+     std::atomic<bool> stop_requested;
+
+     std::atomic<uint32_t> posted_count;
+     std::atomic<uint32_t> dropped_count;
+     std::atomic<uint32_t> applied_count;
+     std::atomic<uint32_t> frame_count;
+     std::atomic<uint32_t> failure_count;
+ };
+
+ #endif // GRAPH_RENDER_THREAD_H
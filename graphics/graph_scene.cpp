@@ -0,0 +1,829 @@
+/**
+ * @file graph_scene.cpp
+ * @brief Retained-mode widget tree with cached command fragments.
+ */
+
+ #include <algorithm>
+ #include "graph_scene.h"
+ #include "graph_bitmap_atlas.h"
+ #include "graph_dl_budget.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_touch.h"
+
+ // Tags 0, 254 and 255 have fixed meanings for Touch_buttons.
+ static const uint8_t first_auto_tag = 1U;
+ static const uint8_t last_auto_tag = Touch_buttons::button_released_tag - 1U;
+
+ GraphWidget::GraphWidget()
+     : parent(nullptr), dirty(true), subtree_dirty(true), structure_changed(false),
+       visible(true), touchable(false), fixed_tag(false), tag(Touch_buttons::untagged_icon_tag)
+ {
+ }
+
+ GraphWidget::~GraphWidget()
+ {
+     if (parent != nullptr)
+     {
+         parent->remove_child(this);
+     }
+     for (GraphWidget* child : children)
+     {
+         child->parent = nullptr;
+     }
+ }
+
+ /** Attaches a child; it is drawn after this widget and its earlier children. */
+ void GraphWidget::add_child(GraphWidget* child)
+ {
+     if (child != nullptr && child->parent == nullptr && child != this)
+     {
+         child->parent = this;
+         children.push_back(child);
+         mark_subtree_dirty();
+         mark_structure_changed();
+     }
+ }
+
+ /** Detaches a child. */
+ void GraphWidget::remove_child(GraphWidget* child)
+ {
+     std::vector<GraphWidget*>::iterator it = std::find(children.begin(), children.end(), child);
+     if (it != children.end())
+     {
+         (*it)->parent = nullptr;
+         children.erase(it);
+         mark_subtree_dirty();
+         mark_structure_changed();
+     }
+ }
+
+ /** Flags this widget's own words for re-encoding. */
+ void GraphWidget::mark_dirty()
+ {
+     dirty = true;
+     mark_subtree_dirty();
+ }
+
+ /** Flags this widget and all ancestors as needing their fragment rebuilt. */
+ void GraphWidget::mark_subtree_dirty()
+ {
+     for (GraphWidget* w = this; w != nullptr; w = w->parent)
+     {
+         w->subtree_dirty = true;
+     }
+ }
+
+ /** Tells the scene that touch tags must be reassigned. */
+ void GraphWidget::mark_structure_changed()
+ {
+     for (GraphWidget* w = this; w != nullptr; w = w->parent)
+     {
+         w->structure_changed = true;
+     }
+ }
+
+ /** Shows or hides the widget and its subtree. */
+ void GraphWidget::set_visible(bool show)
+ {
+     if (visible != show)
+     {
+         visible = show;
+         mark_subtree_dirty();
+     }
+ }
+
+ /** Requests an automatically assigned touch tag. */
+ void GraphWidget::set_touchable(bool enable)
+ {
+     if (touchable != enable)
+     {
+         touchable = enable;
+         if (!touchable)
+         {
+             fixed_tag = false;
+             tag = Touch_buttons::untagged_icon_tag;
+         }
+         mark_dirty();
+         mark_structure_changed();
+     }
+ }
+
+ /** Pins the touch tag, e.g. to one of the Touch_buttons constants. */
+ void GraphWidget::set_tag(uint8_t fixed)
+ {
+     touchable = true;
+     fixed_tag = true;
+     tag = fixed;
+     mark_dirty();
+     mark_structure_changed();
+ }
+
+ /** Containers draw nothing themselves. */
+ void GraphWidget::draw(GraphCmdEncoder& out)
+ {
+     (void)out;
+ }
+
+ /** Appends this subtree, rebuilding only the parts that changed. */
+ void GraphWidget::encode(GraphCmdEncoder& out, GraphScene& scene)
+ {
+     if (!visible)
+     {
+         // Pending changes stay flagged until the widget is shown again.
+         return;
+     }
+
+     if (subtree_dirty)
+     {
+         if (dirty)
+         {
+             own_fragment.reset();
+             if (touchable)
+             {
+                 own_fragment.tag(tag);
+             }
+             draw(own_fragment);
+             if (touchable)
+             {
+                 own_fragment.tag(Touch_buttons::untagged_icon_tag);
+             }
+             dirty = false;
+             scene.encoded_count++;
+         }
+
+         subtree_fragment.reset();
+         subtree_fragment.append(own_fragment.data(), own_fragment.size());
+         for (GraphWidget* child : children)
+         {
+             child->encode(subtree_fragment, scene);
+         }
+         subtree_dirty = false;
+     }
+     else
+     {
+         scene.replayed_count++;
+     }
+
+     out.append(subtree_fragment.data(), subtree_fragment.size());
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphButton::GraphButton(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, const char* text)
+     : x(x), y(y), w(w), h(h), font(font), options(OPT_3D), text((text != nullptr) ? text : "")
+ {
+ }
+
+ void GraphButton::set_text(const char* new_text)
+ {
+     const char* value = (new_text != nullptr) ? new_text : "";
+     if (text != value)
+     {
+         text = value;
+         mark_dirty();
+     }
+ }
+
+ void GraphButton::set_options(uint16_t new_options)
+ {
+     if (options != new_options)
+     {
+         options = new_options;
+         mark_dirty();
+     }
+ }
+
+ void GraphButton::set_position(int16_t new_x, int16_t new_y)
+ {
+     if (x != new_x || y != new_y)
+     {
+         x = new_x;
+         y = new_y;
+         mark_dirty();
+     }
+ }
+
+ void GraphButton::draw(GraphCmdEncoder& out)
+ {
+     out.cmd_button(x, y, w, h, font, options, text.c_str());
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphText::GraphText(int16_t x, int16_t y, int16_t font, uint16_t options, const char* text)
+     : x(x), y(y), font(font), options(options), color(0xFFFFFFU), text((text != nullptr) ? text : "")
+ {
+ }
+
+ void GraphText::set_text(const char* new_text)
+ {
+     const char* value = (new_text != nullptr) ? new_text : "";
+     if (text != value)
+     {
+         text = value;
+         mark_dirty();
+     }
+ }
+
+ void GraphText::set_color(uint8_t r, uint8_t g, uint8_t b)
+ {
+     uint32_t value = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+     if (color != value)
+     {
+         color = value;
+         mark_dirty();
+     }
+ }
+
+ /** The colour is kept inside a saved context so later widgets don't inherit it. */
+ void GraphText::draw(GraphCmdEncoder& out)
+ {
+     out.save_context();
+     out.color_rgb(static_cast<uint8_t>(color >> 16), static_cast<uint8_t>(color >> 8), static_cast<uint8_t>(color));
+     out.cmd_text(x, y, font, options, text.c_str());
+     out.restore_context();
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphBitmap::GraphBitmap(uint16_t x, uint16_t y, const Device_definitions::bitmap_info_t& info)
+     : x(x), y(y), info(&info), source(info.ram_g_offset), handle(info.handle)
+ {
+ }
+
+ void GraphBitmap::set_bitmap(const Device_definitions::bitmap_info_t& new_info)
+ {
+     if (info != &new_info)
+     {
+         info = &new_info;
+         source = new_info.ram_g_offset;
+         handle = new_info.handle;
+         mark_dirty();
+     }
+ }
+
+ void GraphBitmap::set_source(uint32_t ram_g_addr)
+ {
+     if (source != ram_g_addr)
+     {
+         source = ram_g_addr;
+         mark_dirty();
+     }
+ }
+
+ /** Uses the RAM_G offset and handle assigned by GraphBitmapCache. */
+ void GraphBitmap::set_placement(uint32_t ram_g_addr, uint8_t bitmap_handle)
+ {
+     if (source != ram_g_addr || handle != bitmap_handle)
+     {
+         source = ram_g_addr;
+         handle = bitmap_handle;
+         mark_dirty();
+     }
+ }
+
+ void GraphBitmap::set_position(uint16_t new_x, uint16_t new_y)
+ {
+     if (x != new_x || y != new_y)
+     {
+         x = new_x;
+         y = new_y;
+         mark_dirty();
+     }
+ }
+
+ void GraphBitmap::draw(GraphCmdEncoder& out)
+ {
+     out.bitmap_handle(handle);
+     out.bitmap_source(source);
+     out.bitmap_layout(info->format, info->stride, info->height);
+     out.bitmap_size(info->filter, info->wrap_x, info->wrap_y, info->width, info->height);
+     out.begin(PRIM_BITMAPS);
+     out.vertex2ii(x, y, handle, 0U);
+     out.end();
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphAtlasIcon::GraphAtlasIcon(uint16_t x, uint16_t y, const GraphBitmapAtlas& atlas, uint8_t cell)
+     : x(x), y(y), atlas(atlas), cell(cell)
+ {
+ }
+
+ void GraphAtlasIcon::set_cell(uint8_t new_cell)
+ {
+     if (cell != new_cell)
+     {
+         cell = new_cell;
+         mark_dirty();
+     }
+ }
+
+ void GraphAtlasIcon::set_position(uint16_t new_x, uint16_t new_y)
+ {
+     if (x != new_x || y != new_y)
+     {
+         x = new_x;
+         y = new_y;
+         mark_dirty();
+     }
+ }
+
+ void GraphAtlasIcon::draw(GraphCmdEncoder& out)
+ {
+     out.begin(PRIM_BITMAPS);
+     atlas.draw(out, x, y, cell);
+     out.end();
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphSpinner::GraphSpinner(int16_t x, int16_t y, uint16_t style, uint16_t scale)
+     : x(x), y(y), style(style), scale(scale)
+ {
+ }
+
+ void GraphSpinner::draw(GraphCmdEncoder& out)
+ {
+     out.cmd_spinner(x, y, style, scale);
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphControl::GraphControl()
+     : fgcolor(default_fgcolor), bgcolor(default_bgcolor)
+ {
+ }
+
+ void GraphControl::set_colors(uint32_t fg_rgb, uint32_t bg_rgb)
+ {
+     if (fgcolor != fg_rgb || bgcolor != bg_rgb)
+     {
+         fgcolor = fg_rgb;
+         bgcolor = bg_rgb;
+         mark_dirty();
+     }
+ }
+
+ void GraphControl::draw(GraphCmdEncoder& out)
+ {
+     bool custom = (fgcolor != default_fgcolor || bgcolor != default_bgcolor);
+     if (custom)
+     {
+         out.cmd_fgcolor(fgcolor);
+         out.cmd_bgcolor(bgcolor);
+     }
+     draw_control(out);
+     if (custom)
+     {
+         out.cmd_fgcolor(default_fgcolor);
+         out.cmd_bgcolor(default_bgcolor);
+     }
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphSlider::GraphSlider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range)
+     : x(x), y(y), w(w), h(h), options(options), val(val), range(range)
+ {
+ }
+
+ void GraphSlider::set_value(uint16_t new_val)
+ {
+     if (val != new_val)
+     {
+         val = new_val;
+         mark_dirty();
+     }
+ }
+
+ void GraphSlider::set_range(uint16_t new_range)
+ {
+     if (range != new_range)
+     {
+         range = new_range;
+         mark_dirty();
+     }
+ }
+
+ void GraphSlider::draw_control(GraphCmdEncoder& out)
+ {
+     out.cmd_slider(x, y, w, h, options, val, range);
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphToggle::GraphToggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, const char* text)
+     : x(x), y(y), w(w), font(font), options(options), state(false), text((text != nullptr) ? text : "")
+ {
+ }
+
+ void GraphToggle::set_state(bool on)
+ {
+     if (state != on)
+     {
+         state = on;
+         mark_dirty();
+     }
+ }
+
+ void GraphToggle::set_text(const char* new_text)
+ {
+     const char* value = (new_text != nullptr) ? new_text : "";
+     if (text != value)
+     {
+         text = value;
+         mark_dirty();
+     }
+ }
+
+ void GraphToggle::draw_control(GraphCmdEncoder& out)
+ {
+     out.cmd_toggle(x, y, w, font, options, state ? 0xFFFFU : 0U, text.c_str());
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphDial::GraphDial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val)
+     : x(x), y(y), r(r), options(options), val(val)
+ {
+ }
+
+ void GraphDial::set_value(uint16_t new_val)
+ {
+     if (val != new_val)
+     {
+         val = new_val;
+         mark_dirty();
+     }
+ }
+
+ void GraphDial::draw_control(GraphCmdEncoder& out)
+ {
+     out.cmd_dial(x, y, r, options, val);
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphGauge::GraphGauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                        uint16_t val, uint16_t range)
+     : x(x), y(y), r(r), options(options), major(major), minor(minor), val(val), range(range)
+ {
+ }
+
+ void GraphGauge::set_value(uint16_t new_val)
+ {
+     if (val != new_val)
+     {
+         val = new_val;
+         mark_dirty();
+     }
+ }
+
+ void GraphGauge::set_range(uint16_t new_range)
+ {
+     if (range != new_range)
+     {
+         range = new_range;
+         mark_dirty();
+     }
+ }
+
+ void GraphGauge::draw_control(GraphCmdEncoder& out)
+ {
+     out.cmd_gauge(x, y, r, options, major, minor, val, range);
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphClock::GraphClock(int16_t x, int16_t y, int16_t r, uint16_t options)
+     : x(x), y(y), r(r), options(options), hours(0U), minutes(0U), seconds(0U), millis(0U)
+ {
+ }
+
+ void GraphClock::set_time(uint16_t h, uint16_t m, uint16_t s, uint16_t ms)
+ {
+     if (hours != h || minutes != m || seconds != s || millis != ms)
+     {
+         hours = h;
+         minutes = m;
+         seconds = s;
+         millis = ms;
+         mark_dirty();
+     }
+ }
+
+ void GraphClock::draw_control(GraphCmdEncoder& out)
+ {
+     out.cmd_clock(x, y, r, options, hours, minutes, seconds, millis);
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphKeys::GraphKeys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys)
+     : x(x), y(y), w(w), h(h), font(font), options(options), pressed('\0'), keys((keys != nullptr) ? keys : "")
+ {
+ }
+
+ void GraphKeys::set_keys(const char* new_keys)
+ {
+     const char* value = (new_keys != nullptr) ? new_keys : "";
+     if (keys != value)
+     {
+         keys = value;
+         mark_dirty();
+     }
+ }
+
+ /** Draws @p key pushed in; '\0' releases it. */
+ void GraphKeys::set_pressed(char key)
+ {
+     if (pressed != key)
+     {
+         pressed = key;
+         mark_dirty();
+     }
+ }
+
+ void GraphKeys::draw_control(GraphCmdEncoder& out)
+ {
+     uint16_t key = static_cast<uint8_t>(pressed);
+     out.cmd_keys(x, y, w, h, font, static_cast<uint16_t>((options & 0xFF00U) | key), keys.c_str());
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphNumber::GraphNumber(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t value)
+     : x(x), y(y), font(font), options(options), color(0xFFFFFFU), value(value)
+ {
+ }
+
+ void GraphNumber::set_value(int32_t new_value)
+ {
+     if (value != new_value)
+     {
+         value = new_value;
+         mark_dirty();
+     }
+ }
+
+ void GraphNumber::set_color(uint8_t r, uint8_t g, uint8_t b)
+ {
+     uint32_t rgb = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+     if (color != rgb)
+     {
+         color = rgb;
+         mark_dirty();
+     }
+ }
+
+ /** Like GraphText, the colour stays inside a saved context. */
+ void GraphNumber::draw(GraphCmdEncoder& out)
+ {
+     out.save_context();
+     out.color_rgb(static_cast<uint8_t>(color >> 16), static_cast<uint8_t>(color >> 8), static_cast<uint8_t>(color));
+     out.cmd_number(x, y, font, static_cast<uint16_t>(options | ((value < 0) ? OPT_SIGNED : 0U)), value);
+     out.restore_context();
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphReadout::GraphReadout(int16_t x, int16_t y, int16_t font, const char* unit, const char* placeholder)
+     : x(x), y(y), font(font), color(0xFFFFFFU), value(0), known(false),
+       unit((unit != nullptr) ? unit : ""), placeholder((placeholder != nullptr) ? placeholder : "")
+ {
+ }
+
+ void GraphReadout::set_value(int32_t new_value)
+ {
+     if (!known || value != new_value)
+     {
+         value = new_value;
+         known = true;
+         mark_dirty();
+     }
+ }
+
+ void GraphReadout::set_unknown()
+ {
+     if (known)
+     {
+         known = false;
+         mark_dirty();
+     }
+ }
+
+ void GraphReadout::set_color(uint8_t r, uint8_t g, uint8_t b)
+ {
+     uint32_t rgb = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+     if (color != rgb)
+     {
+         color = rgb;
+         mark_dirty();
+     }
+ }
+
+ /** Value and unit share one saved context, so the colour ends with the readout. */
+ void GraphReadout::draw(GraphCmdEncoder& out)
+ {
+     out.save_context();
+     out.color_rgb(static_cast<uint8_t>(color >> 16), static_cast<uint8_t>(color >> 8), static_cast<uint8_t>(color));
+     if (known)
+     {
+         uint16_t options = static_cast<uint16_t>(OPT_RIGHTX | ((value < 0) ? OPT_SIGNED : 0U));
+         out.cmd_number(x, y, font, options, value);
+     }
+     else
+     {
+         out.cmd_text(x, y, font, OPT_RIGHTX, placeholder.c_str());
+     }
+     if (!unit.empty())
+     {
+         out.cmd_text(x, y, font, 0U, unit.c_str());
+     }
+     out.restore_context();
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphGradient::GraphGradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1)
+     : x0(x0), y0(y0), x1(x1), y1(y1), rgb0(rgb0), rgb1(rgb1)
+ {
+ }
+
+ void GraphGradient::set_colors(uint32_t new_rgb0, uint32_t new_rgb1)
+ {
+     if (rgb0 != new_rgb0 || rgb1 != new_rgb1)
+     {
+         rgb0 = new_rgb0;
+         rgb1 = new_rgb1;
+         mark_dirty();
+     }
+ }
+
+ void GraphGradient::draw(GraphCmdEncoder& out)
+ {
+     out.cmd_gradient(x0, y0, rgb0, x1, y1, rgb1);
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphScene::GraphScene()
+     : background(0U), budget(nullptr), encoded_count(0U), replayed_count(0U)
+ {
+ }
+
+ GraphScene::~GraphScene() {}
+
+ /** Sets the clear colour emitted at the start of every frame. */
+ void GraphScene::set_background(uint8_t r, uint8_t g, uint8_t b)
+ {
+     background = (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+ }
+
+ /** Adds an atlas whose handle is set up after the clear of every frame; not owned. */
+ void GraphScene::attach_atlas(const GraphBitmapAtlas* atlas)
+ {
+     if (atlas != nullptr && std::find(atlases.begin(), atlases.end(), atlas) == atlases.end())
+     {
+         atlases.push_back(atlas);
+     }
+ }
+
+ /** Appends the whole tree; counters reflect only this call. */
+ void GraphScene::encode(GraphCmdEncoder& out)
+ {
+     encoded_count = 0U;
+     replayed_count = 0U;
+
+     if (root_widget.structure_changed)
+     {
+         assign_tags();
+     }
+
+     out.clear_color_rgb(static_cast<uint8_t>(background >> 16), static_cast<uint8_t>(background >> 8),
+                         static_cast<uint8_t>(background));
+     out.clear(true, true, true);
+     for (const GraphBitmapAtlas* atlas : atlases)
+     {
+         atlas->setup(out);
+     }
+     root_widget.encode(out, *this);
+ }
+
+ /**
+  * Builds and submits one frame. Skipping an unchanged frame is up to the
+  * buffer's own set_skip_unchanged(), e.g. as GraphRenderThread sets it.
+  * With a budget attached the frame is accounted per widget, and a frame
+  * whose display list cannot fit RAM_DL is dropped instead of faulting the
+  * co-processor.
+  */
+ bool GraphScene::render(GraphCmdBuffer& buffer)
+ {
+     buffer.begin_frame();
+     encode(buffer);
+     if (budget == nullptr)
+     {
+         return buffer.end_frame();
+     }
+
+     budget->begin_frame();
+     account(root_widget);
+     if (!budget->admit(buffer.data(), buffer.size()))
+     {
+         buffer.reset();
+         budget->end_frame(false);
+         return false;
+     }
+
+     uint32_t submitted_before = buffer.frames_submitted();
+     bool result = buffer.end_frame();
+     budget->end_frame(result && buffer.frames_submitted() != submitted_before);
+     return result;
+ }
+
+ /** Reports every visible widget's own fragment to the budget, in draw order. */
+ void GraphScene::account(GraphWidget& widget)
+ {
+     if (!widget.visible)
+     {
+         return;
+     }
+     if (widget.own_fragment.size() > 0U)
+     {
+         budget->add_widget(widget.kind(), widget.touchable ? widget.tag : Touch_buttons::untagged_icon_tag,
+                            widget.own_fragment.data(), widget.own_fragment.size());
+     }
+     for (GraphWidget* child : widget.children)
+     {
+         account(*child);
+     }
+ }
+
+ /** Numbers touchable widgets in tree order, around any fixed tags. */
+ void GraphScene::assign_tags()
+ {
+     bool used[256] = { false };
+     uint8_t next = first_auto_tag;
+
+     collect_fixed_tags(root_widget, used);
+     assign_tags(root_widget, next, used);
+ }
+
+ void GraphScene::collect_fixed_tags(GraphWidget& widget, bool* used)
+ {
+     if (widget.touchable && widget.fixed_tag)
+     {
+         used[widget.tag] = true;
+     }
+     for (GraphWidget* child : widget.children)
+     {
+         collect_fixed_tags(*child, used);
+     }
+ }
+
+ void GraphScene::assign_tags(GraphWidget& widget, uint8_t& next, const bool* used)
+ {
+     widget.structure_changed = false;
+
+     if (widget.touchable && !widget.fixed_tag)
+     {
+         while (next <= last_auto_tag && used[next])
+         {
+             next++;
+         }
+         uint8_t assigned = (next <= last_auto_tag) ? next++ : Touch_buttons::untagged_icon_tag;
+         if (widget.tag != assigned)
+         {
+             widget.tag = assigned;
+             widget.mark_dirty();
+         }
+     }
+     for (GraphWidget* child : widget.children)
+     {
+         assign_tags(*child, next, used);
+     }
+ }
+
+ /** Maps a touch tag back to its widget. */
+ GraphWidget* GraphScene::find_by_tag(uint8_t tag)
+ {
+     return find_by_tag(root_widget, tag);
+ }
+
+ GraphWidget* GraphScene::find_by_tag(GraphWidget& widget, uint8_t tag)
+ {
+     if (widget.touchable && widget.tag == tag)
+     {
+         return &widget;
+     }
+     for (GraphWidget* child : widget.children)
+     {
+         GraphWidget* found = find_by_tag(*child, tag);
+         if (found != nullptr)
+         {
+             return found;
+         }
+     }
+     return nullptr;
+ }
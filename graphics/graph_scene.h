@@ -0,0 +1,444 @@
+/**
+ * @file graph_scene.h
+ * @brief Retained-mode widget tree with cached command fragments.
+ */
+
+ #ifndef GRAPH_SCENE_H
+ #define GRAPH_SCENE_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <string>
+ #include <vector>
+ #include "graph_cmd_encoder.h"
+ #include "graph_cmd_buffer.h"
+ #include "graph_device_definitions.h"
+
+ class GraphScene;
+ class GraphDlBudget;
+ class GraphBitmapAtlas;
+
+ /**
+  * Base widget. Widgets own their state and call mark_dirty() when it
+  * changes; a dirty widget re-encodes its own words, every ancestor rebuilds
+  * its subtree fragment, and clean subtrees are copied from cache as one block.
+  * Children are not owned.
+  */
+ class GraphWidget
+ {
+ public:
+     GraphWidget();
+     virtual ~GraphWidget();
+
+     void add_child(GraphWidget* child);
+     void remove_child(GraphWidget* child);
+
+     void mark_dirty();
+     bool is_dirty() const { return dirty || subtree_dirty; }
+
+     void set_visible(bool show);
+     bool is_visible() const { return visible; }
+
+     void set_touchable(bool enable);
+     void set_tag(uint8_t fixed_tag);
+     uint8_t get_tag() const { return tag; }
+
+     /** Short type name used in budget reports. */
+     virtual const char* kind() const { return "group"; }
+
+ protected:
+     /** Emits this widget's own words (children are handled by the tree). */
+     virtual void draw(GraphCmdEncoder& out);
+
+ private:
+     friend class GraphScene;
+
+     void mark_subtree_dirty();
+     void mark_structure_changed();
+     void encode(GraphCmdEncoder& out, GraphScene& scene);
+
+     GraphWidget* parent;
+     std::vector<GraphWidget*> children;
+     GraphCmdEncoder own_fragment;
+     GraphCmdEncoder subtree_fragment;
+     bool dirty;
+     bool subtree_dirty;
+     bool structure_changed;
+     bool visible;
+     bool touchable;
+     bool fixed_tag;
+     uint8_t tag;
+ };
+
+ /** Co-processor button. */
+ class GraphButton : public GraphWidget
+ {
+ public:
+     GraphButton(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, const char* text);
+
+     void set_text(const char* new_text);
+     void set_options(uint16_t new_options);
+     void set_position(int16_t new_x, int16_t new_y);
+
+     const char* kind() const override { return "button"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, w, h, font;
+     uint16_t options;
+     std::string text;
+ };
+
+ /** Co-processor text label. */
+ class GraphText : public GraphWidget
+ {
+ public:
+     GraphText(int16_t x, int16_t y, int16_t font, uint16_t options, const char* text);
+
+     void set_text(const char* new_text);
+     void set_color(uint8_t r, uint8_t g, uint8_t b);
+
+     const char* kind() const override { return "text"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, font;
+     uint16_t options;
+     uint32_t color;
+     std::string text;
+ };
+
+ /** Bitmap drawn from RAM_G through its own handle. */
+ class GraphBitmap : public GraphWidget
+ {
+ public:
+     GraphBitmap(uint16_t x, uint16_t y, const Device_definitions::bitmap_info_t& info);
+
+     void set_bitmap(const Device_definitions::bitmap_info_t& new_info);
+     void set_source(uint32_t ram_g_addr);
+     void set_placement(uint32_t ram_g_addr, uint8_t bitmap_handle);
+     void set_position(uint16_t new_x, uint16_t new_y);
+
+     const char* kind() const override { return "bitmap"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     uint16_t x, y;
+     const Device_definitions::bitmap_info_t* info;
+     uint32_t source;
+     uint8_t handle;
+ };
+
+ /**
+  * One cell of a GraphBitmapAtlas. The scene sets the atlas handle up once
+  * per frame (GraphScene::attach_atlas()), so the widget is just BEGIN,
+  * VERTEX2II and END, and set_cell() changes only the VERTEX2II word.
+  */
+ class GraphAtlasIcon : public GraphWidget
+ {
+ public:
+     GraphAtlasIcon(uint16_t x, uint16_t y, const GraphBitmapAtlas& atlas, uint8_t cell = 0U);
+
+     void set_cell(uint8_t new_cell);
+     void set_position(uint16_t new_x, uint16_t new_y);
+     uint8_t get_cell() const { return cell; }
+
+     const char* kind() const override { return "icon"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     uint16_t x, y;
+     const GraphBitmapAtlas& atlas;
+     uint8_t cell;
+ };
+
+ /** Co-processor spinner. */
+ class GraphSpinner : public GraphWidget
+ {
+ public:
+     GraphSpinner(int16_t x, int16_t y, uint16_t style, uint16_t scale);
+
+     const char* kind() const override { return "spinner"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y;
+     uint16_t style, scale;
+ };
+
+ /**
+  * Base of the co-processor controls. Their colours come from CMD_FGCOLOR /
+  * CMD_BGCOLOR, which persist in the co-processor until the next
+  * CMD_DLSTART; a control with its own colours restores the defaults after
+  * drawing so cached fragments stay order-independent.
+  */
+ class GraphControl : public GraphWidget
+ {
+ public:
+     static const uint32_t default_fgcolor = 0x003870U;   //!< Co-processor defaults after CMD_DLSTART
+     static const uint32_t default_bgcolor = 0x002040U;
+
+     GraphControl();
+
+     void set_colors(uint32_t fg_rgb, uint32_t bg_rgb);
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+     virtual void draw_control(GraphCmdEncoder& out) = 0;
+
+ private:
+     uint32_t fgcolor;
+     uint32_t bgcolor;
+ };
+
+ /** Co-processor slider; touchable sliders can be tracked with CMD_TRACK. */
+ class GraphSlider : public GraphControl
+ {
+ public:
+     GraphSlider(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t options, uint16_t val, uint16_t range);
+
+     void set_value(uint16_t new_val);
+     void set_range(uint16_t new_range);
+     uint16_t get_value() const { return val; }
+
+     const char* kind() const override { return "slider"; }
+
+ protected:
+     void draw_control(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, w, h;
+     uint16_t options, val, range;
+ };
+
+ /** Co-processor toggle; @p text holds the off and on labels separated by 0xFF. */
+ class GraphToggle : public GraphControl
+ {
+ public:
+     GraphToggle(int16_t x, int16_t y, int16_t w, int16_t font, uint16_t options, const char* text);
+
+     void set_state(bool on);
+     void set_text(const char* new_text);
+     bool get_state() const { return state; }
+
+     const char* kind() const override { return "toggle"; }
+
+ protected:
+     void draw_control(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, w, font;
+     uint16_t options;
+     bool state;
+     std::string text;
+ };
+
+ /** Co-processor rotary dial; the value is an angle, 0 to 65535 for a full turn. */
+ class GraphDial : public GraphControl
+ {
+ public:
+     GraphDial(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t val);
+
+     void set_value(uint16_t new_val);
+     uint16_t get_value() const { return val; }
+
+     const char* kind() const override { return "dial"; }
+
+ protected:
+     void draw_control(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, r;
+     uint16_t options, val;
+ };
+
+ /** Co-processor gauge. */
+ class GraphGauge : public GraphControl
+ {
+ public:
+     GraphGauge(int16_t x, int16_t y, int16_t r, uint16_t options, uint16_t major, uint16_t minor,
+                uint16_t val, uint16_t range);
+
+     void set_value(uint16_t new_val);
+     void set_range(uint16_t new_range);
+     uint16_t get_value() const { return val; }
+
+     const char* kind() const override { return "gauge"; }
+
+ protected:
+     void draw_control(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, r;
+     uint16_t options, major, minor, val, range;
+ };
+
+ /** Co-processor analogue clock. */
+ class GraphClock : public GraphControl
+ {
+ public:
+     GraphClock(int16_t x, int16_t y, int16_t r, uint16_t options);
+
+     void set_time(uint16_t h, uint16_t m, uint16_t s, uint16_t ms = 0U);
+
+     const char* kind() const override { return "clock"; }
+
+ protected:
+     void draw_control(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, r;
+     uint16_t options, hours, minutes, seconds, millis;
+ };
+
+ /**
+  * Co-processor key row, one key per character; the pressed key is drawn
+  * pushed in. The co-processor tags every key with its character code.
+  */
+ class GraphKeys : public GraphControl
+ {
+ public:
+     GraphKeys(int16_t x, int16_t y, int16_t w, int16_t h, int16_t font, uint16_t options, const char* keys);
+
+     void set_keys(const char* new_keys);
+     void set_pressed(char key);
+
+     const char* kind() const override { return "keys"; }
+
+ protected:
+     void draw_control(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, w, h, font;
+     uint16_t options;
+     char pressed;
+     std::string keys;
+ };
+
+ /** Integer formatted by the co-processor (CMD_NUMBER). */
+ class GraphNumber : public GraphWidget
+ {
+ public:
+     GraphNumber(int16_t x, int16_t y, int16_t font, uint16_t options, int32_t value);
+
+     void set_value(int32_t new_value);
+     void set_color(uint8_t r, uint8_t g, uint8_t b);
+     int32_t get_value() const { return value; }
+
+     const char* kind() const override { return "number"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, font;
+     uint16_t options;
+     uint32_t color;
+     int32_t value;
+ };
+
+ /**
+  * Live numeric readout such as a charge percentage. The value goes to the
+  * co-processor as CMD_NUMBER, so an update needs no host-side formatting.
+  * The number is right-aligned at x and the unit drawn from x on, so
+  * neither moves as the digit count changes; OPT_SIGNED is added for
+  * negative values. Until a value is set, or after set_unknown(), the
+  * placeholder is shown instead.
+  */
+ class GraphReadout : public GraphWidget
+ {
+ public:
+     GraphReadout(int16_t x, int16_t y, int16_t font, const char* unit, const char* placeholder = "--");
+
+     void set_value(int32_t new_value);
+     void set_unknown();
+     void set_color(uint8_t r, uint8_t g, uint8_t b);
+     bool has_value() const { return known; }
+     int32_t get_value() const { return value; }
+
+     const char* kind() const override { return "readout"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x, y, font;
+     uint32_t color;
+     int32_t value;
+     bool known;
+     std::string unit;
+     std::string placeholder;
+ };
+
+ /**
+  * Co-processor gradient between two points (colours 0xRRGGBB). It fills
+  * the whole scissor area, so it is usually the first child of the root.
+  */
+ class GraphGradient : public GraphWidget
+ {
+ public:
+     GraphGradient(int16_t x0, int16_t y0, uint32_t rgb0, int16_t x1, int16_t y1, uint32_t rgb1);
+
+     void set_colors(uint32_t new_rgb0, uint32_t new_rgb1);
+
+     const char* kind() const override { return "gradient"; }
+
+ protected:
+     void draw(GraphCmdEncoder& out) override;
+
+ private:
+     int16_t x0, y0, x1, y1;
+     uint32_t rgb0, rgb1;
+ };
+
+ /**
+  * Root of a widget tree. Assigns touch tags to touchable widgets, and
+  * encodes the tree into a frame, re-encoding only what changed.
+  */
+ class GraphScene
+ {
+ public:
+     GraphScene();
+     ~GraphScene();
+
+     GraphWidget& root() { return root_widget; }
+
+     void set_background(uint8_t r, uint8_t g, uint8_t b);
+     void attach_budget(GraphDlBudget* analyzer) { budget = analyzer; }
+     void attach_atlas(const GraphBitmapAtlas* atlas);
+     void encode(GraphCmdEncoder& out);
+     bool render(GraphCmdBuffer& buffer);
+
+     GraphWidget* find_by_tag(uint8_t tag);
+
+     uint32_t widgets_encoded() const { return encoded_count; }
+     uint32_t fragments_replayed() const { return replayed_count; }
+
+ private:
+     friend class GraphWidget;
+
+     void assign_tags();
+     void assign_tags(GraphWidget& widget, uint8_t& next, const bool* used);
+     void collect_fixed_tags(GraphWidget& widget, bool* used);
+     GraphWidget* find_by_tag(GraphWidget& widget, uint8_t tag);
+     void account(GraphWidget& widget);
+
+     GraphWidget root_widget;
+     std::vector<const GraphBitmapAtlas*> atlases;
+     uint32_t background;
+     GraphDlBudget* budget;
+     uint32_t encoded_count;
+     uint32_t replayed_count;
+ };
+
+ #endif // GRAPH_SCENE_H
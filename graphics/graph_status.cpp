@@ -0,0 +1,40 @@
+/**
+ * @file graph_status.cpp
+ * @brief errno classification and text for graph_status_t.
+ */
+
+ #include <cerrno>
+ #include "graph_status.h"
+
+ /** Maps a driver errno onto the error kinds callers act on. */
+ graph_error_t graph_status_t::classify(int sys_errno)
+ {
+     switch (sys_errno)
+     {
+     case 0:          return graph_error_t::NONE;
+     case EAGAIN:
+     case EBUSY:
+     case EINTR:      return graph_error_t::BUSY;
+     case ETIMEDOUT:  return graph_error_t::TIMEOUT;
+     case EBADF:      return graph_error_t::NOT_OPEN;
+     case EINVAL:
+     case EFAULT:
+     case ENOTTY:
+     case E2BIG:      return graph_error_t::INVALID_ARGUMENT;
+     default:         return graph_error_t::IO;
+     }
+ }
+
+ const char* graph_status_t::describe() const
+ {
+     switch (error)
+     {
+     case graph_error_t::NONE:             return "ok";
+     case graph_error_t::NOT_OPEN:         return "device not open";
+     case graph_error_t::INVALID_ARGUMENT: return "invalid argument";
+     case graph_error_t::BUSY:             return "busy, retries exhausted";
+     case graph_error_t::TIMEOUT:          return "timed out";
+     case graph_error_t::IO:               return "I/O error";
+     default:                              return "unknown";
+     }
+ }
@@ -0,0 +1,52 @@
+/**
+ * @file graph_status.h
+ * @brief Typed results for GraphFt800 driver calls.
+ */
+
+ #ifndef GRAPH_STATUS_H
+ #define GRAPH_STATUS_H
+
+ #include <cstdint>
+
+ enum class graph_error_t : uint8_t
+ {
+     NONE = 0,
+     NOT_OPEN,           //!< No device behind the transport
+     INVALID_ARGUMENT,   //!< Rejected before the driver, or EINVAL / EFAULT / ENOTTY
+     BUSY,               //!< EAGAIN / EBUSY still returned when the retry policy ran out
+     TIMEOUT,            //!< ETIMEDOUT
+     IO                  //!< Any other driver error (EIO, ENODEV, ...)
+ };
+
+ /** Outcome of one GraphFt800 operation; errno is kept for logging. */
+ struct graph_status_t
+ {
+     graph_error_t error;
+     int sys_errno;         //!< errno of the last failed attempt, 0 on success
+     uint16_t attempts;     //!< ioctl calls made, retries included
+
+     bool ok() const { return error == graph_error_t::NONE; }
+     explicit operator bool() const { return ok(); }
+     const char* describe() const;
+
+     static graph_status_t success(uint16_t attempts = 1U) { return {graph_error_t::NONE, 0, attempts}; }
+     static graph_status_t failure(graph_error_t error, int sys_errno = 0, uint16_t attempts = 0U)
+     {
+         return {error, sys_errno, attempts};
+     }
+     static graph_error_t classify(int sys_errno);
+ };
+
+ /** A value read from the device together with the status of the read. */
+ template <typename T>
+ struct graph_result_t
+ {
+     graph_status_t status;
+     T value;
+
+     bool ok() const { return status.ok(); }
+     explicit operator bool() const { return status.ok(); }
+     T value_or(const T& fallback) const { return status.ok() ? value : fallback; }
+ };
+
+ #endif // GRAPH_STATUS_H
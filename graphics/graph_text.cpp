@@ -0,0 +1,205 @@
+/**
+ * @file graph_text.cpp
+ * @brief Interned label strings, cached CMD_TEXT fragments and host-side text measurement.
+ */
+
+ #include <cstring>
+ #include <endian.h>
+ #include "graph_text.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_ft800Reg.h"
+
+ static const size_t metric_block_bytes = 148U;
+ static const uint8_t rom_font_count = GraphFontMetrics::font_count - GraphFontMetrics::first_rom_font;
+
+ static_assert(sizeof(GraphFontMetrics::font_t) == metric_block_bytes, "font_t must match the FT800 metric block");
+
+ static inline uint32_t pack16(int32_t lo, int32_t hi)
+ {
+     return (static_cast<uint32_t>(hi & 0xFFFF) << 16) | static_cast<uint32_t>(lo & 0xFFFF);
+ }
+
+ GraphFontMetrics::GraphFontMetrics()
+ {
+     (void)memset(fonts, 0, sizeof(fonts));
+     (void)memset(present, 0, sizeof(present));
+ }
+
+ /**
+  * Reads the ROM font table: its address from ROM_FONT_ADDR, then the 16
+  * metric blocks in one burst. Called once at startup; the ROM never changes.
+  */
+ bool GraphFontMetrics::load(GraphFt800& ft800)
+ {
+     uint32_t table = 0U;
+     if (!ft800.read_reg32(ROM_FONT_ADDR, &table))
+     {
+         return false;
+     }
+
+     font_t rom[rom_font_count];
+     if (!ft800.mem_read(table, rom, sizeof(rom)))
+     {
+         return false;
+     }
+     for (uint8_t i = 0U; i < rom_font_count; ++i)
+     {
+         font_t& font = rom[i];
+         font.format = le32toh(font.format);
+         font.stride = le32toh(font.stride);
+         font.width = le32toh(font.width);
+         font.height = le32toh(font.height);
+         font.ptr = le32toh(font.ptr);
+         (void)set_font(static_cast<uint8_t>(first_rom_font + i), font);
+     }
+     return true;
+ }
+
+ /** Registers the metrics of a font, e.g. one installed in RAM_G with CMD_SETFONT. */
+ bool GraphFontMetrics::set_font(uint8_t font, const font_t& metrics)
+ {
+     if (font >= font_count)
+     {
+         return false;
+     }
+     fonts[font] = metrics;
+     present[font] = true;
+     return true;
+ }
+
+ bool GraphFontMetrics::has_font(int16_t font) const
+ {
+     return font >= 0 && font < font_count && present[font];
+ }
+
+ uint16_t GraphFontMetrics::char_width(int16_t font, char c) const
+ {
+     uint8_t code = static_cast<uint8_t>(c);
+     return (has_font(font) && code < 128U) ? fonts[font].widths[code] : 0U;
+ }
+
+ /** Width in pixels of @p text drawn in @p font; 0 for an unknown font. */
+ uint16_t GraphFontMetrics::width(int16_t font, const char* text) const
+ {
+     return (text != nullptr) ? width(font, text, strlen(text)) : 0U;
+ }
+
+ uint16_t GraphFontMetrics::width(int16_t font, const char* text, size_t length) const
+ {
+     if (!has_font(font) || text == nullptr)
+     {
+         return 0U;
+     }
+     const uint8_t* widths = fonts[font].widths;
+     uint32_t total = 0U;
+     for (size_t i = 0U; i < length; ++i)
+     {
+         uint8_t code = static_cast<uint8_t>(text[i]);
+         total += (code < 128U) ? widths[code] : 0U;
+     }
+     return static_cast<uint16_t>((total > 0xFFFFU) ? 0xFFFFU : total);
+ }
+
+ uint16_t GraphFontMetrics::height(int16_t font) const
+ {
+     return has_font(font) ? static_cast<uint16_t>(fonts[font].height) : 0U;
+ }
+
+ // ------------------------------------------------------------------
+
+ GraphTextCache::GraphTextCache(size_t max_interned)
+     : max_interned(max_interned)
+ {
+     (void)memset(&stats, 0, sizeof(stats));
+ }
+
+ GraphTextCache::~GraphTextCache() {}
+
+ /**
+  * Returns the pooled copy of @p text, adding it if needed; nullptr once
+  * the pool is full. The pointer stays valid until clear().
+  */
+ GraphInternedText* GraphTextCache::intern(const char* text)
+ {
+     std::string_view key((text != nullptr) ? text : "");
+     std::unordered_map<std::string_view, GraphInternedText*>::iterator found = index.find(key);
+     if (found != index.end())
+     {
+         return found->second;
+     }
+     if (index.size() >= max_interned)
+     {
+         return nullptr;
+     }
+
+     pool.emplace_back();
+     GraphInternedText& entry = pool.back();
+     entry.chars.assign(key.data(), key.size() > 0xFFFFU ? 0xFFFFU : key.size());
+     entry.placed = false;
+
+     size_t length = entry.chars.size();
+     entry.fragment.assign(GraphInternedText::header_words + (length + 4U) / 4U, 0U);
+     entry.fragment[0] = CMD_TEXT;
+     uint32_t* words = entry.fragment.data() + GraphInternedText::header_words;
+     for (size_t i = 0U; i < length; ++i)
+     {
+         words[i / 4U] |= static_cast<uint32_t>(static_cast<uint8_t>(entry.chars[i])) << (8U * (i % 4U));
+     }
+
+     // The deque never moves its elements, so the view stays valid.
+     index.emplace(std::string_view(entry.chars), &entry);
+     stats.interned = static_cast<uint32_t>(index.size());
+     return &entry;
+ }
+
+ /** Drops every interned string; earlier intern() pointers become invalid. */
+ void GraphTextCache::clear()
+ {
+     index.clear();
+     pool.clear();
+     stats.interned = 0U;
+ }
+
+ /** Appends CMD_TEXT for @p text, interning it on first use. */
+ void GraphTextCache::text(GraphCmdEncoder& out, int16_t x, int16_t y, int16_t font, uint16_t options, const char* text)
+ {
+     GraphInternedText* entry = intern(text);
+     if (entry == nullptr)
+     {
+         stats.uncached++;
+         out.cmd_text(x, y, font, options, text);
+         return;
+     }
+     this->text(out, x, y, font, options, entry);
+ }
+
+ /** Appends CMD_TEXT for an interned string, rewriting the cached header only if it moved. */
+ void GraphTextCache::text(GraphCmdEncoder& out, int16_t x, int16_t y, int16_t font, uint16_t options, GraphInternedText* text)
+ {
+     if (text == nullptr)
+     {
+         return;
+     }
+     uint32_t xy = pack16(x, y);
+     uint32_t font_options = pack16(font, options);
+     std::vector<uint32_t>& fragment = text->fragment;
+
+     if (text->placed && fragment[1] == xy && fragment[2] == font_options)
+     {
+         stats.hits++;
+     }
+     else
+     {
+         fragment[1] = xy;
+         fragment[2] = font_options;
+         text->placed = true;
+         stats.misses++;
+     }
+     out.append(fragment.data(), fragment.size());
+ }
+
+ /** Width of an interned string in @p font, without scanning for its end. */
+ uint16_t GraphTextCache::width(const GraphFontMetrics& metrics, int16_t font, const GraphInternedText* text)
+ {
+     return (text != nullptr) ? metrics.width(font, text->c_str(), text->length()) : 0U;
+ }
@@ -0,0 +1,132 @@
+/**
+ * @file graph_text.h
+ * @brief Interned label strings, cached CMD_TEXT fragments and host-side text measurement.
+ */
+
+ #ifndef GRAPH_TEXT_H
+ #define GRAPH_TEXT_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <deque>
+ #include <string>
+ #include <string_view>
+ #include <unordered_map>
+ #include <vector>
+ #include "graph_cmd_encoder.h"
+ #include "graph_ft800.h"
+
+ /**
+  * Glyph metrics of the fonts, so that layout can measure text on the host.
+  * The ROM font table (fonts 16..31) is read once with load(); fonts
+  * installed in RAM_G with CMD_SETFONT are added with set_font(). Widths
+  * ignore OPT_* alignment, which only moves the text.
+  */
+ class GraphFontMetrics
+ {
+ public:
+     static const uint8_t font_count = 32U;
+     static const uint8_t first_rom_font = 16U;
+
+     /** One font metric block as the FT800 stores it (148 bytes, little-endian). */
+     struct font_t
+     {
+         uint8_t widths[128];
+         uint32_t format;
+         uint32_t stride;
+         uint32_t width;     //!< Widest glyph
+         uint32_t height;
+         uint32_t ptr;       //!< Glyph bitmaps
+     };
+
+     GraphFontMetrics();
+
+     bool load(GraphFt800& ft800);
+     bool set_font(uint8_t font, const font_t& metrics);
+     bool has_font(int16_t font) const;
+
+     uint16_t char_width(int16_t font, char c) const;
+     uint16_t width(int16_t font, const char* text) const;
+     uint16_t width(int16_t font, const char* text, size_t length) const;
+     uint16_t height(int16_t font) const;
+
+ private:
+     font_t fonts[font_count];
+     bool present[font_count];
+ };
+
+ /** A string held by GraphTextCache, ready to be copied into RAM_CMD. */
+ class GraphInternedText
+ {
+ public:
+     const char* c_str() const { return chars.c_str(); }
+     uint16_t length() const { return static_cast<uint16_t>(chars.size()); }
+
+     /** The string as CMD_TEXT takes it: NUL-terminated and zero-padded words. */
+     const uint32_t* words() const { return fragment.data() + header_words; }
+     size_t word_count() const { return fragment.size() - header_words; }
+
+ private:
+     friend class GraphTextCache;
+     static const size_t header_words = 3U;   // CMD_TEXT, x|y, font|options
+
+     std::string chars;
+     std::vector<uint32_t> fragment;          // CMD_TEXT of the last placement
+     bool placed;
+ };
+
+ /**
+  * Label text for CMD_TEXT without per-frame string work. Strings are
+  * interned once, already NUL-terminated and zero-padded to the 4-byte
+  * words RAM_CMD takes, so later uses copy whole words instead of packing
+  * bytes. Each interned string also keeps the complete CMD_TEXT fragment
+  * of its last (x, y, font, options), so a label that stays put is one
+  * block copy and one moved elsewhere only rewrites the two header words.
+  * Keep the intern() pointer for labels drawn every frame: the const char*
+  * overload hashes the string on each call, which costs more than packing
+  * a short label would.
+  *
+  * Interned strings live until clear(). The pool is bounded: once it holds
+  * max_interned strings, text() with a new string encodes it directly and
+  * counts it as uncached, so readouts that change every frame cannot grow
+  * it without limit; such readouts are better drawn with CMD_NUMBER.
+  *
+  *     GraphTextCache labels;
+  *     GraphInternedText* title = labels.intern("Measurement");
+  *     labels.text(encoder, 240, 12, 28, OPT_CENTERX, title);
+  *     uint16_t w = GraphTextCache::width(metrics, 28, title);
+  */
+ class GraphTextCache
+ {
+ public:
+     static const size_t default_max_interned = 1024U;
+
+     struct stats_t
+     {
+         uint32_t hits;          //!< Fragment copied as cached
+         uint32_t misses;        //!< Fragment header rewritten for a new placement
+         uint32_t uncached;      //!< Pool full: encoded without interning
+         uint32_t interned;      //!< Strings in the pool
+     };
+
+     explicit GraphTextCache(size_t max_interned = default_max_interned);
+     ~GraphTextCache();
+
+     GraphInternedText* intern(const char* text);
+     void clear();
+
+     void text(GraphCmdEncoder& out, int16_t x, int16_t y, int16_t font, uint16_t options, const char* text);
+     void text(GraphCmdEncoder& out, int16_t x, int16_t y, int16_t font, uint16_t options, GraphInternedText* text);
+
+     static uint16_t width(const GraphFontMetrics& metrics, int16_t font, const GraphInternedText* text);
+
+     const stats_t& get_stats() const { return stats; }
+
+ private:
+     size_t max_interned;
+     std::deque<GraphInternedText> pool;                             // stable addresses
+     std::unordered_map<std::string_view, GraphInternedText*> index;  // views into pool
+     stats_t stats;
+ };
+
+ #endif // GRAPH_TEXT_H
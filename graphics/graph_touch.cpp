@@ -78,6 +78,39 @@
      return result;
  }
  
+ uint8_t Touch_buttons::handle_event(const GraphTouchInput::event_t& event)
+ {
+     uint8_t result = no_tag;
+     bool is_button = (event.tag != no_tag && event.tag != untagged_icon_tag);
+ 
+     // The touch engine has already settled the tag, so no debounce pass.
+     if (event.kind == GraphTouchInput::event_kind_t::PRESS)
+     {
+         if (is_button && button_state != DISCARD_BUTTON)
+         {
+             result = event.tag;
+             button_state = BUTTON_DETECTED;
+         }
+         last_touch_tag = event.tag;
+     }
+     else
+     {
+         bool lifted = (event.x == 0x8000U);
+         if (button_state == BUTTON_DETECTED && last_touch_tag == event.tag)
+         {
+             result = button_released_tag;
+             button_state = NO_BUTTON;
+         }
+         else if (button_state != DISCARD_BUTTON || lifted)
+         {
+             // A discarded button stays discarded until the finger lifts.
+             button_state = NO_BUTTON;
+         }
+         last_touch_tag = no_tag;
+     }
+     return result;
+ }
+ 
  bool Touch_buttons::button_pressed(uint8_t tag)
  {
      return (button_state == BUTTON_DETECTED && last_touch_tag == tag);
@@ -8,6 +8,7 @@
  #define GRAPH_TOUCH_BUTTONS_H
  
  #include "graph_ft800.h"
+ #include "graph_touch_input.h"
  #include <cstddef>
  
  /*!
@@ -49,6 +50,13 @@
       */
      uint8_t poll_touch_buttons();
  
+     /*!
+      * Brief Apply one event from GraphTouchInput instead of polling
+      * \param event Press or release reported by the touch interrupt
+      * \return Same values as poll_touch_buttons()
+      */
+     uint8_t handle_event(const GraphTouchInput::event_t& event);
+ 
      /*!
       * Brief Check if a specific tag is currently pressed
       * \param tag Tag value to query
@@ -0,0 +1,246 @@
+/**
+ * @file graph_touch_input.cpp
+ * @brief Interrupt-driven touch input delivering timestamped press/release events.
+ */
+
+ #include <chrono>
+ #include <cstring>
+ #include <ctime>
+ #include <endian.h>
+ #include <unistd.h>
+ #include "graph_touch_input.h"
+ #include "graph_touch.h"
+ #include "trace.h"
+
+ // REG_TOUCH_SCREEN_XY while nothing touches the panel.
+ static const uint32_t untouched_xy = 0x80008000U;
+
+ static_assert(REG_TOUCH_TAG - REG_TOUCH_RAW_XY == 16U, "touch burst expects five consecutive registers");
+
+ GraphTouchInput::GraphTouchInput(GraphFt800& ft800)
+     : ft800(ft800), use_interrupt(false), active_tag(Touch_buttons::no_tag),
+       thread_id(0), thread_running(false), stop_requested(false),
+       wakeup_count(0U), spurious_count(0U), burst_count(0U), fallback_count(0U),
+       event_count(0U), dropped_count(0U), max_latency(0U)
+ {
+ }
+
+ GraphTouchInput::~GraphTouchInput()
+ {
+     stop();
+ }
+
+ uint64_t GraphTouchInput::now_ns()
+ {
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+ }
+
+ /**
+  * Unmasks INT_TOUCH / INT_TAG and takes the current touch state as the
+  * starting point. Returns false if the interrupt could not be enabled;
+  * process() then polls every fallback_poll_ms instead.
+  */
+ bool GraphTouchInput::arm()
+ {
+     bool result = ft800.unmask_interrupts(touch_interrupts);
+     if (result)
+     {
+         (void)ft800.take_interrupts(touch_interrupts);   // drop stale flags
+     }
+     use_interrupt.store(result, std::memory_order_relaxed);
+     (void)read_sample(now_ns());
+     return result;
+ }
+
+ /** Arms the interrupt and starts the input thread. */
+ bool GraphTouchInput::start()
+ {
+     if (thread_running.load(std::memory_order_acquire))
+     {
+         return true;
+     }
+     (void)arm();
+     stop_requested.store(false, std::memory_order_release);
+     thread_running.store(true, std::memory_order_release);
+
+     if (pthread_create(&thread_id, nullptr, entry_routine, this) != 0)
+     {
+         thread_running.store(false, std::memory_order_release);
+         return false;
+     }
+     return true;
+ }
+
+ /** Stops the input thread (within one wait_slice_ms) and joins it. */
+ void GraphTouchInput::stop()
+ {
+     if (thread_running.load(std::memory_order_acquire))
+     {
+         stop_requested.store(true, std::memory_order_release);
+         (void)pthread_join(thread_id, nullptr);
+         thread_running.store(false, std::memory_order_release);
+     }
+ }
+
+ void* GraphTouchInput::entry_routine(void* arg)
+ {
+     if (arg != nullptr)
+     {
+         static_cast<GraphTouchInput*>(arg)->main_loop();
+     }
+     return nullptr;
+ }
+
+ void GraphTouchInput::main_loop()
+ {
+     while (!stop_requested.load(std::memory_order_acquire))
+     {
+         (void)process(wait_slice_ms);
+     }
+ }
+
+ /**
+  * One step of the input loop, for callers that run it on their own
+  * thread: waits up to @p timeout_ms for a touch interrupt and queues the
+  * resulting events. Returns false if the device could not be read.
+  */
+ bool GraphTouchInput::process(int timeout_ms)
+ {
+     if (!use_interrupt.load(std::memory_order_relaxed))
+     {
+         uint32_t sleep_ms = (timeout_ms >= 0 && static_cast<uint32_t>(timeout_ms) < fallback_poll_ms)
+                                 ? static_cast<uint32_t>(timeout_ms) : fallback_poll_ms;
+         (void)usleep(sleep_ms * 1000U);
+         fallback_count.fetch_add(1U, std::memory_order_relaxed);
+         return read_sample(now_ns());
+     }
+
+     int status = ft800.wait_event(timeout_ms);
+     uint64_t seen_ns = now_ns();
+     if (status < 0)
+     {
+         // The driver cannot poll: read the registers periodically instead.
+         use_interrupt.store(false, std::memory_order_relaxed);
+         return false;
+     }
+     // On a timeout, another waiter may still have latched our flags while
+     // reading REG_INT_FLAGS for its own; that costs no SPI to check.
+     if (status == 0 && !ft800.interrupts_latched(touch_interrupts))
+     {
+         return true;
+     }
+
+     graph_result_t<uint8_t> flags = ft800.take_interrupts(touch_interrupts);
+     if (!flags.ok())
+     {
+         return false;
+     }
+     if (flags.value == 0U)
+     {
+         spurious_count.fetch_add(1U, std::memory_order_relaxed);
+         return true;
+     }
+     wakeup_count.fetch_add(1U, std::memory_order_relaxed);
+     return read_sample(seen_ns);
+ }
+
+ /**
+  * Reads REG_TOUCH_RAW_XY, RZ, SCREEN_XY, TAG_XY and TAG in one transfer and
+  * queues the events implied by the change of tag.
+  */
+ bool GraphTouchInput::read_sample(uint64_t timestamp_ns)
+ {
+     uint32_t raw[5];
+     if (!ft800.mem_read(REG_TOUCH_RAW_XY, raw, sizeof(raw)))
+     {
+         return false;
+     }
+     burst_count.fetch_add(1U, std::memory_order_relaxed);
+
+     sample_t sample;
+     sample.raw_xy = le32toh(raw[0]);
+     sample.rz = le32toh(raw[1]);
+     sample.screen_xy = le32toh(raw[2]);
+     sample.tag_xy = le32toh(raw[3]);
+     sample.tag = le32toh(raw[4]);
+
+     uint8_t tag = (sample.screen_xy == untouched_xy) ? Touch_buttons::no_tag : static_cast<uint8_t>(sample.tag);
+     if (tag != active_tag)
+     {
+         if (active_tag != Touch_buttons::no_tag)
+         {
+             emit(event_kind_t::RELEASE, active_tag, sample, timestamp_ns);
+         }
+         if (tag != Touch_buttons::no_tag)
+         {
+             emit(event_kind_t::PRESS, tag, sample, timestamp_ns);
+         }
+         active_tag = tag;
+     }
+     return true;
+ }
+
+ void GraphTouchInput::emit(event_kind_t kind, uint8_t tag, const sample_t& sample, uint64_t timestamp_ns)
+ {
+     event_t event;
+     event.kind = kind;
+     event.tag = tag;
+     event.x = static_cast<uint16_t>(sample.screen_xy >> 16);
+     event.y = static_cast<uint16_t>(sample.screen_xy);
+     event.raw_x = static_cast<uint16_t>(sample.raw_xy >> 16);
+     event.raw_y = static_cast<uint16_t>(sample.raw_xy);
+     event.timestamp_ns = timestamp_ns;
+
+     if (!queue.push(event))
+     {
+         dropped_count.fetch_add(1U, std::memory_order_relaxed);
+         return;
+     }
+     {
+         // Taking the lock orders the push before a waiter's re-check.
+         std::lock_guard<std::mutex> guard(event_lock);
+     }
+     event_ready.notify_one();
+
+     uint64_t queued_ns = now_ns();
+     uint64_t latency = queued_ns - timestamp_ns;
+     if (latency > max_latency.load(std::memory_order_relaxed))
+     {
+         max_latency.store(latency, std::memory_order_relaxed);
+     }
+     event_count.fetch_add(1U, std::memory_order_relaxed);
+     TRACE_EVENT(trace_category_t::TOUCH, (kind == event_kind_t::PRESS) ? "touch_press" : "touch_release",
+                 tag, 0U, 0, timestamp_ns, queued_ns);
+ }
+
+ /** Takes the oldest queued event without blocking. Single consumer. */
+ bool GraphTouchInput::pop(event_t& event)
+ {
+     return queue.pop(event);
+ }
+
+ /** Takes the oldest event, waiting up to @p timeout_ms for one. Single consumer. */
+ bool GraphTouchInput::wait_for_event(event_t& event, int timeout_ms)
+ {
+     if (queue.pop(event))
+     {
+         return true;
+     }
+     std::unique_lock<std::mutex> guard(event_lock);
+     return event_ready.wait_for(guard, std::chrono::milliseconds(timeout_ms), [&]() { return queue.pop(event); });
+ }
+
+ GraphTouchInput::stats_t GraphTouchInput::get_stats() const
+ {
+     stats_t stats;
+     stats.wakeups = wakeup_count.load(std::memory_order_relaxed);
+     stats.spurious = spurious_count.load(std::memory_order_relaxed);
+     stats.burst_reads = burst_count.load(std::memory_order_relaxed);
+     stats.fallback_reads = fallback_count.load(std::memory_order_relaxed);
+     stats.events = event_count.load(std::memory_order_relaxed);
+     stats.dropped = dropped_count.load(std::memory_order_relaxed);
+     stats.max_latency_ns = max_latency.load(std::memory_order_relaxed);
+     return stats;
+ }
@@ -0,0 +1,134 @@
+/**
+ * @file graph_touch_input.h
+ * @brief Interrupt-driven touch input delivering timestamped press/release events.
+ */
+
+ #ifndef GRAPH_TOUCH_INPUT_H
+ #define GRAPH_TOUCH_INPUT_H
+
+ #include <atomic>
+ #include <condition_variable>
+ #include <cstdint>
+ #include <mutex>
+ #include <pthread.h>
+ #include "graph_ft800.h"
+ #include "graph_ft800Reg.h"
+ #include "graph_mpsc_queue.h"
+
+ /**
+  * Replaces polling REG_TOUCH_TAG at a fixed rate. The FT800 touch and tag
+  * interrupts (INT_TOUCH / INT_TAG) are unmasked and the input thread
+  * sleeps in poll() on the device; only when the touch engine reports a
+  * change does it read REG_TOUCH_RAW_XY .. REG_TOUCH_TAG in one burst and
+  * turn the tag transition into events. An idle panel costs no SPI traffic.
+  *
+  * A press is reported when the tag under the finger changes to a non-zero
+  * value and a release when it changes away from it, so sliding from one
+  * button to the next gives RELEASE(old), PRESS(new). Untagged areas
+  * report Touch_buttons::untagged_icon_tag like the tag register does.
+  *
+  * Where the driver cannot poll, the thread falls back to reading the
+  * burst every fallback_poll_ms.
+  *
+  * The thread shares the GraphFt800 with the render thread but only uses
+  * the calls GraphFt800 documents as safe from a second thread: mem_read(),
+  * wait_event() and the interrupt mask and flags.
+  *
+  *     GraphTouchInput input(ft800);
+  *     input.start();
+  *     GraphTouchInput::event_t event;
+  *     while (input.wait_for_event(event, 100))
+  *     {
+  *         buttons.handle_event(event);
+  *     }
+  */
+ class GraphTouchInput
+ {
+ public:
+     static const size_t queue_length = 64U;
+     static const int wait_slice_ms = 100;          //!< Bounds stop() and a wakeup taken by another waiter
+     static const uint32_t fallback_poll_ms = 20U;
+     static const uint8_t touch_interrupts = INT_TOUCH | INT_TAG;
+
+     enum class event_kind_t : uint8_t
+     {
+         PRESS = 0,
+         RELEASE
+     };
+
+     struct event_t
+     {
+         event_kind_t kind;
+         uint8_t tag;              //!< Tag pressed or released
+         uint16_t x;               //!< REG_TOUCH_SCREEN_XY at the event (0x8000 when lifted)
+         uint16_t y;
+         uint16_t raw_x;           //!< REG_TOUCH_RAW_XY (0xFFFF when lifted)
+         uint16_t raw_y;
+         uint64_t timestamp_ns;    //!< CLOCK_MONOTONIC when the interrupt was seen
+     };
+
+     struct stats_t
+     {
+         uint32_t wakeups;          //!< Interrupts carrying touch flags
+         uint32_t spurious;         //!< poll() wakeups for other interrupt sources
+         uint32_t burst_reads;
+         uint32_t fallback_reads;   //!< Burst reads made without an interrupt
+         uint32_t events;
+         uint32_t dropped;          //!< Queue full
+         uint64_t max_latency_ns;   //!< Interrupt seen to event queued
+     };
+
+     explicit GraphTouchInput(GraphFt800& ft800);
+     ~GraphTouchInput();
+
+     bool start();
+     void stop();
+     bool is_running() const { return thread_running.load(std::memory_order_acquire); }
+     bool interrupt_driven() const { return use_interrupt.load(std::memory_order_relaxed); }
+
+     bool arm();
+     bool process(int timeout_ms);
+
+     bool pop(event_t& event);
+     bool wait_for_event(event_t& event, int timeout_ms);
+
+     stats_t get_stats() const;
+
+ private:
+     struct sample_t
+     {
+         uint32_t raw_xy;
+         uint32_t rz;
+         uint32_t screen_xy;
+         uint32_t tag_xy;
+         uint32_t tag;
+     };
+
+     static void* entry_routine(void* arg);
+     static uint64_t now_ns();
+     void main_loop();
+     bool read_sample(uint64_t timestamp_ns);
+     void emit(event_kind_t kind, uint8_t tag, const sample_t& sample, uint64_t timestamp_ns);
+
+     GraphFt800& ft800;
+     GraphMpscQueue<event_t, queue_length> queue;
+     std::atomic<bool> use_interrupt;
+     uint8_t active_tag;
+
+     std::mutex event_lock;
+     std::condition_variable event_ready;
+
+     pthread_t thread_id;
+     std::atomic<bool> thread_running;
+     std::atomic<bool> stop_requested;
+
+     std::atomic<uint32_t> wakeup_count;
+     std::atomic<uint32_t> spurious_count;
+     std::atomic<uint32_t> burst_count;
+     std::atomic<uint32_t> fallback_count;
+     std::atomic<uint32_t> event_count;
+     std::atomic<uint32_t> dropped_count;
+     std::atomic<uint64_t> max_latency;
+ };
+
+ #endif // GRAPH_TOUCH_INPUT_H
@@ -0,0 +1,61 @@
+/**
+ * @file graph_transport.cpp
+ * @brief Kernel driver transport for GraphFt800.
+ */
+
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <poll.h>
+ #include <unistd.h>
+ #include <sys/ioctl.h>
+ #include <sys/mman.h>
+ #include "graph_transport.h"
+
+ GraphDeviceTransport::GraphDeviceTransport(const char* device_path)
+     : fd(-1)
+ {
+     if (device_path != nullptr)
+     {
+         fd = open(device_path, O_RDWR | O_CLOEXEC);
+     }
+ }
+
+ GraphDeviceTransport::~GraphDeviceTransport()
+ {
+     if (fd >= 0)
+     {
+         (void)close(fd);
+     }
+ }
+
+ int GraphDeviceTransport::ioctl(unsigned long request, void* arg)
+ {
+     return ::ioctl(fd, request, arg);
+ }
+
+ void* GraphDeviceTransport::mmap(size_t bytes)
+ {
+     void* area = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+     return (area == MAP_FAILED) ? nullptr : area;
+ }
+
+ void GraphDeviceTransport::munmap(void* area, size_t bytes)
+ {
+     (void)::munmap(area, bytes);
+ }
+
+ int GraphDeviceTransport::poll(short events, int timeout_ms, short* revents)
+ {
+     struct pollfd pfd = { fd, events, 0 };
+     int status = ::poll(&pfd, 1, timeout_ms);
+     if (revents != nullptr)
+     {
+         *revents = pfd.revents;
+     }
+     return status;
+ }
+
+ ssize_t GraphDeviceTransport::pread(void* buffer, size_t len, off_t addr)
+ {
+     return ::pread(fd, buffer, len, addr);
+ }
@@ -0,0 +1,51 @@
+/**
+ * @file graph_transport.h
+ * @brief Device access seam between GraphFt800 and the FT800 driver.
+ */
+
+ #ifndef GRAPH_TRANSPORT_H
+ #define GRAPH_TRANSPORT_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <sys/types.h>
+
+ /**
+  * Everything GraphFt800 does to the device goes through one of these
+  * calls. GraphDeviceTransport forwards them to the /dev/ft800 node;
+  * GraphFt800Sim answers them from a software model, so the same library
+  * code runs without the panel. Return values follow the system calls they
+  * stand in for (-1 and errno on failure).
+  */
+ class GraphTransport
+ {
+ public:
+     virtual ~GraphTransport() {}
+
+     virtual bool is_open() const = 0;
+     virtual int ioctl(unsigned long request, void* arg) = 0;
+     virtual void* mmap(size_t bytes) = 0;             //!< nullptr on failure
+     virtual void munmap(void* area, size_t bytes) = 0;
+     virtual int poll(short events, int timeout_ms, short* revents) = 0;
+     virtual ssize_t pread(void* buffer, size_t len, off_t addr) = 0;
+ };
+
+ /** Transport backed by the kernel driver's character device. */
+ class GraphDeviceTransport : public GraphTransport
+ {
+ public:
+     explicit GraphDeviceTransport(const char* device_path);
+     ~GraphDeviceTransport();
+
+     bool is_open() const override { return fd >= 0; }
+     int ioctl(unsigned long request, void* arg) override;
+     void* mmap(size_t bytes) override;
+     void munmap(void* area, size_t bytes) override;
+     int poll(short events, int timeout_ms, short* revents) override;
+     ssize_t pread(void* buffer, size_t len, off_t addr) override;
+
+ private:
+     int fd;
+ };
+
+ #endif // GRAPH_TRANSPORT_H
@@ -0,0 +1,173 @@
+/**
+ * @file graph_wait.cpp
+ * @brief Adaptive co-processor completion wait.
+ */
+
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstring>
+ #include "graph_wait.h"
+ #include "graph_ft800Reg.h"
+ #include "trace.h"
+
+ static const uint16_t fault_pointer = 0x0FFFU;
+ static const uint64_t interrupt_slice_ms = 10U;
+
+ const GraphWait::policy_t GraphWait::default_policy = { 32U, 50U, 2000U, 250U };
+
+ GraphWait::GraphWait(GraphFt800& ft800)
+     : ft800(ft800), policy(default_policy), use_interrupt(false),
+       spurious_wakeups(0U), trace_label("wait"), polls(0U), backoff_us(0U)
+ {
+     reset_stats();
+     (void)memset(&start_time, 0, sizeof(start_time));
+ }
+
+ GraphWait::~GraphWait() {}
+
+ /** Clears the accumulated wait statistics. */
+ void GraphWait::reset_stats()
+ {
+     (void)memset(&stats, 0, sizeof(stats));
+ }
+
+ /** Unmasks INT_CMDEMPTY / INT_CMDFLAG so waits can block in poll(). */
+ bool GraphWait::enable_interrupt()
+ {
+     bool result = ft800.unmask_interrupts(INT_CMDEMPTY | INT_CMDFLAG);
+     if (result)
+     {
+         (void)ft800.take_interrupts(INT_CMDEMPTY | INT_CMDFLAG);   // drop stale flags
+         spurious_wakeups = 0U;
+     }
+     use_interrupt = result;
+     return result;
+ }
+
+ /** Returns to pure user-space polling. */
+ void GraphWait::disable_interrupt()
+ {
+     use_interrupt = false;
+ }
+
+ /** Nanoseconds since start(). */
+ uint64_t GraphWait::elapsed_ns() const
+ {
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec - start_time.tv_sec) * 1000000000ULL +
+            static_cast<uint64_t>(now.tv_nsec) - static_cast<uint64_t>(start_time.tv_nsec);
+ }
+
+ /** Opens a wait session; @p trace_name labels it in the trace. */
+ void GraphWait::start(const char* trace_name)
+ {
+     trace_label = trace_name;
+     (void)clock_gettime(CLOCK_MONOTONIC, &start_time);
+     polls = 0U;
+     backoff_us = policy.initial_backoff_us;
+ }
+
+ /**
+  * Yields between two polls of the caller's condition.
+  * Returns false once the session has exceeded the policy timeout.
+  */
+ bool GraphWait::pause()
+ {
+     uint64_t waited_ns = elapsed_ns();
+     uint64_t limit_ns = static_cast<uint64_t>(policy.timeout_ms) * 1000000ULL;
+
+     if (waited_ns >= limit_ns)
+     {
+         return false;
+     }
+
+     polls++;
+     if (polls <= policy.spin_polls)
+     {
+         return true;
+     }
+
+     if (use_interrupt)
+     {
+         // Sleep in slices so a wakeup lost between the caller's check and
+         // poll() costs at most one slice.
+         uint64_t remaining_ms = (limit_ns - waited_ns + 999999ULL) / 1000000ULL;
+         int slice_ms = static_cast<int>((remaining_ms < interrupt_slice_ms) ? remaining_ms : interrupt_slice_ms);
+         int status = ft800.wait_event(slice_ms);
+
+         if (status > 0 && ft800.take_interrupts(INT_CMDEMPTY | INT_CMDFLAG).value_or(0U) != 0U)
+         {
+             stats.interrupt_wakeups++;
+             spurious_wakeups = 0U;
+             return true;
+         }
+         // No poll support, or a wakeup that was not ours: after a few of
+         // those stop trusting the driver and fall back to backoff polling.
+         if (status == 0)
+         {
+             return true;
+         }
+         if (status < 0 || ++spurious_wakeups >= max_spurious_wakeups)
+         {
+             use_interrupt = false;
+         }
+     }
+
+     (void)usleep(backoff_us);
+     backoff_us = (backoff_us * 2U > policy.max_backoff_us) ? policy.max_backoff_us : backoff_us * 2U;
+     return true;
+ }
+
+ /** Closes a wait session and records how long it took. */
+ void GraphWait::finish(bool completed)
+ {
+     uint64_t waited_ns = elapsed_ns();
+
+     stats.waits++;
+     stats.last_wait_ns = waited_ns;
+     stats.total_wait_ns += waited_ns;
+     if (waited_ns > stats.max_wait_ns)
+     {
+         stats.max_wait_ns = waited_ns;
+     }
+     if (!completed)
+     {
+         stats.timeouts++;
+     }
+
+     // One event per session; the id is the number of polls it took.
+     uint64_t start_ns = static_cast<uint64_t>(start_time.tv_sec) * 1000000000ULL + static_cast<uint64_t>(start_time.tv_nsec);
+     TRACE_EVENT(trace_category_t::FIFO, trace_label, polls, 0U, completed ? 0 : -ETIMEDOUT, start_ns, start_ns + waited_ns);
+ }
+
+ /** Waits until REG_CMD_READ catches up with REG_CMD_WRITE. */
+ GraphWait::wait_result_t GraphWait::wait_idle()
+ {
+     wait_result_t result = wait_result_t::WAIT_TIMEOUT;
+     uint16_t rd = 0U;
+     uint16_t wr = 0U;
+
+     start("wait_idle");
+     do
+     {
+         if (!ft800.get_cmd_status(&rd, &wr))
+         {
+             result = wait_result_t::WAIT_ERROR;
+             break;
+         }
+         if (rd == fault_pointer)
+         {
+             result = wait_result_t::WAIT_FAULT;
+             break;
+         }
+         if (rd == wr)
+         {
+             result = wait_result_t::WAIT_DONE;
+             break;
+         }
+     } while (pause());
+     finish(result == wait_result_t::WAIT_DONE);
+
+     return result;
+ }
@@ -0,0 +1,92 @@
+/**
+ * @file graph_wait.h
+ * @brief Adaptive co-processor completion wait with wait-time accounting.
+ */
+
+ #ifndef GRAPH_WAIT_H
+ #define GRAPH_WAIT_H
+
+ #include <cstdint>
+ #include <ctime>
+ #include "graph_ft800.h"
+
+ /**
+  * Replaces fixed 1 ms usleep polling: the first polls spin, later ones back
+  * off exponentially, and when enabled the waiter sleeps in poll() on the
+  * device until the FT800 raises INT_CMDEMPTY / INT_CMDFLAG. If the driver
+  * cannot deliver interrupts the waiter falls back to backoff polling.
+  *
+  *     waiter.start();
+  *     while (!condition())
+  *     {
+  *         if (!waiter.pause()) break;   // timed out
+  *     }
+  *     waiter.finish(condition());
+  */
+ class GraphWait
+ {
+ public:
+     struct policy_t
+     {
+         uint32_t spin_polls;          //!< Polls without sleeping
+         uint32_t initial_backoff_us;  //!< First sleep after spinning
+         uint32_t max_backoff_us;      //!< Backoff ceiling
+         uint32_t timeout_ms;          //!< Overall limit per wait
+     };
+
+     enum class wait_result_t : uint8_t
+     {
+         WAIT_DONE = 0,
+         WAIT_TIMEOUT,
+         WAIT_FAULT,
+         WAIT_ERROR
+     };
+
+     struct stats_t
+     {
+         uint32_t waits;              //!< Completed wait sessions
+         uint32_t timeouts;           //!< Sessions that gave up
+         uint32_t interrupt_wakeups;  //!< Wakeups delivered by the driver
+         uint64_t total_wait_ns;      //!< Time spent waiting, all sessions
+         uint64_t max_wait_ns;        //!< Longest single wait
+         uint64_t last_wait_ns;       //!< Most recent wait
+     };
+
+     static const policy_t default_policy;
+
+     explicit GraphWait(GraphFt800& ft800);
+     ~GraphWait();
+
+     void set_policy(const policy_t& new_policy) { policy = new_policy; }
+     const policy_t& get_policy() const { return policy; }
+
+     bool enable_interrupt();
+     void disable_interrupt();
+     bool interrupt_enabled() const { return use_interrupt; }
+
+     void start(const char* trace_name = "wait");
+     bool pause();
+     void finish(bool completed);
+
+     wait_result_t wait_idle();
+
+     const stats_t& get_stats() const { return stats; }
+     void reset_stats();
+
+ private:
+     static const uint32_t max_spurious_wakeups = 8U;
+
+     uint64_t elapsed_ns() const;
+
+     GraphFt800& ft800;
+     policy_t policy;
+     stats_t stats;
+     bool use_interrupt;
+     uint32_t spurious_wakeups;
+     struct timespec start_time;
+     const char* trace_label;
+     uint32_t polls;
+     uint32_t backoff_us;
+ };
+
+ #endif // GRAPH_WAIT_H
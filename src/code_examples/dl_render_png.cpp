@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * Offline display-list renderer / golden-image check
+ *
+ *   Builds a representative screen (clear, status bar, gauge-style points
+ *   and lines, two icons uploaded with CMD_INFLATE and a title button) on
+ *   GraphFt800Sim, rasterizes the swapped RAM_DL with GraphRasterizer and
+ *   writes it as PNG or PPM. Alternatively --dl renders a raw RAM_DL dump
+ *   taken on hardware (little-endian words, e.g. FT800_IOCTL_MEMREAD of
+ *   RAM_DL up to REG_CMD_DL).
+ *
+ *   Prints the DL size against the 8 KB RAM_DL budget and the fill cost.
+ *   With a golden PPM it exits non-zero when more than 0.1 % of the pixels
+ *   differ by more than the tolerance, or when the list is over budget.
+ *
+ * Build native (zlib for PNG output and CMD_INFLATE in the simulator):
+ *   g++ -std=c++17 -Wall -O2 -DGRAPH_HAVE_ZLIB -I../../graphics -I../../trace -I.. dl_render_png.cpp \
+ *       ../../graphics/graph_ft800.cpp ../../graphics/graph_status.cpp ../../graphics/graph_transport.cpp \
+ *       ../../graphics/graph_ft800_sim.cpp ../../graphics/graph_cmd_encoder.cpp \
+ *       ../../graphics/graph_cmd_buffer.cpp ../../graphics/graph_cmd_fifo.cpp \
+ *       ../../graphics/graph_wait.cpp ../../graphics/graph_ram_g.cpp \
+ *       ../../graphics/graph_bitmap_cache.cpp ../../graphics/graph_rasterizer.cpp \
+ *       ../../graphics/graph_dl_budget.cpp ../../graphics/graph_cmd_batch.cpp \
+ *       -lz -o ft800_dl_render
+ * Run:
+ *   ./ft800_dl_render out.png|out.ppm [golden.ppm [tolerance]]
+ *   ./ft800_dl_render --dl ramdl.bin out.png|out.ppm [golden.ppm [tolerance]]
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "graph_ft800.h"
+#include "graph_ft800_sim.h"
+#include "graph_cmd_buffer.h"
+#include "graph_ram_g.h"
+#include "graph_bitmap_cache.h"
+#include "graph_rasterizer.h"
+#include "graph_ft800Cmds.h"
+#include "graph_battery_icon.h"
+#include "graph_memory_icon.h"
+
+#define RAM_G_BYTES         (256U * 1024U)
+#define DEFAULT_TOLERANCE   8U
+
+static bool ends_with(const char *s, const char *suffix)
+{
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static bool load_dump(const char *path, std::vector<uint32_t> &words)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    uint8_t raw[4];
+    while (fread(raw, 1, sizeof(raw), f) == sizeof(raw))
+        words.push_back(raw[0] | (raw[1] << 8) | (raw[2] << 16) | (static_cast<uint32_t>(raw[3]) << 24));
+    fclose(f);
+    return !words.empty();
+}
+
+static void encode_screen(GraphCmdEncoder &enc, const Device_definitions::bitmap_info_t *icons[2])
+{
+    enc.clear_color_rgb(0, 0, 40);
+    enc.clear(true, true, true);
+
+    /* status bar */
+    enc.color_rgb(30, 60, 120);
+    enc.line_width(16);
+    enc.begin(PRIM_RECTS);
+    enc.vertex2ii(0, 0, 0, 0);
+    enc.vertex2ii(479, 28, 0, 0);
+    enc.end();
+
+    /* rounded panel, half transparent */
+    enc.color_rgb(255, 255, 255);
+    enc.color_a(96);
+    enc.line_width(10 * 16);
+    enc.begin(PRIM_RECTS);
+    enc.vertex2f(40 * 16, 60 * 16);
+    enc.vertex2f(440 * 16, 240 * 16);
+    enc.end();
+    enc.color_a(255);
+
+    /* dial ticks and a needle */
+    enc.color_rgb(255, 200, 0);
+    enc.point_size(5 * 16);
+    enc.begin(PRIM_POINTS);
+    for (int i = 0; i < 9; ++i)
+        enc.vertex2f(static_cast<int16_t>((120 + i * 30) * 16), static_cast<int16_t>(200 * 16));
+    enc.end();
+    enc.color_rgb(255, 64, 64);
+    enc.line_width(3 * 16);
+    enc.begin(PRIM_LINES);
+    enc.vertex2f(240 * 16, 200 * 16);
+    enc.vertex2f(300 * 16, 110 * 16);
+    enc.end();
+
+    /* icons in the status bar */
+    enc.color_rgb(255, 255, 255);
+    for (int i = 0; i < 2; ++i) {
+        if (!icons[i])
+            continue;
+        enc.bitmap_handle(icons[i]->handle);
+        enc.bitmap_source(icons[i]->ram_g_offset);
+        enc.bitmap_layout(icons[i]->format, icons[i]->stride, icons[i]->height);
+        enc.bitmap_size(icons[i]->filter, icons[i]->wrap_x, icons[i]->wrap_y, icons[i]->width, icons[i]->height);
+        enc.begin_bitmap(icons[i]->handle);
+        enc.vertex2ii(static_cast<uint16_t>(440 + i * 18), 4, icons[i]->handle, 0);
+        enc.end();
+    }
+
+    /* co-processor widget: occupies RAM_DL but is not rasterized */
+    enc.cmd_button(160, 80, 160, 40, 28, 0, "Measure");
+}
+
+static bool render_on_sim(std::vector<uint32_t> &dl, std::vector<uint8_t> &ram_g)
+{
+    GraphFt800Sim sim;
+    GraphFt800Sim::spi_model_t model = GraphFt800Sim::default_spi_model;
+    model.realtime = false;
+    sim.set_spi_model(model);
+
+    GraphFt800 ft800(sim);
+    GraphRamG allocator;
+    GraphBitmapCache cache(ft800, allocator);
+    GraphCmdBuffer buf(ft800);
+
+    cache.begin_frame();
+    const Device_definitions::bitmap_info_t *icons[2] = {
+        cache.acquire(Memory_icons::memory_icon),
+        cache.acquire(Battery_icons::three_quarters_icon),
+    };
+
+    buf.begin_frame();
+    encode_screen(buf, icons);
+    if (!buf.end_frame()) {
+        fprintf(stderr, "frame submission failed\n");
+        return false;
+    }
+
+    dl = sim.displayed_list();
+    ram_g.resize(RAM_G_BYTES);
+    sim.peek(0, ram_g.data(), ram_g.size());
+    return !dl.empty();
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> dl;
+    std::vector<uint8_t> ram_g;
+    int arg = 1;
+
+    if (argc > 2 && strcmp(argv[1], "--dl") == 0) {
+        if (!load_dump(argv[2], dl)) {
+            perror(argv[2]);
+            return EXIT_FAILURE;
+        }
+        arg = 3;
+    } else if (!render_on_sim(dl, ram_g)) {
+        return EXIT_FAILURE;
+    }
+    if (argc <= arg) {
+        fprintf(stderr, "usage: %s [--dl ramdl.bin] out.png|out.ppm [golden.ppm [tolerance]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *out_path = argv[arg];
+    const char *golden = (argc > arg + 1) ? argv[arg + 1] : nullptr;
+    unsigned tolerance = (argc > arg + 2) ? static_cast<unsigned>(strtoul(argv[arg + 2], nullptr, 0)) : DEFAULT_TOLERANCE;
+
+    GraphRasterizer raster;
+    raster.set_ram_g(ram_g.data(), ram_g.size());
+    GraphRasterizer::stats_t st = raster.render(dl.data(), dl.size());
+
+    printf("DL          %u words  %u / %u bytes%s%s\n", st.dl_words, st.dl_bytes, GraphRasterizer::dl_budget_bytes,
+           st.over_budget ? "  OVER BUDGET" : "", st.terminated ? "" : "  (no DISPLAY)");
+    printf("primitives  %u  vertices %u  unsupported words %u\n", st.primitives, st.vertices, st.unsupported_words);
+    printf("fill        %llu px cleared  %llu px drawn  (%.2f x screen)\n",
+           static_cast<unsigned long long>(st.pixels_cleared), static_cast<unsigned long long>(st.pixels_filled),
+           static_cast<double>(st.pixels_filled) / (raster.get_width() * raster.get_height()));
+
+    bool written = ends_with(out_path, ".ppm") ? raster.write_ppm(out_path) : raster.write_png(out_path);
+    if (!written) {
+        fprintf(stderr, "could not write %s (PNG needs GRAPH_HAVE_ZLIB)\n", out_path);
+        return EXIT_FAILURE;
+    }
+
+    int status = st.over_budget ? EXIT_FAILURE : EXIT_SUCCESS;
+    if (golden) {
+        uint32_t mismatched = 0;
+        if (!raster.compare_ppm(golden, static_cast<uint8_t>(tolerance), &mismatched)) {
+            fprintf(stderr, "golden %s missing or a different size\n", golden);
+            return EXIT_FAILURE;
+        }
+        uint32_t allowed = (raster.get_width() * raster.get_height()) / 1000U;
+        printf("golden      %u pixels differ (tolerance %u, allowed %u)\n", mismatched, tolerance, allowed);
+        if (mismatched > allowed)
+            status = EXIT_FAILURE;
+    }
+    return status;
+}
@@ -1,6 +1,10 @@
 /* draw_rect_fifo.cpp  –  one rectangle via FT800 command FIFO
  *
- * build : g++ -std=c++17 -Wall -O2 draw_rect_fifo.cpp -o DrawRectFifo
+ *   The frame is built with the constexpr Graph_dl encoders, so cmds[] is
+ *   encoded by the compiler into .rodata and every argument is range checked
+ *   at compile time.
+ *
+ * build : g++ -std=c++17 -Wall -O2 -I../../graphics -I.. fifo-rectangle-demo.cpp -o DrawRectFifo
  * run   : ./DrawRectFifo
  */
 #include <cstdint>
@@ -12,7 +16,8 @@
 #include <endian.h>
 
 #include "ft800_uapi.h"
-#include "ft800_regs.h"
+#include "graph_dl.h"
+#include "graph_ft800Reg.h"
 
 /* wait until CMD FIFO is idle (RD == WR and RD != 0x0FFF) */
 static bool wait_fifo_idle(int fd, unsigned timeout_ms = 250)
@@ -47,23 +52,23 @@ int main()
     }
 
     /* complete command list we want to execute */
-    static const uint32_t cmds[] = {
+    static constexpr uint32_t cmds[] = {
         CMD_DLSTART,
-        CLEAR_COLOR_RGB(0,0,0),  CLEAR(1,1,1),
+        Graph_dl::clear_color_rgb(0,0,0),  Graph_dl::clear(true,true,true),
 
-        COLOR_RGB(0,250,0),
-        BEGIN(FT8_RECTS),
-            VERTEX2F( 80*16,  40*16),
-            VERTEX2F(400*16, 200*16),
-        END(),
+        Graph_dl::color_rgb(0,250,0),
+        Graph_dl::begin(PRIM_RECTS),
+            Graph_dl::vertex2f( 80*16,  40*16),
+            Graph_dl::vertex2f(400*16, 200*16),
+        Graph_dl::end(),
 
-        DISPLAY(),
+        Graph_dl::display(),
         CMD_SWAP
     };
 
     /* package for SUBMIT_CMDS – the driver handles everything */
     ft800_uapi_cmdlist cl {
-        .addr     = FT800_RAM_CMD,
+        .addr     = RAM_CMD,
         .len      = static_cast<__u32>(sizeof(cmds)),
         .user_ptr = reinterpret_cast<__u64>(cmds)
     };
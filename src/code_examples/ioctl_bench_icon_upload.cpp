@@ -0,0 +1,161 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * FT800 icon upload benchmark
+ *
+ *   Uploads every battery and memory icon through GraphBitmapCache in both
+ *   modes and reports the bytes sent over SPI and the time until the image
+ *   is usable in RAM_G:
+ *
+ *     INFLATE  – compressed stream behind CMD_INFLATE, decoded on the co-processor
+ *     CPU      – decoded on the host with zlib, raw pixels written via MEMWRITE
+ *
+ *   Each icon is evicted between runs so every iteration is a real upload,
+ *   and the FIFO is drained before the clock stops.
+ *
+ *   With --sim the benchmark runs against GraphFt800Sim instead of
+ *   /dev/ft800, so it also runs on a build host; the times then come from
+ *   the simulator's SPI and co-processor cost model.
+ *
+ * Build native (zlib is needed for the CPU column):
+ *   g++ -std=c++17 -Wall -O2 -DGRAPH_HAVE_ZLIB -I../../graphics -I../../trace -I.. ioctl_bench_icon_upload.cpp \
+ *       ../../graphics/graph_ft800.cpp ../../graphics/graph_status.cpp ../../graphics/graph_transport.cpp \
+ *       ../../graphics/graph_ft800_sim.cpp ../../graphics/graph_cmd_encoder.cpp \
+ *       ../../graphics/graph_cmd_fifo.cpp ../../graphics/graph_wait.cpp \
+ *       ../../graphics/graph_ram_g.cpp ../../graphics/graph_bitmap_cache.cpp \
+ *       ../../graphics/graph_cmd_batch.cpp ../../graphics/graph_dl_budget.cpp \
+ *       -lz -o ft800_bench_icons
+ * Run:
+ *   ./ft800_bench_icons [--sim] [iterations]
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "graph_ft800.h"
+#include "graph_ft800_sim.h"
+#include "graph_transport.h"
+#include "graph_cmd_fifo.h"
+#include "graph_ram_g.h"
+#include "graph_bitmap_cache.h"
+#include "graph_battery_icon.h"
+#include "graph_memory_icon.h"
+
+#define DEVNODE             "/dev/ft800"
+#define DEFAULT_ITERATIONS  50U
+
+struct icon_entry {
+    const char *name;
+    const Device_definitions::bitmap_info_t *info;
+};
+
+struct upload_result {
+    uint64_t spi_bytes;
+    double seconds;
+    bool ok;
+};
+
+/* ---------- helpers -------------------------------------------------- */
+static upload_result bench_icon(GraphFt800 &ft800, GraphBitmapCache &cache, GraphCmdFifo &fifo,
+                                const Device_definitions::bitmap_info_t &icon,
+                                GraphBitmapCache::upload_mode_t mode, unsigned iterations)
+{
+    upload_result res{ 0, 0.0, true };
+    cache.set_upload_mode(mode);
+
+    uint64_t before = cache.get_stats().bytes_uploaded;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations && res.ok; ++i) {
+        cache.begin_frame();
+        res.ok = (cache.acquire(icon) != nullptr) && fifo.wait_idle();
+        (void)cache.evict(icon);
+    }
+    /* A corrupt stream faults the co-processor; reset it so the next icon still runs. */
+    if (!res.ok && ft800.is_faulted())
+        (void)ft800.recover();
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    res.spi_bytes = (cache.get_stats().bytes_uploaded - before) / (iterations ? iterations : 1U);
+    return res;
+}
+
+static void report(const char *name, size_t raw, const upload_result &inflate,
+                   const upload_result &cpu, unsigned iterations)
+{
+    printf("%-22s %6zu  ", name, raw);
+    if (inflate.ok)
+        printf("%8llu %9.1f  ", static_cast<unsigned long long>(inflate.spi_bytes),
+               inflate.seconds * 1e6 / iterations);
+    else
+        printf("%8s %9s  ", "-", "failed");
+    if (cpu.ok)
+        printf("%8llu %9.1f\n", static_cast<unsigned long long>(cpu.spi_bytes),
+               cpu.seconds * 1e6 / iterations);
+    else
+        printf("%8s %9s\n", "-", "failed");
+}
+/* -------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    bool use_sim = (argc > 1) && strcmp(argv[1], "--sim") == 0;
+    if (use_sim) {
+        --argc;
+        ++argv;
+    }
+    unsigned iterations = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 0)) : DEFAULT_ITERATIONS;
+    if (iterations == 0U)
+        iterations = 1U;
+
+    GraphFt800Sim sim;
+    GraphDeviceTransport device(use_sim ? nullptr : DEVNODE);
+    GraphTransport &dev = use_sim ? static_cast<GraphTransport &>(sim) : device;
+    if (!dev.is_open()) {
+        perror("open " DEVNODE);
+        return EXIT_FAILURE;
+    }
+    GraphFt800 ft800(dev);
+    GraphCmdFifo fifo(ft800);
+    if (!fifo.sync()) {
+        perror("sync " DEVNODE);
+        return EXIT_FAILURE;
+    }
+
+    GraphRamG ram_g;
+    GraphBitmapCache cache(ft800, ram_g);
+    cache.attach_fifo(&fifo);
+
+    static const icon_entry icons[] = {
+        { "battery full",           &Battery_icons::full_icon },
+        { "battery three quarters", &Battery_icons::three_quarters_icon },
+        { "battery quarter",        &Battery_icons::quarter_icon },
+        { "battery low",            &Battery_icons::low_icon },
+        { "memory",                 &Memory_icons::memory_icon },
+        { "memory short",           &Memory_icons::memory_short_icon },
+    };
+
+#ifndef GRAPH_HAVE_ZLIB
+    printf("built without zlib: CPU column also uses CMD_INFLATE\n");
+#endif
+    printf("%-22s %6s  %8s %9s  %8s %9s\n", "icon", "image",
+           "inflate", "us", "cpu", "us");
+    for (const icon_entry &e : icons) {
+        upload_result inflate = bench_icon(ft800, cache, fifo, *e.info,
+                                           GraphBitmapCache::upload_mode_t::COPROCESSOR_INFLATE, iterations);
+        upload_result cpu = bench_icon(ft800, cache, fifo, *e.info,
+                                       GraphBitmapCache::upload_mode_t::CPU_INFLATE, iterations);
+        report(e.name, static_cast<size_t>(e.info->stride) * e.info->height, inflate, cpu, iterations);
+    }
+
+    const GraphBitmapCache::stats_t &st = cache.get_stats();
+    printf("\n%u co-processor inflates, %u host inflates, %u failures\n",
+           st.coprocessor_inflates, st.cpu_inflates, st.failures);
+
+    if (use_sim) {
+        GraphFt800Sim::stats_t sst = sim.get_stats();
+        printf("sim: %llu calls  %llu SPI bytes  %.3f s modelled  %u faults\n",
+               static_cast<unsigned long long>(sst.calls), static_cast<unsigned long long>(sst.spi_bytes),
+               sst.modelled_ns / 1e9, sst.faults);
+    }
+    return EXIT_SUCCESS;
+}
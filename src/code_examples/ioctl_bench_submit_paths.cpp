@@ -0,0 +1,226 @@
+/* SPDX-License-Identifier: MIT
+ *
+ * FT800 frame-submission benchmark
+ *
+ *   Sends the same representative frame (clear, 11 buttons, a title and two
+ *   bitmaps) through each driver path and reports bytes/sec and frames/sec:
+ *
+ *     SUBMIT_CMDS – GraphCmdBuffer, copy_from_user of the encoded frame
+ *     CMD_WRITE   – packed {offset,len,data} write at the current FIFO offset
+ *     PUSH_MMAP   – GraphCmdBuffer encoding straight into the mmap'ed staging area
+ *
+ *   Every frame waits for the co-processor to drain so the three paths are
+ *   measured against the same SPI/co-processor work.
+ *
+ *   With --sim the benchmark runs against GraphFt800Sim instead of
+ *   /dev/ft800, so it also runs on a build host; the figures then come from
+ *   the simulator's SPI cost model.
+ *
+ *   Ends with GraphFt800's per-ioctl table (calls, errors, EAGAIN retries
+ *   and a latency histogram) for the requests that went through it.
+ *
+ * Build native:
+ *   g++ -std=c++17 -Wall -O2 -I../../graphics -I../../trace -I.. ioctl_bench_submit_paths.cpp \
+ *       ../../graphics/graph_ft800.cpp ../../graphics/graph_status.cpp \
+ *       ../../graphics/graph_cmd_encoder.cpp \
+ *       ../../graphics/graph_cmd_buffer.cpp ../../graphics/graph_cmd_fifo.cpp \
+ *       ../../graphics/graph_transport.cpp ../../graphics/graph_ft800_sim.cpp \
+ *       ../../graphics/graph_wait.cpp ../../graphics/graph_dl_budget.cpp \
+ *       ../../graphics/graph_cmd_batch.cpp -o ft800_bench_submit
+ * Run:
+ *   ./ft800_bench_submit [--sim] [frames]
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <endian.h>
+
+#include "ft800_uapi.h"
+#include "graph_ft800.h"
+#include "graph_ft800_sim.h"
+#include "graph_transport.h"
+#include "graph_cmd_buffer.h"
+#include "graph_ft800Cmds.h"
+
+#define DEVNODE         "/dev/ft800"
+#define DEFAULT_FRAMES  500U
+#define FIFO_MASK       0x0FFFU
+#define DRAIN_TIMEOUT   100000U      /* status polls before giving up */
+
+/* CMD_WRITE payload: the ioctl is sized for struct ft800_cmd[32] */
+struct cmd_write_arg {
+    uint32_t offset;
+    uint32_t len;
+    uint32_t data[(sizeof(struct ft800_cmd) * 32U - 8U) / 4U];
+} __attribute__((packed));
+
+struct bench_result {
+    const char *name;
+    unsigned frames;
+    size_t bytes;
+    double seconds;
+};
+
+/* ---------- helpers -------------------------------------------------- */
+static bool get_status(GraphTransport &dev, uint16_t &rd, uint16_t &wr)
+{
+    ft800_status st{};
+    if (dev.ioctl(FT800_IOCTL_GET_STATUS, &st) < 0)
+        return false;
+    rd = le16toh(st.cmd_read);
+    wr = le16toh(st.cmd_write);
+    return true;
+}
+
+static bool wait_fifo_idle(GraphTransport &dev)
+{
+    for (unsigned i = 0; i < DRAIN_TIMEOUT; ++i) {
+        uint16_t rd, wr;
+        if (!get_status(dev, rd, wr) || rd == 0x0FFF)
+            return false;
+        if (rd == wr)
+            return true;
+    }
+    return false;
+}
+
+static void encode_frame(GraphCmdEncoder &enc)
+{
+    enc.clear_color_rgb(0, 0, 40);
+    enc.clear(true, true, true);
+    enc.cmd_text(240, 12, 28, OPT_CENTERX, "Measurement");
+    for (int i = 0; i < 11; ++i) {
+        enc.tag(static_cast<uint8_t>(i + 1));
+        enc.cmd_button(static_cast<int16_t>(10 + (i % 4) * 118), static_cast<int16_t>(60 + (i / 4) * 60),
+                       108, 48, 27, 0, "Button");
+    }
+    enc.tag(0);
+    enc.begin_bitmap(0);
+    enc.vertex2ii(440, 4, 0, 0);
+    enc.vertex2ii(456, 4, 1, 0);
+    enc.end();
+}
+
+/* Counts only frames the buffer actually handed to the driver. */
+static bool bench_buffer(GraphCmdBuffer &buf, GraphTransport &dev, unsigned frames, bench_result &res)
+{
+    buf.invalidate();   /* the previous mode's last frame must not match the first one here */
+    uint32_t submitted = buf.frames_submitted();
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned f = 0; f < frames; ++f) {
+        buf.begin_frame();
+        encode_frame(buf);
+        size_t bytes = buf.size_bytes() + 2U * sizeof(uint32_t);   /* + DISPLAY, SWAP */
+        uint32_t before = buf.frames_submitted();
+        if (!buf.end_frame() || !wait_fifo_idle(dev))
+            return false;
+        if (buf.frames_submitted() != before)
+            res.bytes += bytes;
+    }
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    res.frames = buf.frames_submitted() - submitted;
+    return true;
+}
+
+static bool bench_cmd_write(GraphTransport &dev, unsigned frames, bench_result &res)
+{
+    GraphCmdEncoder enc;
+    static cmd_write_arg arg;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned f = 0; f < frames; ++f) {
+        enc.reset();
+        enc.cmd_dlstart();
+        encode_frame(enc);
+        enc.display();
+        enc.cmd_swap();
+
+        const uint32_t *words = enc.data();
+        size_t left = enc.size();
+        while (left > 0U) {
+            uint16_t rd, wr;
+            if (!get_status(dev, rd, wr))
+                return false;
+            size_t n = left < std::size(arg.data) ? left : std::size(arg.data);
+            arg.offset = wr & FIFO_MASK;
+            arg.len    = static_cast<uint32_t>(n * sizeof(uint32_t));
+            memcpy(arg.data, words, arg.len);
+            if (dev.ioctl(FT800_IOCTL_CMD_WRITE, &arg) < 0 || !wait_fifo_idle(dev))
+                return false;
+            words += n;
+            left  -= n;
+        }
+        res.bytes += enc.size_bytes();
+    }
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    res.frames = frames;
+    return true;
+}
+
+static void report(const bench_result &r)
+{
+    if (r.seconds <= 0.0) {
+        printf("%-12s  skipped\n", r.name);
+        return;
+    }
+    printf("%-12s  %6u frames  %8zu bytes  %10.0f B/s  %8.1f frames/s\n",
+           r.name, r.frames, r.bytes, r.bytes / r.seconds, r.frames / r.seconds);
+}
+/* -------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    bool use_sim = (argc > 1) && strcmp(argv[1], "--sim") == 0;
+    if (use_sim) {
+        --argc;
+        ++argv;
+    }
+    unsigned frames = (argc > 1) ? static_cast<unsigned>(strtoul(argv[1], nullptr, 0)) : DEFAULT_FRAMES;
+
+    GraphFt800Sim sim;
+    GraphDeviceTransport device(use_sim ? nullptr : DEVNODE);
+    GraphTransport &dev = use_sim ? static_cast<GraphTransport &>(sim) : device;
+    if (!dev.is_open()) {
+        perror("open " DEVNODE);
+        return EXIT_FAILURE;
+    }
+    GraphFt800 ft800(dev);   /* shares the transport used for status + raw CMD_WRITE */
+    if (dev.ioctl(FT800_IOCTL_CLEAR_DL, nullptr) < 0 || !wait_fifo_idle(dev)) {
+        perror("CLEAR_DL");
+        return EXIT_FAILURE;
+    }
+
+    bench_result submit_res{ "SUBMIT_CMDS", 0, 0, 0.0 };
+    bench_result write_res{  "CMD_WRITE",   0, 0, 0.0 };
+    bench_result mmap_res{   "PUSH_MMAP",   0, 0, 0.0 };
+
+    GraphCmdBuffer buf(ft800);
+    buf.set_skip_unchanged(false);   /* every frame is identical; all of them must be sent */
+    if (!bench_buffer(buf, dev, frames, submit_res))
+        perror("SUBMIT_CMDS");
+
+    if (!bench_cmd_write(dev, frames, write_res))
+        perror("CMD_WRITE");
+
+    if (!buf.set_submit_mode(GraphCmdBuffer::submit_mode_t::PUSH_MMAP))
+        perror("mmap staging");
+    else if (!bench_buffer(buf, dev, frames, mmap_res))
+        perror("PUSH_MMAP");
+
+    report(submit_res);
+    report(write_res);
+    report(mmap_res);
+    printf("\n");
+    ft800.print_ioctl_stats(stdout);
+
+    if (use_sim) {
+        GraphFt800Sim::stats_t st = sim.get_stats();
+        printf("sim: %llu calls  %llu SPI bytes  %.3f s modelled  %u faults\n",
+               static_cast<unsigned long long>(st.calls), static_cast<unsigned long long>(st.spi_bytes),
+               st.modelled_ns / 1e9, st.faults);
+    }
+    return EXIT_SUCCESS;
+}
@@ -72,6 +72,7 @@
 #define FT800_DL_OP_VERTEX2F         0x40U
 
 /* --- helpers to compose 32-bit DL words --------------------------------- */
+/* (C++: graphics/graph_dl.h has typed, range-checked constexpr versions)   */
 #define CLEAR_COLOR_RGB(r,g,b) \
         (((uint32_t)FT800_DL_OP_CLEAR_COLOR_RGB << 24) | \
          ((uint32_t)((r) & 0xFF) << 16) | \
@@ -161,6 +161,7 @@
 #define FT800_DL_OP_VERTEX2II          0x80U
 
 /* helpers for hand-crafted DL entries ------------------------------------ */
+/* (C++: graphics/graph_dl.h has typed, range-checked constexpr versions)   */
 #define CLEAR_COLOR_RGB(r,g,b) \
         (((FT800_DL_OP_CLEAR_COLOR_RGB) << 24) | (((r)&0xFFU)<<16) | (((g)&0xFFU)<<8) | ((b)&0xFFU))
 #define CLEAR_COLOR_A(a) \
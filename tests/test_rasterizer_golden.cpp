@@ -0,0 +1,221 @@
+/**
+ * @file test_rasterizer_golden.cpp
+ * @brief Golden-image check of GraphRasterizer on a fixed display list.
+ *
+ * Renders one display list covering every primitive the rasterizer
+ * supports, once directly and once as the simulator shows it after
+ * CMD_SWAP, and compares both with a checked-in PPM. A mismatch leaves
+ * the rendering next to the test binary for inspection.
+ *
+ *   test_rasterizer_golden GOLDEN.ppm [--update]
+ *
+ * --update rewrites GOLDEN.ppm from the direct rendering; check the
+ * result by eye before committing it.
+ */
+
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+ #include <vector>
+ #include "graph_ft800.h"
+ #include "graph_ft800_sim.h"
+ #include "graph_rasterizer.h"
+ #include "graph_dl.h"
+ #include "graph_ft800Cmds.h"
+ #include "graph_ft800Formats.h"
+ #include "graph_ft800Reg.h"
+
+ // Small enough that the reference image stays a few tens of KB.
+ static const uint16_t image_width = 160U;
+ static const uint16_t image_height = 96U;
+
+ // The rasterizer is exact, so any difference is a change in behaviour.
+ static const uint8_t tolerance = 0U;
+
+ static const uint32_t ram_g_bytes = 4096U;
+ static const uint32_t gradient_addr = RAM_G;           // 32x32 L8
+ static const uint32_t checker_addr = RAM_G + 0x400U;   // 16x16 ARGB4, two cells
+
+ static const uint32_t frame[] = {
+     Graph_dl::clear_color_rgb(16, 24, 48),
+     Graph_dl::clear(true, true, true),
+
+     // Status bar and a half-transparent panel over it
+     Graph_dl::color_rgb(40, 90, 160),
+     Graph_dl::begin(PRIM_RECTS),
+     Graph_dl::vertex2f(0 * 16, 0 * 16),
+     Graph_dl::vertex2f(159 * 16, 13 * 16),
+     Graph_dl::color_rgb(255, 255, 255),
+     Graph_dl::color_a(96),
+     Graph_dl::line_width(3 * 16),
+     Graph_dl::vertex2f(84 * 16, 8 * 16),
+     Graph_dl::vertex2f(150 * 16, 40 * 16),
+     Graph_dl::end(),
+     Graph_dl::color_a(255),
+
+     // Gauge-style points, one size change kept inside a saved context
+     Graph_dl::color_rgb(240, 200, 40),
+     Graph_dl::point_size(4 * 16),
+     Graph_dl::begin(PRIM_POINTS),
+     Graph_dl::vertex2f(20 * 16, 30 * 16),
+     Graph_dl::save_context(),
+     Graph_dl::point_size(8 * 16),
+     Graph_dl::color_rgb(220, 60, 60),
+     Graph_dl::vertex2f(44 * 16, 30 * 16),
+     Graph_dl::restore_context(),
+     Graph_dl::vertex2f(68 * 16, 30 * 16),
+     Graph_dl::end(),
+
+     // One-pixel axis lines through pixel centres and a fractional-coordinate trace
+     Graph_dl::color_rgb(200, 200, 200),
+     Graph_dl::line_width(16),
+     Graph_dl::begin(PRIM_LINES),
+     Graph_dl::vertex2f(8 * 16 + 8, 88 * 16 + 8),
+     Graph_dl::vertex2f(152 * 16 + 8, 88 * 16 + 8),
+     Graph_dl::vertex2f(8 * 16 + 8, 48 * 16 + 8),
+     Graph_dl::vertex2f(8 * 16 + 8, 88 * 16 + 8),
+     Graph_dl::end(),
+     Graph_dl::color_rgb(80, 220, 120),
+     Graph_dl::line_width(24),
+     Graph_dl::begin(PRIM_LINE_STRIP),
+     Graph_dl::vertex2f(8 * 16, 80 * 16),
+     Graph_dl::vertex2f(40 * 16 + 8, 56 * 16 + 4),
+     Graph_dl::vertex2f(72 * 16, 72 * 16),
+     Graph_dl::vertex2f(104 * 16 + 12, 52 * 16),
+     Graph_dl::vertex2f(150 * 16, 64 * 16),
+     Graph_dl::end(),
+
+     // Bitmaps: a tinted L8 gradient and both cells of an ARGB4 checker
+     Graph_dl::bitmap_handle(0),
+     Graph_dl::bitmap_source(gradient_addr),
+     Graph_dl::bitmap_layout(FT800_BITMAP_FORMAT_L8, 32, 32),
+     Graph_dl::bitmap_size(0, 0, 0, 32, 32),
+     Graph_dl::bitmap_handle(1),
+     Graph_dl::bitmap_source(checker_addr),
+     Graph_dl::bitmap_layout(FT800_BITMAP_FORMAT_ARGB4, 32, 16),
+     Graph_dl::bitmap_size(0, 0, 0, 16, 16),
+     Graph_dl::begin(PRIM_BITMAPS),
+     Graph_dl::color_rgb(255, 160, 160),
+     Graph_dl::vertex2ii(90, 48, 0, 0),
+     Graph_dl::color_rgb(255, 255, 255),
+     Graph_dl::vertex2ii(128, 48, 1, 0),
+     Graph_dl::bitmap_handle(1),
+     Graph_dl::cell(1),
+     Graph_dl::vertex2f(128 * 16, 66 * 16),
+     Graph_dl::end(),
+
+     Graph_dl::display()
+ };
+ static const size_t frame_words = sizeof(frame) / sizeof(frame[0]);
+
+ /** The bitmap sources: a diagonal L8 ramp and a two-cell ARGB4 checker. */
+ static std::vector<uint8_t> make_ram_g()
+ {
+     std::vector<uint8_t> ram_g(ram_g_bytes, 0U);
+     for (uint32_t y = 0U; y < 32U; ++y)
+     {
+         for (uint32_t x = 0U; x < 32U; ++x)
+         {
+             ram_g[gradient_addr + y * 32U + x] = static_cast<uint8_t>((x + y) * 4U);
+         }
+     }
+     for (uint32_t cell = 0U; cell < 2U; ++cell)
+     {
+         for (uint32_t y = 0U; y < 16U; ++y)
+         {
+             for (uint32_t x = 0U; x < 16U; ++x)
+             {
+                 bool on = (((x / 4U) + (y / 4U) + cell) % 2U) == 0U;
+                 uint16_t pixel = on ? 0xFF80U : 0x808FU;   // opaque orange / half-transparent blue
+                 uint32_t at = checker_addr + cell * 512U + y * 32U + x * 2U;
+                 ram_g[at] = static_cast<uint8_t>(pixel & 0xFFU);
+                 ram_g[at + 1U] = static_cast<uint8_t>(pixel >> 8);
+             }
+         }
+     }
+     return ram_g;
+ }
+
+ /** Sends the frame through the co-processor and returns the list it swapped in. */
+ static bool render_on_sim(const std::vector<uint8_t>& ram_g, std::vector<uint32_t>* shown)
+ {
+     GraphFt800Sim sim;
+     GraphFt800Sim::spi_model_t model = GraphFt800Sim::default_spi_model;
+     model.realtime = false;
+     sim.set_spi_model(model);
+     GraphFt800 ft800(sim);
+
+     if (!ft800.mem_write(RAM_G, ram_g.data(), ram_g.size()) || !ft800.cmd_dlstart().ok() ||
+         !ft800.submit_cmds(frame, frame_words) || !ft800.cmd_swap().ok())
+     {
+         return false;
+     }
+     *shown = sim.displayed_list();
+     return !shown->empty();
+ }
+
+ /** Compares @p raster with the golden image; on a mismatch writes @p actual_path. */
+ static bool check(const GraphRasterizer& raster, const char* golden_path, const char* name, const char* actual_path)
+ {
+     uint32_t mismatched = 0U;
+     if (!raster.compare_ppm(golden_path, tolerance, &mismatched))
+     {
+         fprintf(stderr, "%s: cannot read %s as a %ux%u PPM\n", name, golden_path, image_width, image_height);
+         return false;
+     }
+     if (mismatched != 0U)
+     {
+         (void)raster.write_ppm(actual_path);
+         fprintf(stderr, "%s: %u pixels differ from %s, rendering written to %s\n", name, mismatched, golden_path,
+                 actual_path);
+         return false;
+     }
+     printf("%s: matches %s\n", name, golden_path);
+     return true;
+ }
+
+ int main(int argc, char** argv)
+ {
+     if (argc < 2 || (argc == 3 && strcmp(argv[2], "--update") != 0) || argc > 3)
+     {
+         fprintf(stderr, "usage: %s GOLDEN.ppm [--update]\n", argv[0]);
+         return EXIT_FAILURE;
+     }
+     const char* golden_path = argv[1];
+     std::vector<uint8_t> ram_g = make_ram_g();
+
+     GraphRasterizer direct(image_width, image_height);
+     direct.set_ram_g(ram_g.data(), ram_g.size());
+     GraphRasterizer::stats_t stats = direct.render(frame, frame_words);
+     if (!stats.terminated || stats.unsupported_words != 0U)
+     {
+         fprintf(stderr, "direct: list not fully rendered (%u unsupported words)\n", stats.unsupported_words);
+         return EXIT_FAILURE;
+     }
+
+     if (argc == 3)
+     {
+         if (!direct.write_ppm(golden_path))
+         {
+             fprintf(stderr, "cannot write %s\n", golden_path);
+             return EXIT_FAILURE;
+         }
+         printf("wrote %s\n", golden_path);
+         return EXIT_SUCCESS;
+     }
+
+     bool result = check(direct, golden_path, "direct", "rasterizer_direct.ppm");
+
+     std::vector<uint32_t> shown;
+     if (!render_on_sim(ram_g, &shown))
+     {
+         fprintf(stderr, "simulator: frame was not displayed\n");
+         return EXIT_FAILURE;
+     }
+     GraphRasterizer swapped(image_width, image_height);
+     swapped.set_ram_g(ram_g.data(), ram_g.size());
+     (void)swapped.render(shown.data(), shown.size());
+     result = check(swapped, golden_path, "simulator", "rasterizer_simulator.ppm") && result;
+
+     return result ? EXIT_SUCCESS : EXIT_FAILURE;
+ }
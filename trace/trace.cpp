@@ -0,0 +1,222 @@
+/**
+ * @file trace.cpp
+ * @brief Per-thread trace rings and the Chrome trace-event JSON writer.
+ */
+
+ #include <atomic>
+ #include <memory>
+ #include <mutex>
+ #include <ctime>
+ #include <unistd.h>
+ #include <sys/syscall.h>
+ #include "trace.h"
+
+ static const uint64_t ring_mask = Trace::ring_events - 1U;
+ static_assert((Trace::ring_events & ring_mask) == 0U, "ring_events must be a power of two");
+
+ namespace
+ {
+     /** Single-writer ring: only the owning thread stores, dumps only read. */
+     struct ring_t
+     {
+         trace_event_t events[Trace::ring_events];
+         std::atomic<uint64_t> head;       // events ever written
+         std::atomic<uint64_t> cleared;    // head at the last clear()
+         std::atomic<bool> in_use;
+     };
+
+     std::atomic<bool> tracing(false);
+     std::mutex registry_lock;
+     std::vector<std::unique_ptr<ring_t>> registry;
+
+     /** Claims a ring for the calling thread, reusing one a finished thread left. */
+     ring_t* claim_ring()
+     {
+         std::lock_guard<std::mutex> guard(registry_lock);
+         for (std::unique_ptr<ring_t>& ring : registry)
+         {
+             bool expected = false;
+             if (ring->in_use.compare_exchange_strong(expected, true))
+             {
+                 return ring.get();
+             }
+         }
+         std::unique_ptr<ring_t> fresh(new ring_t());
+         fresh->head.store(0U);
+         fresh->cleared.store(0U);
+         fresh->in_use.store(true);
+         registry.push_back(std::move(fresh));
+         return registry.back().get();
+     }
+
+     /** Gives the thread's ring back when the thread exits. */
+     struct ring_release_t
+     {
+         ring_t* ring;
+
+         ~ring_release_t()
+         {
+             if (ring != nullptr)
+             {
+                 ring->in_use.store(false, std::memory_order_release);
+             }
+         }
+     };
+
+     // Plain thread_locals keep the record() path free of TLS init guards;
+     // the releasing object is only touched when a ring is claimed.
+     thread_local ring_t* thread_ring = nullptr;
+     thread_local uint32_t thread_id = 0U;
+     thread_local ring_release_t thread_release = {nullptr};
+ }
+
+ void Trace::set_enabled(bool enable)
+ {
+     tracing.store(enable, std::memory_order_relaxed);
+ }
+
+ bool Trace::enabled()
+ {
+     return tracing.load(std::memory_order_relaxed);
+ }
+
+ uint64_t Trace::now_ns()
+ {
+     struct timespec now;
+     (void)clock_gettime(CLOCK_MONOTONIC, &now);
+     return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+ }
+
+ /** Appends one event to the calling thread's ring. */
+ void Trace::record(trace_category_t category, const char* name, uint32_t id, uint32_t bytes,
+                    int32_t result, uint64_t start_ns, uint64_t end_ns)
+ {
+     ring_t* ring = thread_ring;
+     if (ring == nullptr)
+     {
+         ring = claim_ring();
+         thread_ring = ring;
+         thread_id = static_cast<uint32_t>(syscall(SYS_gettid));
+         thread_release.ring = ring;
+     }
+     uint64_t head = ring->head.load(std::memory_order_relaxed);
+     uint64_t duration = (end_ns > start_ns) ? end_ns - start_ns : 0U;
+
+     trace_event_t& event = ring->events[head & ring_mask];
+     event.start_ns = start_ns;
+     event.duration_ns = (duration > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(duration);
+     event.id = id;
+     event.bytes = bytes;
+     event.result = result;
+     event.name = name;
+     event.tid = thread_id;
+     event.category = category;
+     ring->head.store(head + 1U, std::memory_order_release);
+ }
+
+ /**
+  * Copies the events of all rings into @p events (appended, ring by ring,
+  * oldest first). Returns the number copied.
+  */
+ size_t Trace::snapshot(std::vector<trace_event_t>* events)
+ {
+     size_t copied = 0U;
+     if (events == nullptr)
+     {
+         return 0U;
+     }
+
+     std::lock_guard<std::mutex> guard(registry_lock);
+     for (std::unique_ptr<ring_t>& ring : registry)
+     {
+         uint64_t end = ring->head.load(std::memory_order_acquire);
+         uint64_t begin = ring->cleared.load(std::memory_order_relaxed);
+         if (end - begin > ring_events)
+         {
+             begin = end - ring_events;
+         }
+         size_t first = events->size();
+         for (uint64_t i = begin; i < end; ++i)
+         {
+             events->push_back(ring->events[i & ring_mask]);
+         }
+
+         // Anything the writer lapped while we copied may be torn; drop it.
+         // The writer may also be part-way through slot head, which is the
+         // slot of index head - ring_events, so that one is not valid either.
+         uint64_t after = ring->head.load(std::memory_order_acquire);
+         uint64_t valid_from = (after + 1U > ring_events) ? after + 1U - ring_events : 0U;
+         if (valid_from > begin)
+         {
+             uint64_t torn = valid_from - begin;
+             if (torn > end - begin)
+             {
+                 torn = end - begin;
+             }
+             events->erase(events->begin() + static_cast<std::ptrdiff_t>(first),
+                           events->begin() + static_cast<std::ptrdiff_t>(first + torn));
+         }
+         copied += events->size() - first;
+     }
+     return copied;
+ }
+
+ /** Forgets everything recorded so far; writers are not disturbed. */
+ void Trace::clear()
+ {
+     std::lock_guard<std::mutex> guard(registry_lock);
+     for (std::unique_ptr<ring_t>& ring : registry)
+     {
+         ring->cleared.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+     }
+ }
+
+ const char* Trace::category_name(trace_category_t category)
+ {
+     switch (category)
+     {
+     case trace_category_t::FT800:   return "ft800";
+     case trace_category_t::FIFO:    return "fifo";
+     case trace_category_t::TOUCH:   return "touch";
+     case trace_category_t::APP:     return "app";
+     default:                        return "other";
+     }
+ }
+
+ /** Writes all rings as Chrome trace-event JSON ("X" complete events, microseconds). */
+ bool Trace::write_chrome_json(FILE* stream)
+ {
+     if (stream == nullptr)
+     {
+         return false;
+     }
+
+     std::vector<trace_event_t> events;
+     (void)snapshot(&events);
+     int pid = static_cast<int>(getpid());
+
+     (void)fprintf(stream, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+     for (size_t i = 0U; i < events.size(); ++i)
+     {
+         const trace_event_t& e = events[i];
+         (void)fprintf(stream,
+                       "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu.%03u,\"dur\":%u.%03u,"
+                       "\"pid\":%d,\"tid\":%u,\"args\":{\"id\":\"0x%08X\",\"bytes\":%u,\"result\":%d}}",
+                       (i == 0U) ? "" : ",", (e.name != nullptr) ? e.name : "?", category_name(e.category),
+                       static_cast<unsigned long long>(e.start_ns / 1000U), static_cast<unsigned>(e.start_ns % 1000U),
+                       e.duration_ns / 1000U, e.duration_ns % 1000U, pid, e.tid, e.id, e.bytes, e.result);
+     }
+     (void)fprintf(stream, "\n]}\n");
+     return ferror(stream) == 0;
+ }
+
+ bool Trace::write_chrome_json(const char* path)
+ {
+     FILE* stream = (path != nullptr) ? fopen(path, "w") : nullptr;
+     if (stream == nullptr)
+     {
+         return false;
+     }
+     bool result = write_chrome_json(stream);
+     return (fclose(stream) == 0) && result;
+ }
@@ -0,0 +1,113 @@
+/**
+ * @file trace.h
+ * @brief Low-overhead event tracing into per-thread ring buffers.
+ */
+
+ #ifndef TRACE_H
+ #define TRACE_H
+
+ #include <cstdint>
+ #include <cstddef>
+ #include <cstdio>
+ #include <vector>
+
+ enum class trace_category_t : uint8_t
+ {
+     FT800 = 0,   //!< GraphFt800 driver requests
+     FIFO,        //!< Co-processor FIFO waits
+     TOUCH,       //!< Touch events, interrupt to queue
+     APP
+ };
+
+ /** One completed, timed operation. */
+ struct trace_event_t
+ {
+     uint64_t start_ns;      //!< CLOCK_MONOTONIC
+     uint32_t duration_ns;   //!< Saturates at ~4.3 s
+     uint32_t id;            //!< ioctl request, touch tag, ...
+     uint32_t bytes;
+     int32_t result;         //!< 0 or positive on success, -errno style on failure
+     const char* name;       //!< Must be a string literal (stored, not copied)
+     uint32_t tid;
+     trace_category_t category;
+ };
+
+ /**
+  * Each thread writes its own ring of ring_events entries, allocated on its
+  * first event; recording takes no lock and never blocks, and the oldest
+  * events are overwritten. A ring outlives its thread and is handed to the
+  * next new thread. Recording is off until set_enabled(true); with
+  * TRACE_ENABLED undefined the TRACE_* macros compile to nothing.
+  *
+  * write_chrome_json() dumps every ring as Chrome trace-event JSON, which
+  * chrome://tracing and ui.perfetto.dev load directly. A dump taken while
+  * other threads keep tracing is a best-effort snapshot: events overwritten
+  * during the copy are left out.
+  *
+  *     Trace::set_enabled(true);
+  *     ...
+  *     Trace::write_chrome_json("/tmp/ft800.json");
+  */
+ class Trace
+ {
+ public:
+     static const uint32_t ring_events = 8192U;   // power of two
+
+     static void set_enabled(bool enable);
+     static bool enabled();
+     static uint64_t now_ns();
+
+     static void record(trace_category_t category, const char* name, uint32_t id, uint32_t bytes,
+                        int32_t result, uint64_t start_ns, uint64_t end_ns);
+
+     static size_t snapshot(std::vector<trace_event_t>* events);
+     static void clear();
+     static bool write_chrome_json(FILE* stream);
+     static bool write_chrome_json(const char* path);
+     static const char* category_name(trace_category_t category);
+ };
+
+ /** Records the lifetime of a block as one event. */
+ class TraceScope
+ {
+ public:
+     TraceScope(trace_category_t category, const char* name, uint32_t id, uint32_t bytes)
+         : category(category), name(name), id(id), bytes(bytes), result(0),
+           start_ns(Trace::enabled() ? Trace::now_ns() : 0U)
+     {
+     }
+
+     ~TraceScope()
+     {
+         if (start_ns != 0U)
+         {
+             Trace::record(category, name, id, bytes, result, start_ns, Trace::now_ns());
+         }
+     }
+
+     void set_result(int32_t value) { result = value; }
+     void set_bytes(uint32_t value) { bytes = value; }
+
+ private:
+     trace_category_t category;
+     const char* name;
+     uint32_t id;
+     uint32_t bytes;
+     int32_t result;
+     uint64_t start_ns;
+ };
+
+ #ifdef TRACE_ENABLED
+ # define TRACE_SCOPE(var, category, name, id, bytes) TraceScope var((category), (name), (id), (bytes))
+ # define TRACE_SET_RESULT(var, value) (var).set_result(value)
+ # define TRACE_EVENT(category, name, id, bytes, result, start_ns, end_ns) \
+     do { if (Trace::enabled()) Trace::record((category), (name), (id), (bytes), (result), (start_ns), (end_ns)); } while (0)
+ #else
+ # define TRACE_SCOPE(var, category, name, id, bytes) ((void)0)
+ # define TRACE_SET_RESULT(var, value) ((void)0)
+ // Unevaluated, so locals kept only for tracing do not trigger unused warnings.
+ # define TRACE_EVENT(category, name, id, bytes, result, start_ns, end_ns) \
+     ((void)sizeof((id) + (bytes) + (result) + (start_ns) + (end_ns)))
+ #endif
+
+ #endif // TRACE_H